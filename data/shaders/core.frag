@@ -34,6 +34,25 @@ uniform sampler2D tex;
 #define TEXFUNC vec4(1.0)
 #endif
 
+#ifdef ENABLE_YUV
+// Video frames: tex holds Y, texU and texV the chroma planes (or texU interleaved UV for NV12)
+uniform sampler2D texU;
+uniform sampler2D texV;
+uniform bool nv12;
+uniform mat4 yuvMatrix;
+
+vec4 yuvTexel() {
+	float y = texture(tex, fragIn.texCoord).r;
+	vec2 uv = nv12 ? texture(texU, fragIn.texCoord).rg : vec2(texture(texU, fragIn.texCoord).r, texture(texV, fragIn.texCoord).r);
+	vec3 rgb = clamp((yuvMatrix * vec4(y, uv, 1.0)).rgb, 0.0, 1.0);
+	// Decode sRGB, as the hardware does for sRGB textures
+	rgb = mix(rgb / 12.92, pow((rgb + 0.055) / 1.055, vec3(2.4)), step(0.04045, rgb));
+	return vec4(rgb, 1.0);
+}
+#undef TEXFUNC
+#define TEXFUNC yuvTexel()
+#endif
+
 #ifdef ENABLE_SPECULAR_MAP
 uniform sampler2D specularTex;
 #endif
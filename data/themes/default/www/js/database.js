@@ -5,35 +5,72 @@
 "use strict";
 
 /*
-    On refresh database button click make an API call to get the current loaded songs.
-    Once the data is arrived parse it and clear the table.
-    Build the table (in memory as one string) and append it to the div which holds all of the songs.
-    When the table is build add a songObject as JSON to each row. This is used for adding the song once clicked.
+    The database is loaded one page at a time, as building the table of a large library at once stalls the browser.
+    'databaseLoaded' is the number of songs in the table, 'databaseRequest' tells the newest request from older ones.
 */
-$("#refresh-database").click(function () {
-    $.get("api/getDataBase.json", function (data) {
+var databasePageSize = 200;
+var databaseSort = "artist";
+var databaseOrder = "ascending";
+var databaseLoaded = 0;
+var databaseRequest = 0;
+
+/*
+    Make an API call to get the next page of songs in the current sort order, or the first page if 'first' is set.
+    Once the data is arrived parse it, and clear the table if this is the first page.
+    Build the rows (in memory as one string) and append them to the div which holds all of the songs.
+    When the rows are built add a songObject as JSON to each row. This is used for adding the song once clicked.
+    The server reports the number of songs in the X-Total-Count header, the load more button is shown while there are more.
+    Responses to requests made before the table was cleared again (e.g. by sorting) are ignored.
+*/
+function loadDatabasePage(first) {
+    var request = first ? ++databaseRequest : databaseRequest;
+    var offset = first ? 0 : databaseLoaded;
+    var url = "api/getDataBase.json?sort=" + databaseSort + "&order=" + databaseOrder + "&offset=" + offset + "&limit=" + databasePageSize;
+
+    $.get(url, function (data, status, xhr) {
         var database = data;
-        clearTable("database-songs");
+        if (request !== databaseRequest) {
+            return;
+        }
+        if (first) {
+            clearTable("database-songs");
+        }
 
-        var html = buildTable(database);
+        var html = buildTable(database, offset);
         $(html).appendTo("#database-songs");
 
         $.each(database, function (iterator, songObject) {
-            $("#database-songs-" + iterator).data("songObject", JSON.stringify(songObject));
+            $("#database-songs-" + (offset + iterator)).data("songObject", JSON.stringify(songObject));
         });
+
+        databaseLoaded = offset + database.length;
+        var total = parseInt(xhr.getResponseHeader("X-Total-Count"), 10);
+        $("#load-more-songs").toggleClass("hidden", !(databaseLoaded < total));
     });
+}
+
+/*
+    On refresh database button click load the first page of the current loaded songs.
+*/
+$("#refresh-database").click(function () {
+    loadDatabasePage(true);
+});
+
+/*
+    On load more button click append the next page of songs to the table.
+*/
+$("#load-more-songs").click(function () {
+    loadDatabasePage(false);
 });
 
 /*
     One may click on the table headers to sort ascending or descending for that column.
-    This will clear the whole table and does a post to the API which sends a sorted list back.
-    Build the table (in memory as one string) and append it to the div which holds all of the songs.
-    When the table is build add a songObject as JSON to each row. This is used for adding the song once clicked.
+    This will clear the whole table and loads the first page of the sorted list from the API.
 */
 $("a[id^='sort-by-']").click(function () {
     var sortOrderToBe = $(this).data("sort-ascending") ? "descending" : "ascending";
-    var sortBy = $(this).attr("id").replace("sort-by-", "");
-    var url = "api/getDataBase.json?sort=" + sortBy + "&order=" + sortOrderToBe;
+    databaseSort = $(this).attr("id").replace("sort-by-", "");
+    databaseOrder = sortOrderToBe;
 
     $(this).data("sort-ascending", sortOrderToBe === "descending" ? false : true);
     $(this).find("span").toggleClass("glyphicon-menu-down").toggleClass("glyphicon-menu-up");
@@ -41,18 +78,7 @@ $("a[id^='sort-by-']").click(function () {
         $(this).find("span").removeClass("glyphicon-menu-up").addClass("glyphicon-menu-down");
     });
 
-    $.get(url, function (data) {
-        var database = data;
-
-        clearTable("database-songs");
-
-        var html = buildTable(database);
-        $(html).appendTo("#database-songs");
-
-        $.each(database, function (iterator, songObject) {
-            $("#database-songs-" + iterator).data("songObject", JSON.stringify(songObject));
-        });
-    });
+    loadDatabasePage(true);
 });
 
 /*
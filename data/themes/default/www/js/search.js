@@ -5,8 +5,8 @@
 "use strict";
 
 /*
-    Whenever click upon the search tab we will load the current database.
-    Once successfully retrieved this will be the source of the autocompleter.
+    Whenever click upon the search tab the autocompleter is set up.
+    It asks the server for the first 10 songs matching the typed text, so the database is never downloaded as a whole.
     The autocomplete function shows 10 items and doesn"t select items per default.
     If an item from the autocomplete is clicked "addSong" will be called to add the clicked song.
     After this the search field will be cleared and if the result is successful the player will be redirected to the playlist tab.
@@ -14,24 +14,24 @@
     The autocomplete makes use of the TypeAhead library.
 */
 $("#search-tab").click(function (){
-    $.get("api/getDataBase.json?sort=artist&order=ascending", function (data) {
-        var database = data;
-        var input = $("#search-field");
-        input.typeahead({
-            source: database,
-            autoSelect: false,
-            items: 10,
-            select: function (e) {
-                var val = this.$menu.find(".active").data("value");
-                if(val) {
-                    addSong(JSON.stringify(val));
-                    $("#search-field").val("");
-                } else {
-                    $("#search-database").click();
-                    $(".typeahead.dropdown-menu").hide();
-                }
+    var input = $("#search-field");
+    input.typeahead({
+        source: function (query, process) {
+            return $.get("api/getDataBase.json?sort=artist&order=ascending&limit=10&q=" + encodeURIComponent(query), process);
+        },
+        delay: 150,
+        autoSelect: false,
+        items: 10,
+        select: function (e) {
+            var val = this.$menu.find(".active").data("value");
+            if(val) {
+                addSong(JSON.stringify(val));
+                $("#search-field").val("");
+            } else {
+                $("#search-database").click();
+                $(".typeahead.dropdown-menu").hide();
             }
-        });
+        }
     });
 });
 
@@ -5,16 +5,17 @@
 
 /*
     Building the database table from a collection of songs.
-    This function is used within 'database.js' to generate the table.
+    This function is used within 'database.js' to generate the table, one page of songs at a time.
+    The rows are numbered from 'first' on, so that the rows of later pages get their own ids.
     This function outputs one big string containing the complete body of the table.
     This is way faster than adding row by row with JQuery since each add causes a complete redraw.
     We build this up in memory and then draw the complete table one time.
 */
-function buildTable(database) {
+function buildTable(database, first) {
     var r = [];
     var j = -1;
     for (var key = 0, size = database.length; key < size; key++) {
-        r[++j] = "<tr id='database-songs-" + key +"'><td>";
+        r[++j] = "<tr id='database-songs-" + (first + key) +"'><td>";
         r[++j] = database[key].Artist;
         r[++j] = "</td><td>";
         r[++j] = database[key].Title;
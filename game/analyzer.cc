@@ -13,15 +13,19 @@ static const double FFT_MAXFREQ = 5000.0;
 
 Analyzer::Analyzer(double rate, std::string id, unsigned step):
   m_step(step),
+  m_passthroughPcm(decltype(m_passthrough)::capacity),
   m_resampleFactor(1.0),
   m_resamplePos(),
   m_rate(rate),
   m_id(id),
   m_window(FFT_N),
+  m_fft(decltype(m_fftPlan)::BINS),
   m_fftLastPhase(FFT_N / 2),
   m_peak(0.0),
   m_oldfreq(0.0)
 {
+	// Room for the usual number of tones, so that steady state processing does not allocate
+	for (auto* tones: { &m_newTones, &m_tones, &m_prevTones }) tones->reserve(64);
 	if (m_step > FFT_N) throw std::logic_error("Analyzer step is larger that FFT_N (ideally it should be less than a fourth of FFT_N).");
 	// Hamming window
 	for (size_t i=0; i < FFT_N; i++) {
@@ -29,14 +33,17 @@ Analyzer::Analyzer(double rate, std::string id, unsigned step):
 	}
 }
 
+Analyzer::~Analyzer() = default;
+
 void Analyzer::output(float* begin, float* end, double rate) {
 	constexpr unsigned a = 2;
 	auto const size = m_passthrough.size();
 	auto const out = static_cast<unsigned>((end - begin) / 2) /* stereo */;
 	if (out == 0) return;
 	const unsigned in = static_cast<unsigned>(m_resampleFactor * (m_rate / rate) * out + 2 * a) /* lanczos kernel */ + 5 /* safety margin for rounding errors */;
-	std::vector<float> pcm(m_passthrough.capacity);
-	m_passthrough.read(pcm.data(), pcm.data() + in + 4);
+	std::vector<float>& pcm = m_passthroughPcm;
+	if (in + 4 > pcm.size()) return;  // Block too large for the pass-through buffer
+	if (!m_passthrough.read(pcm.data(), pcm.data() + in + 4)) std::fill(pcm.begin(), pcm.begin() + in + 4, 0.0f);
 	for (unsigned i = 0; i < out; ++i) {
 		double s = 0.0;
 		unsigned k = static_cast<unsigned>(m_resamplePos);
@@ -61,29 +68,14 @@ void Analyzer::output(float* begin, float* end, double rate) {
 }
 
 
-namespace {
-	struct Peak {
-		double freq;
-		double db;
-		bool harm[Tone::MAXHARM];
-		Peak(double _freq = 0.0, double _db = -getInf()):
-		  freq(_freq), db(_db)
-		{
-			for (auto& h: harm) h = false;
-		}
-		void clear() {
-			freq = 0.0;
-			db = -getInf();
-		}
-	};
-
-	Peak& match(std::vector<Peak>& peaks, std::size_t pos) {
-		std::size_t best = pos;
-		if (peaks[pos - 1].db > peaks[best].db) best = pos - 1;
-		if (peaks[pos + 1].db > peaks[best].db) best = pos + 1;
-		return peaks[best];
+struct Analyzer::Peak {
+	double freq = 0.0;
+	double db = -getInf();
+	void clear() {
+		freq = 0.0;
+		db = -getInf();
 	}
-}
+};
 
 bool Analyzer::calcFFT() {
 	float pcm[FFT_N];
@@ -97,7 +89,7 @@ bool Analyzer::calcFFT() {
 		if (p > m_peak) m_peak = p; else m_peak *= 0.999;
 	}
 	// Calculate FFT
-	m_fft = da::fft<FFT_P>(pcm, m_window);
+	m_fftPlan(pcm, m_window.data(), m_fft.data());
 	return true;
 }
 
@@ -111,7 +103,14 @@ void Analyzer::calcTones() {
 	// Limit frequency range of processing
 	const size_t kMin = std::max(size_t(1), size_t(FFT_MINFREQ / freqPerBin));
 	const size_t kMax = std::min(FFT_N / 2, size_t(FFT_MAXFREQ / freqPerBin));
-	std::vector<Peak> peaks(kMax + 1); // One extra to simplify loops
+	std::vector<Peak>& peaks = m_peaks;
+	peaks.assign(kMax + 1, Peak()); // One extra to simplify loops
+	auto match = [&peaks](std::size_t pos) -> Peak& {
+		std::size_t best = pos;
+		if (peaks[pos - 1].db > peaks[best].db) best = pos - 1;
+		if (peaks[pos + 1].db > peaks[best].db) best = pos + 1;
+		return peaks[best];
+	};
 	for (size_t k = 1; k <= kMax; ++k) {
 		double magnitude = std::abs(m_fft[k]);
 		double phase = std::arg(m_fft[k]) / TAU;
@@ -133,7 +132,8 @@ void Analyzer::calcTones() {
 		prevdb = db;
 	}
 	// Find the tones (collections of harmonics) from the array of peaks
-	tones_t tones;
+	tones_t& tones = m_newTones;
+	tones.clear();
 	for (size_t k = kMax - 1; k >= kMin; --k) {
 		if (peaks[k].db < -60.0) continue;
 		// Find the best divider for getting the fundamental from peaks[k]
@@ -143,7 +143,7 @@ void Analyzer::calcTones() {
 			double freq = peaks[k].freq / static_cast<double>(div); // Fundamental
 			int score = 0;
 			for (std::size_t n = 1; n < div && n < 8; ++n) {
-				Peak& p = match(peaks, k * n / div);
+				Peak& p = match(k * n / div);
 				--score;
 				if (p.db < -80.0 || std::abs(p.freq / static_cast<double>(n) / freq - 1.0) > .03) continue;
 				if (n == 1) score += 4; // Extra for fundamental
@@ -161,7 +161,7 @@ void Analyzer::calcTones() {
 		t.db = peaks[k].db;
 		for (std::size_t n = 1; n <= bestDiv; ++n) {
 			// Find the peak for n'th harmonic
-			Peak& p = match(peaks, k * n / bestDiv);
+			Peak& p = match(k * n / bestDiv);
 			if (std::abs(p.freq / static_cast<double>(n) / freq - 1.0) > .03) continue; // Does it match the fundamental freq?
 			if (p.db > t.db - 10.0) {
 				t.db = std::max(t.db, p.db);
@@ -178,17 +178,21 @@ void Analyzer::calcTones() {
 			tones.push_back(t);
 		}
 	}
-	mergeWithOld(tones);
-	m_tones.swap(tones);
+	mergeWithOld();
 }
 
-void Analyzer::mergeWithOld(tones_t& tones) const {
-	tones.sort();
+void Analyzer::mergeWithOld() {
+	tones_t& tones = m_newTones;
+	// Peaks were scanned from high to low frequency
+	std::sort(tones.begin(), tones.end(), [](Tone const& l, Tone const& r) { return l.freq < r.freq; });
+	// Merge the sorted new and old tones into the previous result buffer
+	tones_t& merged = m_prevTones;
+	merged.clear();
 	auto it = tones.begin();
 	// Iterate over old tones
 	for (auto const& old: m_tones) {
 		// Try to find a matching new tone
-		while (it != tones.end() && *it < old) ++it;
+		while (it != tones.end() && *it < old) merged.push_back(*it++);
 		// If match found
 		if (it != tones.end() && *it == old) {
 			// Merge the old tone into the new tone
@@ -197,11 +201,14 @@ void Analyzer::mergeWithOld(tones_t& tones) const {
 			it->freq = 0.5 * old.freq + 0.5 * it->freq;
 		} else if (old.db > -70.0) {
 			// Insert a decayed version of the old tone into new tones
-			Tone& t = *tones.insert(it, old);
+			merged.push_back(old);
+			Tone& t = merged.back();
 			t.db -= 5.0;
 			t.stabledb -= 0.1;
 		}
 	}
+	merged.insert(merged.end(), it, tones.end());
+	m_tones.swap(m_prevTones);
 }
 
 void Analyzer::process() {
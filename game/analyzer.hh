@@ -1,12 +1,12 @@
 #pragma once
 
+#include "libda/fft.hpp"
 #include "ringbuffer.hh"
 #include "tone.hh"
 
 #include <cstdint>
 #include <complex>
 #include <vector>
-#include <list>
 #include <algorithm>
 #include <cmath>
 
@@ -18,12 +18,13 @@ class Analyzer {
   public:
 	Analyzer(const Analyzer&) = delete;
 	const Analyzer& operator=(const Analyzer&) = delete;
-	/// fast fourier transform vector
+	/// fast fourier transform vector (bins 0 to FFT_N / 2)
 	using fft_t = std::vector<std::complex<float>>;
-	/// list of tones
-	using tones_t = std::list<Tone>;
+	/// tones sorted by frequency
+	using tones_t = std::vector<Tone>;
 	/// constructor
 	Analyzer(double rate, std::string id, unsigned step = 200);
+	~Analyzer();
 	/** Add input data to buffer. This is thread-safe (against other functions). **/
 	template <typename InIt> void input(InIt begin, InIt end) {
 		m_buf.insert(begin, end);
@@ -35,7 +36,7 @@ class Analyzer {
 	fft_t const& getFFT() const { return m_fft; }
 	/** Get the peak level in dB (negative value, 0.0 = clipping). **/
 	double getPeak() const { return 10.0 * log10(m_peak); }
-	/** Get a list of all tones detected. **/
+	/** Get all tones detected in the latest step, sorted by frequency. Valid until the next process(). **/
 	tones_t const& getTones() const { return m_tones; }
 	/** Find a tone within the singing range; prefers strong tones around 200-400 Hz. **/
 	Tone const* findTone(double minfreq = 65.0, double maxfreq = 1000.0) const;
@@ -47,19 +48,26 @@ class Analyzer {
   private:
 	bool calcFFT();
 	void calcTones();
-	void mergeWithOld(tones_t& tones) const;
+	void mergeWithOld();
+
+	struct Peak;
 
 	const unsigned m_step;
 	RingBuffer<2 * FFT_N> m_buf;  // Twice the FFT size should give enough room for sliding window and for engine delays
 	RingBuffer<4096> m_passthrough;
+	std::vector<float> m_passthroughPcm;  ///< Scratch space for output() (preallocated, it runs in the audio callback)
 	double m_resampleFactor;
 	double m_resamplePos;
 	double m_rate;
 	std::string m_id;
 	std::vector<float> m_window;
-	fft_t m_fft;
+	da::RealFFT<FFT_P> m_fftPlan;
+	fft_t m_fft;  ///< Preallocated output of m_fftPlan
 	std::vector<float> m_fftLastPhase;
 	double m_peak;
-	tones_t m_tones;
+	std::vector<Peak> m_peaks;  ///< Scratch space for calcTones
+	tones_t m_newTones;  ///< Tones detected in the current step, before merging
+	tones_t m_tones;  ///< Result of the latest step
+	tones_t m_prevTones;  ///< Result of the step before (swapped with m_tones each step, so that neither is reallocated)
 	mutable double m_oldfreq;
 };
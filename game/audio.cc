@@ -8,10 +8,13 @@
 #include "game.hh"
 #include "analyzer.hh"
 #include "songs.hh"
+#include "spscqueue.hh"
+#include "trace.hh"
 #include "util.hh"
 
 #include "aubio/aubio.h"
 
+#include <algorithm>
 #include <cmath>
 #include <future>
 #include <iostream>
@@ -155,11 +158,13 @@ std::unique_ptr<aubio_tempo_t, void(*)(aubio_tempo_t*)> Audio::aubioTempo =
 
 std::recursive_mutex Audio::aubio_mutex;
 
-bool Music::operator()(float* begin, float* end) {
+bool Music::operator()(float* begin, float* end, MixerSettings const& settings) {
 	std::int64_t samples = end - begin;
 	m_clock.timeSync(durationOf(m_pos), durationOf(samples)); // Keep the clock synced
 	bool eof = true;
-	Buffer mixbuf(static_cast<size_t>(samples));
+	const float volume = m_preview ? settings.previewVolume.load() : settings.musicVolume.load();
+	// The fade advances once per stereo frame; limit the step so that an instant fade (infinite rate) saturates on the first frame.
+	const double fadeStep = clamp(fadeRate, -1.0, 1.0);
 	for (auto& kv: tracks) {
 		Track& t = *kv.second;
 // #if 0 // FIXME: Include this code bit once there is a sane pitch shifting algorithm
@@ -178,22 +183,20 @@ bool Music::operator()(float* begin, float* end) {
 //             // Otherwise just get the audio and mix it straight away
 //             } else
 // #endif
-		if (t.audioBuffer.read(mixbuf.data(), static_cast<std::int64_t>(mixbuf.size()), m_pos, static_cast<float>(t.fadeLevel))) eof = false;
+		// Track level, volume and the music fade ramp are all applied while converting the samples
+		samplemix::Gain gain{ static_cast<float>(t.fadeLevel) * volume, static_cast<float>(fadeLevel + fadeStep), static_cast<float>(fadeStep) };
+		if (t.audioBuffer.read(begin, samples, m_pos, gain)) eof = false;
 	}
 	m_pos += samples;
-	const float volume = static_cast<float>(m_preview ? config["audio/preview_volume"].ui() : config["audio/music_volume"].ui()) / 100.0f;
-	for (size_t i = 0, iend = mixbuf.size(); i != iend; ++i) {
-		if (i % 2 == 0) {
-			fadeLevel += fadeRate;
-			if (fadeLevel <= 0.0f) return false;
-			if (fadeLevel > 1.0f) { fadeLevel = 1.0f; fadeRate = 0.0f; }
-		}
-		begin[i] += static_cast<float>(mixbuf[i] * fadeLevel * volume);
+	if (samples > 0) {
+		fadeLevel += fadeStep * static_cast<double>(samples / 2);
+		if (fadeLevel <= 0.0) return false;
+		if (fadeLevel > 1.0) { fadeLevel = 1.0; fadeRate = 0.0; }
 	}
 	// suppress center channel vocals
 	if(suppressCenterChannel && !m_preview) {
 		float diffLR;
-		for (size_t i=0; i<mixbuf.size(); i+=2) {
+		for (size_t i = 0, iend = static_cast<size_t>(samples); i < iend; i += 2) {
 			diffLR = begin[i] - begin[i+1];
 			begin[i] = diffLR;
 			begin[i+1] = diffLR;
@@ -277,7 +280,8 @@ struct Sample {
 	bool eof;
   public:
 	Sample(fs::path const& filename, unsigned sr) : m_pos(), audioBuffer(filename, sr), eof(true) { }
-	void operator()(float* begin, float* end) {
+	/// Mix into output range
+	void operator()(float* begin, float* end, float volume) {
 		if(eof) {
 			// No more data to play in this sample
 			return;
@@ -287,15 +291,12 @@ struct Sample {
 			return;
 		}
 		std::int64_t size = end - begin;
-		std::vector<float> mixbuf(static_cast<size_t>(size));
-		if(!audioBuffer.read(mixbuf.data(), size, m_pos, 1.0)) {
+		samplemix::Gain gain;
+		gain.scale = volume;
+		if(!audioBuffer.read(begin, size, m_pos, gain)) {
 			eof = true;
 		}
-		const auto failVolume = static_cast<float>(config["audio/fail_volume"].ui()) / 100.0f;
-		for (size_t i = 0, iend = mixbuf.size(); i != iend; ++i) {
-			begin[i] += mixbuf[i] * failVolume;
-		}
-		m_pos += end - begin;
+		m_pos += size;
 	}
 	void reset() {
 		eof = false;
@@ -312,9 +313,8 @@ struct Synth {
 	void operator()(float* begin, float* end, double position) {
 		static double phase = 0.0;
 		for (float *i = begin; i < end; ++i) *i *= 0.3f; // Decrease music volume
-		std::int64_t size = end - begin;
 		if (end <= begin) return;
-		std::vector<float> mixbuf(static_cast<size_t>(size));
+		std::size_t size = static_cast<std::size_t>(end - begin);
 		Notes::const_iterator it = m_notes.begin();
 
 		while (it != m_notes.end() && it->end < position) ++it;
@@ -324,7 +324,7 @@ struct Synth {
 		double freq = MusicalScale().setNote(note + 4.0 * 12.0).getFreq();
 		double value = 0.0;
 		// Synthesize tones
-		for (size_t i = 0, iend = mixbuf.size(); i != iend; ++i) {
+		for (size_t i = 0; i != size; ++i) {
 			if (i % 2 == 0) {
 				value = d * 0.2 * std::sin(phase) + 0.2 * std::sin(2 * phase) + (1.0 - d) * 0.2 * std::sin(4 * phase);
 				phase += TAU * freq / srate;
@@ -335,61 +335,95 @@ struct Synth {
 };
 
 struct Command {
-	enum class Type { TRACK_FADE, TRACK_PITCHBEND, SAMPLE_RESET } type;
+	enum class Type { TRACK_FADE, TRACK_PITCHBEND, SAMPLE_RESET, SYNTH } type = Type::TRACK_FADE;
 	std::string track;
-	double factor;
+	double factor = 0.0;
+	std::unique_ptr<Synth> synth;  ///< Replacement synth for Type::SYNTH (the callback swaps the old one in, to be freed by the producer)
+	std::uint64_t generation = 0;  ///< Music::generation the command was sent for (only used by TRACK_*)
 };
 
+void MixerSettings::update() {
+	musicVolume = static_cast<float>(config["audio/music_volume"].ui()) / 100.0f;
+	previewVolume = static_cast<float>(config["audio/preview_volume"].ui()) / 100.0f;
+	failVolume = static_cast<float>(config["audio/fail_volume"].ui()) / 100.0f;
+	passthroughRatio = config["audio/pass-through_ratio"].f();
+	passthrough = config["audio/pass-through"].b();
+}
+
 /// Audio output callback wrapper. The playback Device calls this when it needs samples.
+/// Commands reach the callback through a lock-free queue and Output's own mutexes are only try-locked, so the
+/// producers never stall it. It is not lock-free as a whole: music tracks are read under each AudioBuffer's mutex
+/// (held by the decoder thread while it stores a frame) and starting preloaded music runs Music::prepare.
 struct Output {
 	std::mutex mutex;
 	std::mutex samples_mutex;
-	std::mutex synth_mutex;
-	std::unique_ptr<Synth> synth;
+	std::mutex commands_mutex;  ///< Serializes producers of commands (never locked by the callback)
+	std::unique_ptr<Synth> synth;  ///< Owned by the callback, replaced by Command::Type::SYNTH
+	bool synthEnabled = false;  ///< Producer side view of synth (guarded by commands_mutex)
+	std::uint64_t generation = 0;  ///< Generation of the most recent music (guarded by commands_mutex)
 	std::unique_ptr<Music> preloading;
 	std::vector<std::unique_ptr<Music>> playing, disposing;
 	std::vector<Analyzer*> mics;  // Used for audio pass-through
 	std::unordered_map<std::string, std::unique_ptr<Sample>> samples;
-	std::vector<Command> commands;
+	SpscQueue<Command, 256> commands;
+	MixerSettings settings;
 	std::atomic<bool> paused{ false };
-	Output(): paused(false) {}
+	Output(): paused(false) {
+		// Reserve enough that the callback does not need to grow these while moving streams around
+		playing.reserve(8);
+		disposing.reserve(8);
+	}
+
+	/// Send a command to the callback (do not call from the callback itself)
+	void send(Command cmd) {
+		std::lock_guard<std::mutex> l(commands_mutex);
+		cmd.generation = generation;
+		if (!commands.push(std::move(cmd))) SpdLogger::warn(LogSystem::AUDIO, "Audio command queue full, command dropped.");
+	}
 
-	void callbackUpdate() {
+	void callbackUpdate(bool samplesLocked) {
 		std::unique_lock<std::mutex> l(mutex, std::try_to_lock);
-		if (!l.owns_lock()) return;  // No update now, try again later (cannot stop and wait for mutex to be released)
 		// Move from preloading to playing, if ready
-		if (preloading && preloading->prepare()) {
-			SpdLogger::debug(LogSystem::AUDIO, "preload done -> playing: {}", fmt::ptr(preloading.get()));
+		if (l.owns_lock() && preloading && preloading->prepare()) {
 			if (!playing.empty()) playing[0]->fadeRate = -preloading->fadeRate;  // Fade out the old music
 			playing.insert(playing.begin(), std::move(preloading));
 		}
-		// Process commands
-		for (auto const& cmd: commands) {
-			switch (cmd.type) {
+		// Process commands (playing is only modified by this thread, so no locking is needed for them).
+		// Track commands sent before the current music was started are stale and dropped.
+		while (Command* cmd = commands.front()) {
+			bool const current = !playing.empty() && playing[0]->generation == cmd->generation;
+			switch (cmd->type) {
 			case Command::Type::TRACK_FADE:
-				if (!playing.empty()) playing[0]->trackFade(cmd.track, cmd.factor);
+				if (current) playing[0]->trackFade(cmd->track, cmd->factor);
 				break;
 			case Command::Type::TRACK_PITCHBEND:
-				if (!playing.empty()) playing[0]->trackPitchBend(cmd.track, cmd.factor);
+				if (current) playing[0]->trackPitchBend(cmd->track, cmd->factor);
 				break;
-			case Command::Type::SAMPLE_RESET:
-				auto it = samples.find(cmd.track);
+			case Command::Type::SAMPLE_RESET: {
+				if (!samplesLocked) return;  // Samples are being loaded/unloaded, try again on the next block
+				auto it = samples.find(cmd->track);
 				if (it != samples.end())
 					it->second->reset();
 				break;
 			}
+			case Command::Type::SYNTH:
+				synth.swap(cmd->synth);
+				break;
+			}
+			commands.pop();
 		}
-		commands.clear();
 	}
 
 	void callback(float* begin, float* end, double rate) {
-		callbackUpdate();
+		// samples should not be created/destroyed on the fly
+		std::unique_lock<std::mutex> samplesLock(samples_mutex, std::try_to_lock);
+		callbackUpdate(samplesLock.owns_lock());
 		std::fill(begin, end, 0.0f);
 		if (paused) return;
 		// Mix in from the streams currently playing
 		auto arrayEnd = playing.end();
 		for (auto i = playing.begin(); i != arrayEnd;) {
-			bool keep = (*i->get())(begin, end);  // Do the actual mixing
+			bool keep = (*i->get())(begin, end, settings);  // Do the actual mixing
 			std::unique_lock<std::mutex> l(mutex, std::defer_lock);
 			if (!keep && l.try_lock()) {
 				// Dispose streams no longer needed by moving them to another container (that will be cleared by another thread).
@@ -400,9 +434,9 @@ struct Output {
 			else { ++i; }
 		}
 		// Mix in microphones (if pass-through is enabled)
-		if (mics.size() > 0 && config["audio/pass-through"].b()) {
+		if (mics.size() > 0 && settings.passthrough) {
 			// Decrease music volume
-			float amp = 1.0f / config["audio/pass-through_ratio"].f();
+			float amp = 1.0f / settings.passthroughRatio;
 			if (amp != 1.0f) 
 				for (auto& s : make_iterator_range(begin, end)) 
 					s *= amp;
@@ -410,25 +444,43 @@ struct Output {
 			for (auto& m: mics) if (m) m->output(begin, end, rate);
 		}
 		// Mix in the samples currently playing
-		{
-			// samples should not be created/destroyed on the fly
-			std::unique_lock<std::mutex> l(samples_mutex, std::defer_lock);
-			if(l.try_lock()) {
-				for(auto it = samples.begin() ; it != samples.end() ; ++it) {
-					(*it->second)(begin, end);
-				}
+		if (samplesLock.owns_lock()) {
+			const float failVolume = settings.failVolume;
+			for (auto it = samples.begin(); it != samples.end(); ++it) {
+				(*it->second)(begin, end, failVolume);
 			}
 		}
 		// Mix synth if available (should be done at the end)
-		{
-			std::unique_lock<std::mutex> l(synth_mutex, std::defer_lock);
-			if(l.try_lock() && synth.get() && !playing.empty()) {
-				(*synth.get())(begin, end, playing[0]->pos());
-			}
+		if (synth && !playing.empty()) {
+			(*synth)(begin, end, playing[0]->pos());
 		}
 	}
 };
 
+void benchmarkMixer(std::vector<fs::path> const& files, unsigned frames, unsigned blocks) {
+	Output output;
+	output.settings.update();
+	for (auto const& file: files) {
+		output.samples.emplace(file.string(), std::make_unique<Sample>(file, static_cast<unsigned>(Audio::getSR())));
+	}
+	std::vector<float> outbuf(2 * frames);
+	Seconds total = 0s, worst = 0s;
+	for (unsigned block = 0; block < blocks; ++block) {
+		// Keep retriggering all samples so that they are constantly being mixed
+		if (block % 100 == 0) {
+			for (auto const& file: files) output.send({ Command::Type::SAMPLE_RESET, file.string(), 0.0, nullptr });
+		}
+		auto start = Clock::now();
+		output.callback(outbuf.data(), outbuf.data() + outbuf.size(), Audio::getSR());
+		Seconds duration = Clock::now() - start;
+		total += duration;
+		worst = std::max(worst, duration);
+	}
+	Seconds budget = 1.0s * frames / Audio::getSR();
+	std::cout << fmt::format("Mixed {} blocks of {} frames with {} samples: average {:.3f} ms, worst {:.3f} ms, budget {:.3f} ms per block.",
+	  blocks, frames, files.size(), 1e3 * total.count() / std::max(1u, blocks), 1e3 * worst.count(), 1e3 * budget.count()) << std::endl;
+}
+
 
 Device::Device(int in, int out, double rate, PaDeviceIndex dev):
   in(in), out(out), rate(rate), dev(dev),
@@ -458,6 +510,8 @@ bool Device::isChannel(std::string const& name) const {
 }
 
 int Device::operator()(float const* inbuf, float* outbuf, std::ptrdiff_t frames) try {
+	Trace::threadName("audio callback");
+	TraceScope trace("audio callback");
 	for (std::size_t i = 0; i < mics.size(); ++i) {
 		if (!mics[i]) continue;  // No analyzer? -> Channel not used
 		da::sample_const_iterator it = da::sample_const_iterator(inbuf + i, in);
@@ -574,6 +628,7 @@ struct Audio::Impl {
 		// Assign mic buffers to the output for pass-through
 		for (size_t i = 0; i < analyzers.size(); ++i)
 			output.mics.push_back(&analyzers[i]);
+		output.settings.update();
 	}
 	~Impl() {
 		// stop all audio streams befor destoying the object.
@@ -617,6 +672,10 @@ void Audio::close() {
 	self.reset();
 }
 
+void Audio::updateSettings() {
+	self->output.settings.update();
+}
+
 bool Audio::isOpen() const {
 	return !self->devices.empty();
 }
@@ -633,10 +692,7 @@ void Audio::loadSample(std::string const& streamId, fs::path const& filename) {
 }
 
 void Audio::playSample(std::string const& streamId) {
-	Output& o = self->output;
-	std::lock_guard<std::mutex> l(o.mutex);
-	Command cmd = { Command::Type::SAMPLE_RESET, streamId, 0.0 };
-	o.commands.push_back(cmd);
+	self->output.send({ Command::Type::SAMPLE_RESET, streamId, 0.0, nullptr });
 }
 
 void Audio::unloadSample(std::string const& streamId) {
@@ -654,12 +710,16 @@ void Audio::playMusic(Game& game, Audio::Files const& filenames, bool preview, d
 	for (auto& kv: filenames) fmt::format_to(std::back_inserter(logmsg), fmt::runtime("{}={}{}"), kv.first, kv.second.filename().string(), filenames.size() > 1 ? ", " : "");
 	fmt::format_to(std::back_inserter(logmsg), ") -> {}", fmt::ptr(m.get()));
 	SpdLogger::debug(LogSystem::AUDIO, logmsg);
+	{
+		// Commands still queued for the old music must not apply to this one
+		std::lock_guard<std::mutex> l(o.commands_mutex);
+		m->generation = ++o.generation;
+	}
 	// Send to audio playback thread
 	std::lock_guard<std::mutex> l(o.mutex);
 	if (o.preloading) SpdLogger::debug(LogSystem::AUDIO, "earlier music still preloading, disposing {}", fmt::ptr(o.preloading.get()));
 	o.preloading = std::move(m);
 	o.disposing.clear();  // Delete disposed streams
-	o.commands.clear();  // Remove old unprocessed commands (they should not apply to the new music)
 }
 
 void Audio::playMusic(Game& game, fs::path const& filename, bool preview, double fadeTime, double startPos) {
@@ -670,22 +730,18 @@ void Audio::playMusic(Game& game, fs::path const& filename, bool preview, double
 
 void Audio::stopMusic(Game& game) {
 	playMusic(game, Audio::Files(), false, 0.0);
-	{
-		Output& o = self->output;
-		// stop synth when music is stopped
-		std::lock_guard<std::mutex> l(o.synth_mutex);
-		o.synth.reset();
-	}
+	// stop synth when music is stopped
+	Output& o = self->output;
+	std::lock_guard<std::mutex> l(o.commands_mutex);
+	if (o.synthEnabled && o.commands.push({ Command::Type::SYNTH, std::string(), 0.0, nullptr })) o.synthEnabled = false;
 }
 
 void Audio::fadeout(Game& game, double fadeTime) {
 	playMusic(game, Audio::Files(), false, fadeTime);
-	{
-		Output& o = self->output;
-		// stop synth when music is stopped
-		std::lock_guard<std::mutex> l(o.synth_mutex);
-		o.synth.reset();
-	}
+	// stop synth when music is stopped
+	Output& o = self->output;
+	std::lock_guard<std::mutex> l(o.commands_mutex);
+	if (o.synthEnabled && o.commands.push({ Command::Type::SYNTH, std::string(), 0.0, nullptr })) o.synthEnabled = false;
 }
 
 double Audio::getPosition() const {
@@ -724,24 +780,18 @@ void Audio::pause(bool state) { self->output.paused = state; }
 bool Audio::isPaused() const { return self->output.paused; }
 
 void Audio::streamFade(std::string track, double fadeLevel) {
-	Output& o = self->output;
-	std::lock_guard<std::mutex> l(o.mutex);
-	Command cmd = { Command::Type::TRACK_FADE, track, fadeLevel };
-	o.commands.push_back(cmd);
+	self->output.send({ Command::Type::TRACK_FADE, std::move(track), fadeLevel, nullptr });
 }
 
 void Audio::streamBend(std::string track, double pitchFactor) {
-	Output& o = self->output;
-	std::lock_guard<std::mutex> l(o.mutex);
-	Command cmd = { Command::Type::TRACK_PITCHBEND, track, pitchFactor };
-	o.commands.push_back(cmd);
+	self->output.send({ Command::Type::TRACK_PITCHBEND, std::move(track), pitchFactor, nullptr });
 }
 
 void Audio::toggleSynth(Notes const& notes) {
 	Output& o = self->output;
-	std::lock_guard<std::mutex> l(o.synth_mutex);
-	if (o.synth.get()) o.synth.reset();
-	else o.synth = std::make_unique<Synth>(notes, getSR());
+	std::lock_guard<std::mutex> l(o.commands_mutex);
+	auto synth = o.synthEnabled ? nullptr : std::make_unique<Synth>(notes, getSR());
+	if (o.commands.push({ Command::Type::SYNTH, std::string(), 0.0, std::move(synth) })) o.synthEnabled = !o.synthEnabled;
 }
 
 void Audio::toggleCenterChannelSuppressor() {
@@ -5,6 +5,7 @@
 #include "notes.hh"
 #include "libda/portaudio.hpp"
 #include "aubio/aubio.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
@@ -48,6 +49,17 @@ class AudioClock {
 
 class Analyzer;
 
+/// Mixer settings cached from config so that the audio callback never needs to look them up.
+struct MixerSettings {
+	std::atomic<float> musicVolume{ 1.0f };
+	std::atomic<float> previewVolume{ 1.0f };
+	std::atomic<float> failVolume{ 1.0f };
+	std::atomic<float> passthroughRatio{ 1.0f };
+	std::atomic<bool> passthrough{ false };
+	/// Refresh from config (call from the main thread, never from the audio callback)
+	void update();
+};
+
 struct Device {
 	// Init
 	const int in, out;
@@ -90,6 +102,8 @@ class Audio {
 	~Audio();
 	void restart();
 	void close();
+	/// Refresh the cached mixer settings (volumes, pass-through) from config
+	void updateSettings();
 	std::deque<Analyzer>& analyzers();
 	std::deque<Device>& devices();
 	bool isOpen() const;
@@ -143,6 +157,9 @@ class Audio {
 	static std::unique_ptr<aubio_tempo_t, void(*)(aubio_tempo_t*)> aubioTempo;
 };
 
+/** Drive the output mixer offline (without any audio device) with the given samples and print block timings. **/
+void benchmarkMixer(std::vector<fs::path> const& samples, unsigned frames, unsigned blocks);
+
 class Music {
 	struct Track {
 		AudioBuffer audioBuffer;
@@ -164,10 +181,11 @@ class Music {
 	bool suppressCenterChannel = false;
 	double fadeLevel = 0.0;
 	double fadeRate = 0.0;
+	std::uint64_t generation = 0;  ///< Number of the playMusic call that started this (track commands sent earlier are not for it)
 	using Buffer = std::vector<float>;
 	Music(Game&, Audio::Files const& files, unsigned int sr, bool preview);
 	/// Sums the stream to output sample range, returns true if the stream still has audio left afterwards.
-	bool operator()(float* begin, float* end);
+	bool operator()(float* begin, float* end, MixerSettings const& settings);
 	void seek(double time) { m_pos = static_cast<std::int64_t>(time * srate * 2.0); }
 	/// Get the current position in seconds
 	double pos() const { return m_clock.pos().count(); }
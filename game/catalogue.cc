@@ -0,0 +1,143 @@
+#include "catalogue.hh"
+
+#include "gzip.hh"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/format.h>
+#include <functional>
+#include <numeric>
+
+namespace {
+	/// Compressing tiny bodies costs more than it saves
+	constexpr std::size_t gzipThreshold = 1024;
+
+	/// Distinguishes the ETags of different runs, as the versions start over on every start
+	std::string const& etagSalt() {
+		static std::string const salt = fmt::format("{:x}", std::chrono::system_clock::now().time_since_epoch().count());
+		return salt;
+	}
+}
+
+std::optional<Catalogue::Sort> Catalogue::parseSort(std::string_view name) {
+	if (name == "title") return Sort::TITLE;
+	if (name == "artist") return Sort::ARTIST;
+	if (name == "edition") return Sort::EDITION;
+	if (name == "language") return Sort::LANGUAGE;
+	if (name == "creator") return Sort::CREATOR;
+	return std::nullopt;
+}
+
+Catalogue::Catalogue(std::uint64_t version, std::vector<Entry> entries): m_version(version), m_entries(std::move(entries)) {
+	m_json.reserve(m_entries.size());
+	for (auto const& e: m_entries) {
+		nlohmann::json obj = {
+			{ "Title", e.title },
+			{ "Artist", e.artist },
+			{ "Edition", e.edition },
+			{ "Language", e.language },
+			{ "Creator", e.creator },
+			{ "name", e.artist + " " + e.title },
+			{ "HasError", e.hasError },
+			{ "ProvidedBy", e.providedBy },
+			{ "Comment", e.comment },
+		};
+		// Replace invalid UTF-8 rather than failing on a single badly tagged song
+		m_json.push_back(obj.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+		m_index.add(e.search);
+	}
+	auto const artist = static_cast<std::size_t>(Sort::ARTIST);
+	for (std::size_t s = 0; s < sortCount; ++s) {
+		auto& order = m_order[s];
+		order.resize(m_entries.size());
+		std::iota(order.begin(), order.end(), std::size_t{ 0 });
+		// Equal keys (e.g. songs of the same edition) are ordered by artist, and by position as the last resort
+		std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+			auto const& ka = m_entries[a].keys;
+			auto const& kb = m_entries[b].keys;
+			if (ka[s] != kb[s]) return ka[s] < kb[s];
+			if (ka[artist] != kb[artist]) return ka[artist] < kb[artist];
+			return a < b;
+		});
+		auto& rank = m_rank[s];
+		rank.resize(m_entries.size());
+		for (std::size_t i = 0; i < order.size(); ++i) rank[order[i]] = i;
+	}
+}
+
+std::optional<std::size_t> Catalogue::find(Entry const& fields) const {
+	for (std::size_t i = 0; i < m_entries.size(); ++i) {
+		Entry const& e = m_entries[i];
+		if (e.title == fields.title && e.artist == fields.artist && e.edition == fields.edition && e.language == fields.language &&
+		  e.creator == fields.creator && e.providedBy == fields.providedBy && e.comment == fields.comment) return i;
+	}
+	return std::nullopt;
+}
+
+std::string Catalogue::etag(Query const& query, bool gzip) const {
+	std::string const search = SongIndex::normalize(query.search);
+	std::size_t const hash = std::hash<std::string>()(fmt::format("{}/{}/{}/{}/{}", static_cast<unsigned>(query.sort),
+	  query.descending, query.offset, query.limit, search));
+	return fmt::format("\"{}-{}-{:x}{}\"", etagSalt(), m_version, hash, gzip ? "-gz" : "");
+}
+
+std::vector<std::size_t> Catalogue::matches(Query const& query) const {
+	SongIndex::Ids found;
+	{
+		std::lock_guard<std::mutex> l(m_searchMutex);
+		found = m_index.search(query.search);
+	}
+	auto const& rank = m_rank[static_cast<std::size_t>(query.sort)];
+	std::vector<std::size_t> ids(found.begin(), found.end());
+	std::sort(ids.begin(), ids.end(), [&](std::size_t a, std::size_t b) { return rank[a] < rank[b]; });
+	return ids;
+}
+
+std::string Catalogue::list(std::vector<std::size_t> const& ids, bool descending, std::size_t offset, std::size_t limit) const {
+	std::size_t const begin = std::min(offset, ids.size());
+	std::size_t const end = begin + std::min(limit, ids.size() - begin);
+	std::size_t bytes = 2;
+	for (std::size_t i = begin; i < end; ++i) bytes += m_json[ids[i]].size() + 1;
+	std::string out;
+	out.reserve(bytes);
+	out += '[';
+	for (std::size_t i = begin; i < end; ++i) {
+		if (i != begin) out += ',';
+		out += m_json[ids[descending ? ids.size() - 1 - i : i]];
+	}
+	out += ']';
+	return out;
+}
+
+Catalogue::Response Catalogue::get(Query const& query, bool gzip) const {
+	auto const sort = static_cast<std::size_t>(query.sort);
+	Response response;
+	if (query.search.empty() && query.offset == 0 && query.limit >= m_entries.size()) {
+		// The whole list is what clients poll for, so it is serialized once per snapshot
+		Body& body = m_lists[2 * sort + query.descending];
+		std::call_once(body.once, [&] {
+			auto json = std::make_shared<std::string const>(list(m_order[sort], query.descending, 0, m_entries.size()));
+			if (json->size() >= gzipThreshold) body.gzipped = std::make_shared<std::string const>(::gzip(*json));
+			body.json = std::move(json);
+		});
+		response.total = m_entries.size();
+		response.gzipped = gzip && body.gzipped;
+		response.body = response.gzipped ? body.gzipped : body.json;
+	} else {
+		std::string json;
+		if (query.search.empty()) {
+			response.total = m_entries.size();
+			json = list(m_order[sort], query.descending, query.offset, query.limit);
+		} else {
+			auto const ids = matches(query);
+			response.total = ids.size();
+			json = list(ids, query.descending, query.offset, query.limit);
+		}
+		response.gzipped = gzip && json.size() >= gzipThreshold;
+		response.body = std::make_shared<std::string const>(response.gzipped ? ::gzip(json) : std::move(json));
+	}
+	response.etag = etag(query, response.gzipped);
+	return response;
+}
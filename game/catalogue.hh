@@ -0,0 +1,80 @@
+#pragma once
+
+#include "songindex.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+* @short An immutable snapshot of the song library, as served by the web server.
+*
+* A new snapshot is made whenever the library changes, so requests never touch the Songs that the UI is using.
+* The sort orders are precomputed permutations and the full song list of each order is serialized to JSON (and
+* gzipped) only once, on first use. Responses have ETags derived from the snapshot version and the query, so
+* clients polling an unchanged library get a 304 instead of the list.
+**/
+class Catalogue {
+  public:
+	enum class Sort : unsigned { TITLE, ARTIST, EDITION, LANGUAGE, CREATOR };
+	static constexpr std::size_t sortCount = 5;
+	/// Parse a sort name of the web API (e.g. "artist")
+	static std::optional<Sort> parseSort(std::string_view name);
+
+	struct Entry {
+		std::string title, artist, edition, language, creator, providedBy, comment;
+		bool hasError = false;
+		std::string search;  ///< Text matched by searches
+		std::array<std::string, sortCount> keys;  ///< Collation keys by Sort (compared bytewise)
+	};
+	struct Query {
+		Sort sort = Sort::ARTIST;
+		bool descending = false;
+		std::string search;  ///< Only songs containing this (case and accent insensitive), all if empty
+		std::size_t offset = 0;
+		std::size_t limit = std::numeric_limits<std::size_t>::max();
+	};
+	struct Response {
+		std::shared_ptr<std::string const> body;  ///< JSON array of the songs
+		bool gzipped = false;  ///< The body is gzip compressed
+		std::string etag;  ///< Quoted, as sent in the ETag header
+		std::size_t total = 0;  ///< Matching songs before the offset and limit were applied
+	};
+
+	Catalogue(std::uint64_t version, std::vector<Entry> entries);
+	std::uint64_t version() const { return m_version; }
+	std::size_t size() const { return m_entries.size(); }
+	Entry const& operator[](std::size_t i) const { return m_entries[i]; }
+	/// The first entry whose text fields (all but search and keys) equal those of fields
+	std::optional<std::size_t> find(Entry const& fields) const;
+	/// The ETag of get(query, gzip), without building the response
+	std::string etag(Query const& query, bool gzip) const;
+	/// The matching songs, gzipped if allowed and worth it
+	Response get(Query const& query, bool gzip) const;
+
+  private:
+	struct Body {
+		std::once_flag once;
+		std::shared_ptr<std::string const> json, gzipped;
+	};
+	/// Ids of the entries matching the search, in ascending sort order
+	std::vector<std::size_t> matches(Query const& query) const;
+	/// JSON array of the entries ids[offset, offset + limit) (counted from the end if descending)
+	std::string list(std::vector<std::size_t> const& ids, bool descending, std::size_t offset, std::size_t limit) const;
+
+	std::uint64_t m_version;
+	std::vector<Entry> m_entries;
+	std::vector<std::string> m_json;  ///< Each entry serialized as a JSON object
+	std::array<std::vector<std::size_t>, sortCount> m_order;  ///< Entry indices in each sort order (ascending)
+	std::array<std::vector<std::size_t>, sortCount> m_rank;  ///< Position of each entry in m_order
+	SongIndex m_index;
+	mutable std::mutex m_searchMutex;  ///< SongIndex is not thread safe
+	mutable std::array<Body, 2 * sortCount> m_lists;  ///< Full lists by sort and direction, made on first use
+};
@@ -1,9 +1,31 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 
 using namespace std::literals::chrono_literals;
-using Clock = std::chrono::steady_clock;
+
+/// The steady clock, except that frame capture may replace it with a virtual time that is advanced by a fixed step
+/// every frame, making animations independent of how long rendering takes.
+struct Clock {
+	using Base = std::chrono::steady_clock;
+	using rep = Base::rep;
+	using period = Base::period;
+	using duration = Base::duration;
+	using time_point = Base::time_point;
+	static constexpr bool is_steady = true;
+	static time_point now() { return fixed() ? time_point(duration(s_time.load(std::memory_order_relaxed))) : Base::now(); }
+	/// Is the virtual time in use
+	static bool fixed() { return s_fixed.load(std::memory_order_relaxed); }
+	/// Switch to a virtual time, starting from the current time
+	static void fix() { s_time = Base::now().time_since_epoch().count(); s_fixed = true; }
+	/// Advance the virtual time
+	static void advance(duration step) { s_time += step.count(); }
+
+  private:
+	static inline std::atomic<bool> s_fixed{ false };
+	static inline std::atomic<rep> s_time{ 0 };
+};
 using Time = Clock::time_point;
 using Seconds = std::chrono::duration<double>;
 
@@ -6,6 +6,7 @@
 #include <vector>
 #include <list>
 #include <functional>
+#include <stdexcept>
 
 
 class ConfigItem {
@@ -66,6 +67,7 @@ class ConfigItem {
 	void setGetValueFunction(std::function<std::string(ConfigItem const&)> f) { m_getValue = f; }
 
   private:
+	template <typename T> friend class ConfigHandle;
 	void verifyType(std::string const& t) const; ///< throws std::logic_error if t != type
 	ConfigItem& incdec(int dir); ///< Increment/decrement by dir steps (must be -1 or 1)
 	bool isDefaultImpl(Value const& defaultValue) const;
@@ -92,3 +94,44 @@ class ConfigItem {
 };
 
 using ConfigItemMap = std::map<std::string, ConfigItem>;
+extern ConfigItemMap config; ///< All config items (see configuration.hh)
+
+/// The schema type name of the C++ type used for a ConfigItem value
+template <typename T> struct ConfigType;
+template <> struct ConfigType<bool> { static constexpr char const* name = "bool"; };
+template <> struct ConfigType<int> { static constexpr char const* name = "int"; };
+template <> struct ConfigType<unsigned short> { static constexpr char const* name = "uint"; };
+template <> struct ConfigType<float> { static constexpr char const* name = "float"; };
+template <> struct ConfigType<std::string> { static constexpr char const* name = "string"; };
+template <> struct ConfigType<ConfigItem::StringList> { static constexpr char const* name = "string_list"; };
+
+/**
+* @short Typed reference to a config item, resolved once.
+*
+* The name lookup and the type check happen when the handle is created, so reading the value
+* is just a memory access instead of a map search and a type name comparison. The handle refers
+* to the live item, so changes made by the options screen are seen immediately.
+*
+* Items are never removed from the map, so a handle stays valid once the schema has been read;
+* typically handles are function-local statics or members of screens.
+**/
+template <typename T> class ConfigHandle {
+  public:
+	/// @throws std::logic_error if the item is missing from the schema or has another type
+	explicit ConfigHandle(std::string const& name, ConfigItemMap& items = config): m_item(&lookup(name, items)) {
+		m_item->verifyType(ConfigType<T>::name);
+	}
+	T& operator*() const { return std::get<T>(m_item->value()); } ///< Access the value
+	T* operator->() const { return &**this; } ///< Access the value
+	ConfigItem& item() const { return *m_item; } ///< The item itself (e.g. for ++ or display)
+
+  private:
+	static ConfigItem& lookup(std::string const& name, ConfigItemMap& items) {
+		auto it = items.find(name);
+		if (it == items.end())
+			throw std::logic_error("Config item " + name + ", requested_type=" + ConfigType<T>::name + " used in C++ but missing from config schema");
+		return it->second;
+	}
+
+	ConfigItem* m_item;
+};
@@ -3,14 +3,21 @@
 #include "controllers.hh"
 #include "fs.hh"
 #include "portmidi.hh"
+#include "spscqueue.hh"
+#include "trace.hh"
 
 #include <fmt/format.h>
 
+#include <array>
+#include <atomic>
 #include <regex>
+#include <thread>
 #include <unordered_map>
 
 namespace input {
 
+	/// Reads all MIDI input devices on a thread of its own, so that bursts (e.g. flams on e-drums) are not
+	/// limited to one event per frame and each event keeps the time it was received by the driver.
 	class Midi: public Hardware {
 	public:
 		Midi() {
@@ -23,12 +30,17 @@ namespace input {
 					std::string name = getName(dev);
 					if (!regex_search(name, re)) continue;
 					// Now actually open the device
-					m_streams.emplace(dev, std::unique_ptr<pm::Input>(new pm::Input(dev)));
+					m_streams.emplace(dev, std::make_unique<pm::Input>(dev, &Midi::timestamp, &m_epoch));
 					SpdLogger::info(LogSystem::CONTROLLERS, "MIDI device {} opened.", name);
 				} catch (std::runtime_error& e) {
 					SpdLogger::warn(LogSystem::CONTROLLERS, "MIDI device error: {}.", e.what());
 				}
 			}
+			if (!m_streams.empty()) m_thread = std::thread([this] { run(); });
+		}
+		~Midi() override {
+			m_quit = true;
+			if (m_thread.joinable()) m_thread.join();
 		}
 		std::string getName(int dev) const override {
 			PmDeviceInfo const* info = Pm_GetDeviceInfo(dev);
@@ -36,26 +48,64 @@ namespace input {
 			return fmt::format("{}: {}", dev, info->name);
 		}
 		bool process(Event& event) override {
-			PmEvent ev;
-			for (auto it = m_streams.begin(); it != m_streams.end();++it) {
-				if (Pm_Read(*it->second, &ev, 1) != 1) continue;
-				auto evnt = static_cast<unsigned char>(Pm_MessageStatus(ev.message) & 0xF0);
-				auto note = static_cast<unsigned char>(Pm_MessageData1(ev.message));
-				auto vel  = static_cast<unsigned char>(Pm_MessageData2(ev.message));
-				unsigned chan = (ev.message & 0x0F) + 1;  // It is conventional to use one-based indexing
-				if (evnt == 0x80 /* NOTE OFF */) { evnt = static_cast<unsigned char>(0x90); vel = 0; }  // Translate NOTE OFF into NOTE ON with zero-velocity
-				if (evnt != 0x90 /* NOTE ON */) continue;  // Ignore anything that isn't NOTE ON/OFF
-				SpdLogger::info(LogSystem::CONTROLLERS, "MIDI note ON/OFF event: ch={}, note={}, vel={}", chan, unsigned(note), unsigned(vel));
-				event.value = vel / 127.0;
-				event.source = SourceId(SourceType::MIDI, it->first, chan);
-				event.hw = static_cast<unsigned>(note);
-				return true;
-			}
-			return false;
+			if (unsigned dropped = m_dropped.exchange(0)) SpdLogger::warn(LogSystem::CONTROLLERS, "MIDI input queue full, {} events dropped.", dropped);
+			Event* ev = m_events.front();
+			if (!ev) return false;
+			event = *ev;
+			m_events.pop();
+			return true;
 		}
 	private:
+		/// PortMidi time source: milliseconds since m_epoch (passed as info)
+		static PmTimestamp timestamp(void* info) {
+			auto const epoch = *static_cast<Clock::Base::time_point const*>(info);
+			return static_cast<PmTimestamp>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::Base::now() - epoch).count());
+		}
+		/// Drain all streams until asked to quit
+		void run() {
+			Trace::threadName("midi input");
+			std::array<PmEvent, 64> buffer;
+			std::unordered_map<unsigned, int> errors;  // The last read error of each device, only logged when it changes
+			while (!m_quit) {
+				for (auto& [dev, stream]: m_streams) {
+					int count;
+					while ((count = Pm_Read(*stream, buffer.data(), static_cast<std::int32_t>(buffer.size()))) > 0) {
+						for (int i = 0; i < count; ++i) push(dev, buffer[static_cast<std::size_t>(i)]);
+					}
+					int& error = errors[dev];
+					if (count < 0 && count != error) SpdLogger::warn(LogSystem::CONTROLLERS, "MIDI device {} read error: {}.", dev, Pm_GetErrorText(static_cast<PmError>(count)));
+					if (count == 0 && error < 0) SpdLogger::info(LogSystem::CONTROLLERS, "MIDI device {} reads again.", dev);
+					error = count;
+				}
+				// The driver timestamps the events, so polling only adds latency, not jitter
+				std::this_thread::sleep_for(1ms);
+			}
+		}
+		/// Translate and queue a note event
+		void push(unsigned dev, PmEvent const& ev) {
+			auto evnt = static_cast<unsigned char>(Pm_MessageStatus(ev.message) & 0xF0);
+			auto note = static_cast<unsigned char>(Pm_MessageData1(ev.message));
+			auto vel  = static_cast<unsigned char>(Pm_MessageData2(ev.message));
+			unsigned chan = (ev.message & 0x0F) + 1;  // It is conventional to use one-based indexing
+			if (evnt == 0x80 /* NOTE OFF */) { evnt = static_cast<unsigned char>(0x90); vel = 0; }  // Translate NOTE OFF into NOTE ON with zero-velocity
+			if (evnt != 0x90 /* NOTE ON */) return;  // Ignore anything that isn't NOTE ON/OFF
+			SpdLogger::debug(LogSystem::CONTROLLERS, "MIDI note ON/OFF event: ch={}, note={}, vel={}", chan, unsigned(note), unsigned(vel));
+			Event event;
+			event.value = vel / 127.0;
+			event.source = SourceId(SourceType::MIDI, dev, chan);
+			event.hw = static_cast<unsigned>(note);
+			// Convert the driver timestamp into game time (which differs from real time while capturing frames)
+			auto const received = m_epoch + std::chrono::milliseconds(ev.timestamp);
+			event.time = Clock::now() - std::max(Clock::Base::now() - received, Clock::duration::zero());
+			if (!m_events.push(std::move(event))) ++m_dropped;
+		}
 		pm::Initialize m_init;
+		Clock::Base::time_point m_epoch = Clock::Base::now();  ///< PortMidi timestamp zero
 		std::unordered_map<unsigned, std::unique_ptr<pm::Input>> m_streams;
+		SpscQueue<Event, 1024> m_events;  ///< From the MIDI thread to the main thread
+		std::atomic<unsigned> m_dropped{ 0 };
+		std::atomic<bool> m_quit{ false };
+		std::thread m_thread;
 	};
 
 	Hardware::ptr constructMidi() { return Hardware::ptr(new Midi()); }
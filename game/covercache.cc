@@ -0,0 +1,35 @@
+#include "covercache.hh"
+
+#include "log.hh"
+#include "texture.hh"
+
+#include <limits>
+
+CoverCache::CoverCache(std::size_t budget): m_textures(std::numeric_limits<std::size_t>::max(), budget) {}
+
+CoverCache::~CoverCache() {
+	SpdLogger::debug(LogSystem::IMAGE, "Cover cache: {} covers, {} MiB, {} hits, {} misses.", m_textures.size(), m_textures.cost() >> 20,
+	  m_textures.hits(), m_textures.misses());
+}
+
+Texture& CoverCache::load(Key const& key) {
+	if (auto texture = m_textures.find(key)) return **texture;
+	unsigned const maxSize = key.size == Size::FULL ? fullSize : thumbnailSize;
+	return *m_textures.insert(key, std::make_unique<Texture>(key.path, maxSize), cost(key.size));
+}
+
+Texture& CoverCache::get(fs::path const& path, Size size) {
+	if (size == Size::THUMBNAIL) {
+		auto full = m_textures.find({ path, Size::FULL });
+		if (full && !(*full)->loading()) return **full;
+		return load({ path, Size::THUMBNAIL });
+	}
+	Texture& full = load({ path, Size::FULL });
+	if (!full.loading()) return full;
+	auto thumbnail = m_textures.find({ path, Size::THUMBNAIL });
+	return thumbnail && !(*thumbnail)->loading() ? **thumbnail : full;
+}
+
+void CoverCache::prefetch(fs::path const& path, Size size) {
+	load({ path, size });
+}
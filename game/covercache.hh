@@ -0,0 +1,55 @@
+#pragma once
+
+#include "fs.hh"
+#include "lrucache.hh"
+
+#include <cstddef>
+#include <memory>
+
+class Texture;
+
+/**
+* @short Cover images for the song browser, within a memory budget.
+*
+* Covers are loaded in two resolutions: thumbnails for the small covers away from the selection and full size
+* (still limited) for the selected one. The covers that were not used for the longest time are dropped when
+* the estimated texture memory exceeds the budget. Textures load in the background, so covers that are about
+* to scroll in should be requested early with prefetch().
+**/
+class CoverCache {
+  public:
+	enum class Size { THUMBNAIL, FULL };
+	/// Longest side of the cover images in each size (larger images are shrunk while loading)
+	static constexpr unsigned thumbnailSize = 256;
+	static constexpr unsigned fullSize = 1024;
+	/// Upper bound for the texture memory of one cover (RGBA with mipmaps)
+	static constexpr std::size_t cost(Size size) {
+		std::size_t const side = size == Size::FULL ? fullSize : thumbnailSize;
+		return side * side * 4 * 4 / 3;
+	}
+
+	/// @param budget texture memory in bytes
+	explicit CoverCache(std::size_t budget);
+	~CoverCache();
+	/// The texture of the image (black until it has loaded). While a full size cover is loading, its thumbnail is
+	/// returned if that is available, and a thumbnail request is answered with the full size one if that is loaded.
+	Texture& get(fs::path const& path, Size size);
+	/// Start loading an image that will be needed soon
+	void prefetch(fs::path const& path, Size size);
+	std::size_t size() const { return m_textures.size(); }
+	/// Estimated texture memory in use
+	std::size_t bytes() const { return m_textures.cost(); }
+
+  private:
+	struct Key {
+		fs::path path;
+		Size size;
+		bool operator==(Key const& other) const { return size == other.size && path == other.path; }
+	};
+	struct KeyHash {
+		std::size_t operator()(Key const& key) const noexcept { return FsPathHash()(key.path) * 2 + (key.size == Size::FULL); }
+	};
+	Texture& load(Key const& key);
+
+	LruCache<Key, std::unique_ptr<Texture>, KeyHash> m_textures;
+};
@@ -236,8 +236,10 @@ bool DanceGraph::difficulty(DanceDifficulty level, bool check_only) {
 
 /// Handles input and some logic
 void DanceGraph::engine() {
+	static ConfigHandle<float> const controllerDelay("audio/controller_delay");
 	double time = m_audio.getPosition();
-	time -= config["audio/controller_delay"].f();
+	auto const now = Clock::now();
+	time -= *controllerDelay;
 	doUpdates();
 	// Handle stops
 	bool outsideStop = true;
@@ -281,13 +283,14 @@ void DanceGraph::engine() {
 		auto buttonId = to_underlying(ev.button.id);
 		if (buttonId < static_cast<decltype(buttonId)>(max_panels)) {
 			// Gaming controls
+			double const hitTime = eventTime(time, now, ev);  // Judge against the time of the hit rather than of this frame
 			if (ev.value == 0.0) {
 				m_pressed[buttonId] = false;
-				dance(time, ev);
+				dance(hitTime, ev);
 				m_pressed_anim[buttonId].setTarget(0.0);
 			} else if (ev.value != 0.0) {
 				m_pressed[buttonId] = true;
-				dance(time, ev);
+				dance(hitTime, ev);
 				m_pressed_anim[buttonId].setValue(1.0);
 			}
 		}
@@ -381,8 +384,7 @@ namespace {
 
 /// Draw a dance pad icon using the given texture
 void DanceGraph::drawArrow(float arrow_i, Texture& tex, float ty1, float ty2) {
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(tex.type(), tex.id());
+	glutil::DrawBatch::bindTexture(tex.type(), tex.id());
 	glutil::VertexArray va;
 	vertexPair(va, arrow_i, -arrowSize, ty1);
 	vertexPair(va, arrow_i,  arrowSize, ty2);
@@ -420,6 +422,7 @@ void DanceGraph::draw(double time) {
 				float l = static_cast<float>(m_pressed_anim[arrow_i].get());
 				m_uniforms.hitAnim = l;
 				m_uniforms.position = glmath::vec2(panel2x(static_cast<float>(arrow_i)), time2y(0.0));
+				glutil::DrawBatch::flush();
 				glBufferSubData(GL_UNIFORM_BUFFER, m_uniforms.offset(), m_uniforms.size(), &m_uniforms);
 				drawArrow(static_cast<float>(arrow_i), m_arrows_cursor);
 			}
@@ -441,10 +444,15 @@ void DanceGraph::drawBeats(double time) {
 	auto& window = m_game.getWindow();
 	UseTexture tex(window, m_beat);
 	glutil::VertexArray va;
-	float texCoord = 0.0f;
-	double tBeg = 0.0f, tEnd;
+	auto const& beats = m_song.beats;
+	auto const beatTime = [](double beat) { return beat; };
+	m_beatWindow.update(beats, time + past, time + future, beatTime, beatTime);
+	// Start from the last beat line before the window, so that the lines reach past the cursor
+	std::size_t const start = m_beatWindow.first() > 0 ? m_beatWindow.first() - 1 : 0;
+	float texCoord = static_cast<float>(start) * texCoordStep;
+	double tBeg = start > 0 ? beats[start - 1] - time : 0.0, tEnd;
 	float w = static_cast<float>(0.5f * static_cast<float>(m_pads) * getScale());
-	for (auto it = m_song.beats.begin(); it != m_song.beats.end() && tBeg < future; ++it, texCoord += texCoordStep, tBeg = tEnd) {
+	for (auto it = beats.begin() + static_cast<std::ptrdiff_t>(start); it != beats.end() && tBeg < future; ++it, texCoord += texCoordStep, tBeg = tEnd) {
 		tEnd = *it - time;
 		//if (tEnd < past) continue;
 		/*if (tEnd > future) {
@@ -492,12 +500,12 @@ void DanceGraph::drawNote(DanceNote& note, double time) {
 			if (note.releaseTime) yBeg = time2y(note.releaseTime.value() - time); // Oh noes, it got released!
 			m_uniforms.noteType = 2;
 			m_uniforms.position = glmath::vec2(x, yBeg);
+			glutil::DrawBatch::flush();
 			glBufferSubData(GL_UNIFORM_BUFFER, m_uniforms.offset(), m_uniforms.size(), &m_uniforms);
 			// Draw begin
 			drawArrow(arrow_i, m_arrows_hold, 0.0f, 1.0f/3.0f);
 			if (yEnd - yBeg > 0) {
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(m_arrows_hold.type(), m_arrows_hold.id());
+				glutil::DrawBatch::bindTexture(m_arrows_hold.type(), m_arrows_hold.id());
 				glutil::VertexArray va;
 				// Middle
 				vertexPair(va, arrow_i, arrowSize, 1.0f/3.0f);
@@ -513,6 +521,7 @@ void DanceGraph::drawNote(DanceNote& note, double time) {
 			if (mine && note.isHit) yBeg = time2y(0.0);
 			m_uniforms.noteType = (mine ? 3 : 1);
 			m_uniforms.position = glmath::vec2(x, yBeg);
+			glutil::DrawBatch::flush();
 			glBufferSubData(GL_UNIFORM_BUFFER, m_uniforms.offset(), m_uniforms.size(), &m_uniforms);
 			drawArrow((mine ? -1 : arrow_i), (mine ? m_mine : m_arrows));
 		}
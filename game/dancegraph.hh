@@ -1,6 +1,7 @@
 #pragma once
 
 #include "instrumentgraph.hh"
+#include "timewindow.hh"
 
 #include <optional>
 
@@ -64,6 +65,7 @@ class DanceGraph: public InstrumentGraph {
 	DanceNotes m_notes; /// contains the dancing notes for current game mode and difficulty
 	DanceNotes::iterator m_notesIt; /// the first note that hasn't gone away yet
 	DanceNotes::iterator m_activeNotes[max_panels]; /// hold notes that are currently pressed down
+	TimeWindow m_beatWindow; /// beat lines on screen
 
 	// Textures
 	Texture m_beat;
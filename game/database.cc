@@ -6,33 +6,59 @@
 #include "i18n.hh"
 
 #include <iostream>
+#include <map>
+#include <mutex>
 
-Database::Database(fs::path const& filename): m_filename(filename) {
+Database::Database(fs::path const& filename): m_filename(filename), m_store(fs::path(filename).replace_extension(".bin")) {
 	load();
 }
 
 Database::~Database() {
 	save();
+	if (config["game/database_xml"].b()) exportXml(m_filename);
 }
 
 void Database::load() {
+	if (m_store.exists()) {
+		try {
+			loadStore();
+			SpdLogger::info(LogSystem::DATABASE, "Loaded {} players, {} songs, and {} hiscores from {}.", m_players.count(), m_songs.size(), m_hiscores.size(), m_store.filename());
+			return;
+		} catch (std::exception const& e) {
+			fs::path const bad = m_store.filename().string() + ".bad";
+			SpdLogger::error(LogSystem::DATABASE, "Error loading file={}, error={}. Moving it to {}.", m_store.filename(), e.what(), bad);
+			std::error_code ec;
+			fs::rename(m_store.filename(), bad, ec);
+		}
+	}
 	if (!exists(m_filename)) return;
 	try {
-		xmlpp::DomParser domParser(m_filename.string());
-		xmlpp::Node* nodeRoot = domParser.get_document()->get_root_node();
-		m_players.load(nodeRoot->find("/performous/players/player"));
-		m_songs.load(nodeRoot->find("/performous/songs/song"));
-		m_hiscores.load(nodeRoot->find("/performous/hiscores/hiscore"));
+		importXml(m_filename);
 		SpdLogger::info(LogSystem::DATABASE, "Loaded {} players, {} songs, and {} hiscores from {}.", m_players.count(), m_songs.size(), m_hiscores.size(), m_filename);
+		compact();  // Convert into the journal
 	} catch (std::exception const& e) {
 		SpdLogger::error(LogSystem::DATABASE, "Error loading file={}, error={}", m_filename, e.what());
 	}
 }
 
 void Database::save() {
+	std::unique_lock<std::shared_mutex> l(m_mutex);
+	storePlayers();
+	m_songs.forEach([this](SongItem const& item) { storeSong(item); });
+}
+
+void Database::importXml(fs::path const& filename) {
+	xmlpp::DomParser domParser(filename.string());
+	xmlpp::Node* nodeRoot = domParser.get_document()->get_root_node();
+	m_players.load(nodeRoot->find("/performous/players/player"));
+	m_songs.load(nodeRoot->find("/performous/songs/song"));
+	m_hiscores.load(nodeRoot->find("/performous/hiscores/hiscore"));
+}
+
+void Database::exportXml(fs::path const& filename) {
 	try {
-		create_directories(m_filename.parent_path());
-		fs::path tmp = m_filename.string() + ".tmp";
+		create_directories(filename.parent_path());
+		fs::path tmp = filename.string() + ".tmp";
 		{
 			xmlpp::Document doc;
 			auto nodeRoot = doc.create_root_node("performous");
@@ -41,14 +67,66 @@ void Database::save() {
 			m_hiscores.save(xmlpp::add_child_element(nodeRoot, "hiscores"));
 			doc.write_to_file_formatted(tmp.string(), "UTF-8");
 		}
-		rename(tmp, m_filename);
-		SpdLogger::info(LogSystem::DATABASE, "Saved {} players, {} songs, and {} hiscores to {}.", m_players.count(), m_songs.size(), m_hiscores.size(), m_filename);
+		rename(tmp, filename);
+		SpdLogger::info(LogSystem::DATABASE, "Saved {} players, {} songs, and {} hiscores to {}.", m_players.count(), m_songs.size(), m_hiscores.size(), filename);
 	} catch (std::exception const& e) {
-		SpdLogger::error(LogSystem::DATABASE, "Error saving file={}, error={}.", m_filename, e.what());
+		SpdLogger::error(LogSystem::DATABASE, "Error saving file={}, error={}.", filename, e.what());
 		return;
 	}
 }
 
+void Database::loadStore() {
+	auto const records = m_store.load();
+	// A later record replaces an earlier one with the same id
+	std::map<PlayerId, DatabaseStore::Player const*> players;
+	std::map<SongId, DatabaseStore::Song const*> songs;
+	for (auto const& record: records) {
+		if (auto player = std::get_if<DatabaseStore::Player>(&record)) players[player->id] = player;
+		else if (auto song = std::get_if<DatabaseStore::Song>(&record)) songs[song->id] = song;
+	}
+	for (auto const& [id, player]: players) m_players.addPlayer(player->name, player->picture, id);
+	for (auto const& [id, song]: songs) m_songs.restoreSongItem(song->artist, song->title, song->broken, id);
+	// Replayed in the order they were added, so the same scores pass reachedHiscore as back then
+	for (auto const& record: records) {
+		if (auto hiscore = std::get_if<HiscoreItem>(&record)) m_hiscores.addHiscore(HiscoreItem(*hiscore));
+	}
+	markStored();
+	// Compact when most of the journal has been superseded
+	std::size_t const live = players.size() + songs.size() + m_hiscores.size();
+	if (records.size() > 2 * live + 1000) compact();
+}
+
+void Database::compact() {
+	DatabaseStore::Records records;
+	records.reserve(m_songs.size() + m_hiscores.size());
+	m_players.forEach([&](PlayerItem const& player) { records.emplace_back(DatabaseStore::Player{player.id, player.name, player.picture.string()}); });
+	m_songs.forEach([&](SongItem const& song) { records.emplace_back(DatabaseStore::Song{song.id, song.artist, song.title, song.isBroken()}); });
+	m_hiscores.forEach([&](HiscoreItem const& hiscore) { records.emplace_back(hiscore); });
+	m_store.rewrite(records);
+	markStored();
+}
+
+void Database::markStored() {
+	m_storedPlayers.clear();
+	m_players.forEach([this](PlayerItem const& player) { m_storedPlayers.insert(player.id); });
+	m_storedSongs.clear();
+	m_songs.forEach([this](SongItem const& song) { m_storedSongs[song.id] = song.isBroken(); });
+}
+
+void Database::storePlayers() {
+	m_players.forEach([this](PlayerItem const& player) {
+		if (m_storedPlayers.insert(player.id).second) m_store.append(DatabaseStore::Player{player.id, player.name, player.picture.string()});
+	});
+}
+
+void Database::storeSong(SongItem const& item) {
+	bool const broken = item.isBroken();
+	auto const [it, inserted] = m_storedSongs.try_emplace(item.id, broken);
+	if (!inserted && it->second == broken) return;
+	it->second = broken;
+	m_store.append(DatabaseStore::Song{item.id, item.artist, item.title, broken});
+}
+
 void Database::addPlayer(std::string const& name, std::string const& picture, std::optional<PlayerId> id) {
 	m_players.addPlayer(name, picture, id);
 }
@@ -58,10 +136,12 @@ Players const& Database::getPlayers() const {
 }
 
 void Database::addSong(std::shared_ptr<Song> s) {
+	std::unique_lock<std::shared_mutex> l(m_mutex);
 	m_songs.addSong(s);
 }
 
 void Database::addHiscore(std::shared_ptr<Song> s) {
+	std::unique_lock<std::shared_mutex> l(m_mutex);
 	auto maybe_playerid = m_players.lookup(m_players.current().name);
 	if (!maybe_playerid.has_value()) {
 		SpdLogger::error(LogSystem::DATABASE, "Cannot find player id for player={}", m_players.current().name);
@@ -76,11 +156,18 @@ void Database::addHiscore(std::shared_ptr<Song> s) {
 		return;
 	}
 	unsigned short level = config["game/difficulty"].ui();
-	m_hiscores.addHiscore(score, playerid, songid.value(), level, track);
+	HiscoreItem item{score, playerid, songid.value(), level, track};
+	if (m_hiscores.addHiscore(HiscoreItem(item))) {
+		// Make sure the journal knows the player and the song before the score
+		storePlayers();
+		if (auto const songItem = m_songs.getItem(songid.value())) storeSong(*songItem);
+		m_store.append(item);
+	}
 	SpdLogger::info(LogSystem::DATABASE, "Added new hiscore. Score={} on track={} for song id={}, on level={}", score, track, songid.value(), level);
 }
 
 bool Database::reachedHiscore(std::shared_ptr<Song> s) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	unsigned score = scores.front().score;
 	const auto track = scores.front().track;
 	const auto songid = m_songs.lookup(s);
@@ -93,6 +180,7 @@ bool Database::reachedHiscore(std::shared_ptr<Song> s) const {
 }
 
 std::vector<HiscoreItem> Database::queryPerSongHiscore(std::shared_ptr<Song> s, std::string const& track) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	auto const maybe_songid = m_songs.lookup(s);
 
 	if (!maybe_songid) {
@@ -105,6 +193,7 @@ std::vector<HiscoreItem> Database::queryPerSongHiscore(std::shared_ptr<Song> s,
 }
 
 bool Database::hasHiscore(Song const& s) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	try {
 		return m_hiscores.hasHiscore(m_songs.lookup(s).value());
 	} catch (const std::exception&) {
@@ -113,6 +202,7 @@ bool Database::hasHiscore(Song const& s) const {
 }
 
 unsigned Database::getHiscore(Song const& s) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	try {
 		const auto songid = m_songs.lookup(s);
 		return m_hiscores.getHiscore(songid.value());
@@ -122,6 +212,7 @@ unsigned Database::getHiscore(Song const& s) const {
 }
 
 unsigned Database::getHiscore(SongPtr const& s) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	try {
 		auto const songid = m_songs.getSongId(s);
 
@@ -133,6 +224,7 @@ unsigned Database::getHiscore(SongPtr const& s) const {
 }
 
 std::vector<HiscoreItem> Database::getHiscores(SongPtr const& s) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
 	try {
 		auto const songid = m_songs.getSongId(s);
 
@@ -143,3 +235,10 @@ std::vector<HiscoreItem> Database::getHiscores(SongPtr const& s) const {
 	}
 }
 
+std::vector<Hiscore::SongStats> Database::getHiscoreStats(SongCollection const& songs) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
+	std::vector<std::optional<SongId>> songids;
+	songids.reserve(songs.size());
+	for (auto const& song: songs) songids.push_back(m_songs.findSongId(song));
+	return m_hiscores.getStats(songids);
+}
@@ -2,14 +2,18 @@
 
 #include "color.hh"
 #include "controllers.hh"
+#include "database_store.hh"
 #include "fs.hh"
 #include "hiscore.hh"
 #include "players.hh"
 #include "scoreitem.hh"
 #include "songitems.hh"
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <ostream>
+#include <unordered_map>
+#include <unordered_set>
 
 /**Access to a database for performous which holds
   Player-, Hiscore-, Song-, Track- and (in future)
@@ -20,6 +24,11 @@
   Will be initialized at the very beginning of
   the program.
 
+  The data is kept in a binary journal (DatabaseStore) next to
+  the XML file, so that changes are cheap appends. The XML file
+  is still imported when there is no journal yet, and exported
+  on exit if the game/database_xml option is set.
+
   The current lists (Players and scores) are used
   to pass the information which players have won
   to the ScoreScreen and then to the players window.
@@ -29,6 +38,7 @@ public:
 	/**Will try to load the database.
 	  If it does not succeed the error will be ignored.
 	  Only some information will be printed on stderr.
+	  @param filename of the XML database; the journal uses the same name with the extension .bin
 	  */
 	Database(fs::path const& filename);
 	/**Will try to save the database.
@@ -37,19 +47,25 @@ public:
 	  */
 	~Database();
 
+	/**Loads the whole database from the journal, or imports the XML file if there is no journal yet.
+	  Errors are logged.
+	  @post filled database
+	  */
+	void load();
+	/**Writes new players and changed songs to the journal (hiscores are written when they are added).
+	  The writing itself happens in the background.
+	*/
+	void save();
 	/**Loads the whole database from xml.
 	  @exception bad_cast may be thrown if xml element is not of correct type
 	  @exception xmlpp exceptions may be thrown on any parse errors
 	  @exception PlayersException if some conditions of players fail (e.g. no id)
 	  @exception HiscoreException if some hiscore conditions fail (e.g. score too high)
 	  @exception SongItemsExceptions if some songs conditions fail (e.g. no id)
-	  @post filled database
 	  */
-	void load();
-	/**Saves the whole database to xml.
-	  Will write out everything to the file given in the constructor, @see file()
-	*/
-	void save();
+	void importXml(fs::path const& filename);
+	/**Saves the whole database to xml. Errors are logged.*/
+	void exportXml(fs::path const& filename);
 
 	friend class ScreenHiscore;
 	friend class ScreenPlayers;
@@ -91,12 +107,31 @@ public: // methods for database queries
 	unsigned getHiscore(Song const& s) const;
 	unsigned getHiscore(SongPtr const& s) const;
 	std::vector<HiscoreItem> getHiscores(SongPtr const& s) const;
+	/**Hiscore aggregates of all the songs on the current level, in the same order.
+	  Songs that are not in the database get zeros.
+	 */
+	std::vector<Hiscore::SongStats> getHiscoreStats(SongCollection const& songs) const;
 	bool noPlayers() const;
 
 private:
+	void loadStore();
+	/// Replace the journal with a snapshot of the current data
+	void compact();
+	/// Remember that the journal has everything as it is now
+	void markStored();
+	void storePlayers();
+	void storeSong(SongItem const& item);
+
 	fs::path m_filename;
 
+	/// Songs are added by the song loader and read by the song filter thread (hiscore sort orders),
+	/// so the public methods that touch the songs or the hiscores hold this
+	mutable std::shared_mutex m_mutex;
 	Players m_players;
 	Hiscore m_hiscores;
 	SongItems m_songs;
+
+	DatabaseStore m_store;
+	std::unordered_set<PlayerId> m_storedPlayers;  ///< Players in the journal
+	std::unordered_map<SongId, bool> m_storedSongs;  ///< Songs in the journal, with their broken flag
 };
@@ -0,0 +1,245 @@
+#include "database_store.hh"
+
+#include "log.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+	constexpr char header[] = "PERFDB\x01\n";
+	constexpr std::size_t headerSize = sizeof(header) - 1;
+	/// Record framing: type (1 byte), payload size (4), payload, checksum of type and payload (4)
+	constexpr std::size_t frameSize = 9;
+	enum class Type : std::uint8_t { PLAYER = 1, SONG = 2, HISCORE = 3 };
+
+	/// FNV-1a
+	std::uint32_t checksum(char const* data, std::size_t size) {
+		std::uint32_t hash = 2166136261u;
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	/// Little-endian serialization
+	class Writer {
+	  public:
+		explicit Writer(std::string& out): m_out(out) {}
+		template <typename T> void integer(T value) {
+			auto const bits = static_cast<std::uint64_t>(value);
+			for (std::size_t i = 0; i < sizeof(T); ++i) m_out += static_cast<char>(bits >> (8 * i) & 0xFF);
+		}
+		void string(std::string const& str) {
+			integer(static_cast<std::uint32_t>(str.size()));
+			m_out += str;
+		}
+	  private:
+		std::string& m_out;
+	};
+
+	class Reader {
+	  public:
+		Reader(char const* begin, char const* end): m_pos(begin), m_end(end) {}
+		template <typename T> T integer() {
+			need(sizeof(T));
+			std::uint64_t bits = 0;
+			for (std::size_t i = 0; i < sizeof(T); ++i) bits |= std::uint64_t(static_cast<unsigned char>(m_pos[i])) << (8 * i);
+			m_pos += sizeof(T);
+			return static_cast<T>(bits);
+		}
+		std::string string() {
+			auto const size = integer<std::uint32_t>();
+			need(size);
+			std::string str(m_pos, size);
+			m_pos += size;
+			return str;
+		}
+		bool atEnd() const { return m_pos == m_end; }
+	  private:
+		void need(std::size_t size) const {
+			if (static_cast<std::size_t>(m_end - m_pos) < size) throw std::runtime_error("Truncated record");
+		}
+		char const* m_pos;
+		char const* m_end;
+	};
+
+	void encode(std::string& out, DatabaseStore::Record const& record) {
+		std::size_t const begin = out.size();
+		Writer w(out);
+		w.integer(std::uint8_t());  // Type and size are filled in below
+		w.integer(std::uint32_t());
+		Type type;
+		if (auto player = std::get_if<DatabaseStore::Player>(&record)) {
+			type = Type::PLAYER;
+			w.integer(std::uint32_t(player->id));
+			w.string(player->name);
+			w.string(player->picture);
+		} else if (auto song = std::get_if<DatabaseStore::Song>(&record)) {
+			type = Type::SONG;
+			w.integer(std::uint32_t(song->id));
+			w.string(song->artist);
+			w.string(song->title);
+			w.integer(std::uint8_t(song->broken));
+		} else {
+			auto const& hiscore = std::get<HiscoreItem>(record);
+			type = Type::HISCORE;
+			w.integer(std::uint32_t(hiscore.score));
+			w.integer(std::uint32_t(hiscore.playerid));
+			w.integer(std::uint32_t(hiscore.songid));
+			w.integer(std::uint16_t(hiscore.level));
+			w.string(hiscore.track);
+			w.integer(std::int64_t(hiscore.unixtime.count()));
+		}
+		auto const size = static_cast<std::uint32_t>(out.size() - begin - 5);
+		out[begin] = static_cast<char>(type);
+		for (std::size_t i = 0; i < 4; ++i) out[begin + 1 + i] = static_cast<char>(size >> (8 * i) & 0xFF);
+		// The checksum covers the type and the payload
+		std::uint32_t const sum = checksum(out.data() + begin, 1) ^ checksum(out.data() + begin + 5, size);
+		w.integer(sum);
+	}
+
+	/// Decode a payload. @return false for unknown record types (written by a newer version)
+	bool decode(Type type, Reader& r, DatabaseStore::Records& records) {
+		switch (type) {
+		  case Type::PLAYER: {
+			DatabaseStore::Player player;
+			player.id = r.integer<std::uint32_t>();
+			player.name = r.string();
+			player.picture = r.string();
+			records.emplace_back(std::move(player));
+			return true;
+		  }
+		  case Type::SONG: {
+			DatabaseStore::Song song;
+			song.id = r.integer<std::uint32_t>();
+			song.artist = r.string();
+			song.title = r.string();
+			song.broken = r.integer<std::uint8_t>() != 0;
+			records.emplace_back(std::move(song));
+			return true;
+		  }
+		  case Type::HISCORE: {
+			auto const score = r.integer<std::uint32_t>();
+			auto const playerid = r.integer<std::uint32_t>();
+			auto const songid = r.integer<std::uint32_t>();
+			auto const level = r.integer<std::uint16_t>();
+			auto track = r.string();
+			auto const unixtime = std::chrono::seconds(r.integer<std::int64_t>());
+			records.emplace_back(HiscoreItem(score, playerid, songid, level, track, unixtime));
+			return true;
+		  }
+		}
+		return false;
+	}
+}
+
+DatabaseStore::DatabaseStore(fs::path const& filename): m_filename(filename), m_thread([this] { writer(); }) {}
+
+DatabaseStore::~DatabaseStore() {
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_quit = true;
+	}
+	m_cond.notify_all();
+	m_thread.join();
+}
+
+bool DatabaseStore::exists() const {
+	std::error_code ec;
+	return fs::exists(m_filename, ec);
+}
+
+DatabaseStore::Records DatabaseStore::load() {
+	flush();
+	std::string data;
+	{
+		std::ifstream f(m_filename, std::ios::binary);
+		if (!f) throw std::runtime_error("Cannot open " + m_filename.string());
+		data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+	if (data.compare(0, headerSize, header, headerSize) != 0) throw std::runtime_error("Not a database file: " + m_filename.string());
+	Records records;
+	records.reserve(data.size() / 40);  // Roughly the size of a hiscore record
+	std::size_t pos = headerSize;
+	while (pos < data.size()) {
+		try {
+			if (data.size() - pos < frameSize) throw std::runtime_error("Truncated record");
+			Reader frame(data.data() + pos, data.data() + data.size());
+			auto const type = static_cast<Type>(frame.integer<std::uint8_t>());
+			auto const size = frame.integer<std::uint32_t>();
+			if (data.size() - pos - frameSize < size) throw std::runtime_error("Truncated record");
+			char const* payload = data.data() + pos + 5;
+			Reader checksumReader(payload + size, payload + size + 4);
+			if (checksumReader.integer<std::uint32_t>() != (checksum(data.data() + pos, 1) ^ checksum(payload, size))) throw std::runtime_error("Checksum mismatch");
+			Reader r(payload, payload + size);
+			if (!decode(type, r, records)) SpdLogger::warning(LogSystem::DATABASE, "Skipping unknown record type={} in file={}", static_cast<unsigned>(type), m_filename);
+			else if (!r.atEnd()) throw std::runtime_error("Malformed record");
+			pos += frameSize + size;
+		} catch (std::exception const& e) {
+			// Most likely a write interrupted by a crash; cut it off so that new records can be appended
+			SpdLogger::warning(LogSystem::DATABASE, "Damaged record at offset={} in file={}, error={}. Discarding the rest of the file.", pos, m_filename, e.what());
+			fs::resize_file(m_filename, pos);
+			break;
+		}
+	}
+	return records;
+}
+
+void DatabaseStore::append(Record const& record) {
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		encode(m_pending, record);
+	}
+	m_cond.notify_all();
+}
+
+void DatabaseStore::rewrite(Records const& records) {
+	std::unique_lock<std::mutex> l(m_mutex);
+	m_cond.wait(l, [this] { return m_pending.empty() && !m_writing; });
+	std::string data(header, headerSize);
+	for (auto const& record: records) encode(data, record);
+	if (m_filename.has_parent_path()) create_directories(m_filename.parent_path());
+	fs::path tmp = m_filename.string() + ".tmp";
+	{
+		std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+		f.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!f.flush()) throw std::runtime_error("Cannot write " + tmp.string());
+	}
+	rename(tmp, m_filename);
+}
+
+void DatabaseStore::flush() {
+	std::unique_lock<std::mutex> l(m_mutex);
+	m_cond.wait(l, [this] { return m_pending.empty() && !m_writing; });
+}
+
+void DatabaseStore::writer() {
+	std::unique_lock<std::mutex> l(m_mutex);
+	while (true) {
+		m_cond.wait(l, [this] { return m_quit || !m_pending.empty(); });
+		if (m_pending.empty()) return;  // Quit once everything is written
+		std::string data;
+		data.swap(m_pending);
+		m_writing = true;
+		{
+			UnlockGuard<decltype(l)> unlocked(l);  // Appending continues while writing
+			try {
+				std::error_code ec;
+				bool const created = !fs::exists(m_filename, ec) || fs::file_size(m_filename, ec) == 0;
+				if (created && m_filename.has_parent_path()) create_directories(m_filename.parent_path());
+				std::ofstream f(m_filename, std::ios::binary | std::ios::app);
+				if (created) f.write(header, headerSize);
+				f.write(data.data(), static_cast<std::streamsize>(data.size()));
+				if (!f.flush()) throw std::runtime_error("Write failed");
+			} catch (std::exception const& e) {
+				SpdLogger::error(LogSystem::DATABASE, "Error writing file={}, error={}", m_filename, e.what());
+			}
+		}
+		m_writing = false;
+		m_cond.notify_all();
+	}
+}
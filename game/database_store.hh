@@ -0,0 +1,68 @@
+#pragma once
+
+#include "fs.hh"
+#include "hiscoreitem.hh"
+#include "player.hh"
+#include "songitemindex.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+/**
+ * Binary, append-only storage of the database.
+ *
+ * The file is a journal of records, each with its own checksum. A record with an id that was seen
+ * before replaces the earlier one (players, songs), hiscores are simply added. Appending is O(1) and
+ * done by a background thread, so that recording a score never blocks the caller. A crash can at most
+ * lose the record that was being written; the damaged tail is detected and cut off on the next load.
+ * rewrite() replaces the journal with a compact snapshot (atomically, through a temporary file).
+ */
+class DatabaseStore {
+  public:
+	struct Player {
+		PlayerId id = 0;
+		std::string name;
+		std::string picture;
+	};
+	struct Song {
+		SongId id = 0;
+		std::string artist;
+		std::string title;
+		bool broken = false;
+	};
+	using Record = std::variant<Player, Song, HiscoreItem>;
+	using Records = std::vector<Record>;
+
+	explicit DatabaseStore(fs::path const& filename);
+	DatabaseStore(DatabaseStore const&) = delete;
+	DatabaseStore& operator=(DatabaseStore const&) = delete;
+	/// Finishes all queued writes
+	~DatabaseStore();
+
+	fs::path const& filename() const { return m_filename; }
+	bool exists() const;
+	/// Read all records in the order they were written. @throw std::runtime_error if this is not a database file
+	Records load();
+	/// Queue a record to be appended
+	void append(Record const& record);
+	/// Replace the whole file with these records
+	void rewrite(Records const& records);
+	/// Wait until all queued records are written
+	void flush();
+
+  private:
+	void writer();
+
+	fs::path m_filename;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::string m_pending;  ///< Encoded records waiting to be written
+	bool m_writing = false;
+	bool m_quit = false;
+	std::thread m_thread;
+};
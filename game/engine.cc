@@ -5,13 +5,24 @@
 #include "song.hh"
 #include "database.hh"
 #include "configuration.hh"
+#include "trace.hh"
+#include <algorithm>
 #include <iostream>
 #include <list>
 
 const double Engine::TIMESTEP = 0.01;
 
+namespace {
+	/// One thread per analyzer beyond the first (the engine thread analyzes too), limited by the number of cores
+	unsigned analysisThreads(std::size_t analyzers) {
+		if (analyzers == 0) return 0;
+		std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+		return static_cast<unsigned>(std::min(analyzers, cores) - 1);
+	}
+}
+
 Engine::Engine(Audio& audio, VocalTrackPtrs vocals, Database& database):
-  m_audio(audio), m_time(), m_quit(), m_database(database)
+  m_audio(audio), m_time(), m_quit(), m_database(database), m_analysis(analysisThreads(vocals.size()))
 {
 	auto& analyzers = m_audio.analyzers();
 	if (analyzers.size() != vocals.size()) throw std::logic_error("Engine requires the same number of vocal tracks as there are analyzers.");
@@ -25,16 +36,24 @@ Engine::Engine(Audio& audio, VocalTrackPtrs vocals, Database& database):
 		m_database.cur.push_back(Player(*vocals[i], a, frames));
 		++i;
 	}
+	for (Player& player: m_database.cur) m_players.push_back(&player);
 	m_thread.reset(new std::thread(std::ref(*this)));
 }
 
 void Engine::operator()() {
+	ConfigHandle<float> const roundTrip("audio/round-trip");
+	Trace::threadName("engine");
 	while (!m_quit) {
-		for (Player& player: m_database.cur) player.prepare();
-		double t = m_audio.getPosition() - config["audio/round-trip"].f();
+		// Each analyzer is only touched by one job, so the results do not depend on the scheduling
+		{
+			TraceScope trace("analyze");
+			m_analysis.run(m_players.size(), [this](std::size_t i) { m_players[i]->prepare(); });
+		}
+		double t = m_audio.getPosition() - *roundTrip;
 		double timeLeft = m_time - t;
 		if (timeLeft != timeLeft || timeLeft > 1.0) timeLeft = 1.0;  // FIXME: Workaround for NaN values and other weirdness (should fix the weirdness instead)
 		if (timeLeft > 0.0) { std::this_thread::sleep_for(std::min(TIMESTEP, timeLeft) * 1s); continue; }
+		TraceScope trace("score");
 		for (Player& player: m_database.cur) player.update();
 		m_time += TIMESTEP;
 	}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "workerpool.hh"
+
 #include <atomic>
 #include <memory>
 #include <thread>
@@ -7,6 +9,7 @@
 
 class Audio;
 class Database;
+class Player;
 class VocalTrack;
 
 /// performous engine
@@ -15,6 +18,8 @@ class Engine {
 	double m_time;
 	std::atomic<bool> m_quit{ false };
 	Database& m_database;
+	std::vector<Player*> m_players;
+	WorkerPool m_analysis;  ///< Runs the pitch analysis of all players in parallel
 	std::unique_ptr<std::thread> m_thread;
 
   public:
@@ -26,10 +26,12 @@ class FBO {
 	}
 	/// Bind the FBO into use
 	void bind() {
+		glutil::DrawBatch::flush();
 		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
 	}
 	/// Unbind any FBO
 	static void unbind() {
+		glutil::DrawBatch::flush();
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 	void resize(float w, float h) {
@@ -41,6 +43,7 @@ class FBO {
 	float height() const { return m_h; }
 	void update() {
 		{
+			glutil::DrawBatch::flush();
 			UseTexture tex(m_window, m_texture);
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(m_w), static_cast<GLsizei>(m_h), 0, GL_RGBA, GL_FLOAT, nullptr);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
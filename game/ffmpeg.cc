@@ -4,10 +4,12 @@
 #include "config.hh"
 #include "log.hh"
 #include "screen_songs.hh"
+#include "trace.hh"
 #include "util.hh"
 
 #include "aubio/aubio.h"
 
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
@@ -26,6 +28,7 @@ extern "C" {
 #include <libswresample/swresample.h>
 #include <libavutil/avutil.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 #include <libavutil/mathematics.h>
 #include <libavutil/error.h>
 #include <libavutil/replaygain.h>
@@ -96,7 +99,7 @@ void AudioBuffer::operator()(const std::int16_t *data, std::int64_t count, std::
 
 bool AudioBuffer::prepare(std::int64_t pos) {
 	// perform fake read to trigger any potential seek
-	if (!read(nullptr, 0, pos, 1)) return true;
+	if (!read(nullptr, 0, pos)) return true;
 
 	std::unique_lock<std::mutex> l(m_mutex);
 	// Has enough been prebuffered already and is the requested position still within buffer
@@ -105,20 +108,16 @@ bool AudioBuffer::prepare(std::int64_t pos) {
 }
 
 // pos may be negative because upper layer may request 'extra time' before
-// starting the play back. In this case, the buffer is filled of zero.
+// starting the play back. In this case, nothing is mixed for those samples.
 //
-bool AudioBuffer::read(float* begin, std::int64_t samples, std::int64_t pos, float volume) {
+bool AudioBuffer::read(float* begin, std::int64_t samples, std::int64_t pos, samplemix::Gain gain) {
 	if (pos < 0) {
-		std::int64_t negative_samples;
-		if (samples + pos > 0) negative_samples = samples - (samples + pos);
-		else negative_samples = samples;
-
-		// put zeros to negative positions
-		std::fill(begin, begin + negative_samples, 0);
-
+		std::int64_t negative_samples = std::min(samples, -pos);
 		if (negative_samples == samples) return true;
 
 		// if there are remaining samples to read in positive land, do the 'normal' read
+		begin += negative_samples;
+		gain = gain.advanced(static_cast<std::size_t>(negative_samples));
 		pos = 0;
 		samples -= negative_samples;
 	}
@@ -127,11 +126,10 @@ bool AudioBuffer::read(float* begin, std::int64_t samples, std::int64_t pos, flo
 	if (eof(pos + samples) || m_quit)
 		return false;
 
-
 	if ( m_replayGainDecibels != 0.0 )  // If Replay Gain is defined at all
 	{
 		// A replay gain was defined, apply the linear gain factor and the volume to the samples
-		volume *= static_cast<float>(m_replayGainFactor);
+		gain.scale *= static_cast<float>(m_replayGainFactor);
 	}
 
 	// one cannot read more data than the size of buffer
@@ -141,17 +139,21 @@ bool AudioBuffer::read(float* begin, std::int64_t samples, std::int64_t pos, flo
 		// in case request position is not in the current possible range, we trigger a seek
 		// Note: m_write_pos is not checked on purpose: if pos is after
 		// m_write_pos, zeros present in buffer will be returned
-		std::fill(begin, begin + samples, 0);
 		m_read_pos = pos + samples;
 		m_seek_asked = true;
 		std::fill(m_data.begin(), m_data.end(), 0);
 		m_cond.notify_all();
 		return true;
 	}
+	if (samples == 0) return true;
 
-	for (std::int64_t s = 0; s < samples; ++s) {
-		begin[s] += volume * da::conv_from_s16(m_data[static_cast<size_t>((m_read_pos + s)) % m_data.size()]);
-	}
+	// The requested range is at most two contiguous spans of the ring buffer
+	const std::int64_t first = pos % size;
+	const auto firstSize = static_cast<std::size_t>(std::min(samples, size - first));
+	const auto secondSize = static_cast<std::size_t>(samples) - firstSize;
+	// Mixed under the lock: the decoder may write anywhere in the ring (after a gap or a restart)
+	samplemix::mix(begin, m_data.data() + first, firstSize, gain);
+	if (secondSize > 0) samplemix::mix(begin + firstSize, m_data.data(), secondSize, gain.advanced(firstSize));
 
 	m_read_pos = pos + samples;
 	m_cond.notify_all();
@@ -167,6 +169,7 @@ AudioBuffer::AudioBuffer(fs::path const& file, unsigned rate, size_t size):
 		m_replayGainDecibels = ffmpeg->getReplayGainInDecibels();
 		m_replayGainFactor = ffmpeg->getReplayGainVolumeFactor();
 		reader_thread = std::async(std::launch::async, [this, ffmpeg = std::move(ffmpeg)] {
+			Trace::threadName("audio decoder");
 			auto errors = 0u;
 			std::unique_lock<std::mutex> l(m_mutex);
 			while (!m_quit) {
@@ -350,13 +353,8 @@ double FFmpeg::calculateLinearGain(double gainInDB) const {
 		return pow(10.0, gainInDB / 20.0);
 }
 
-VideoFFmpeg::VideoFFmpeg(fs::path const& filename, VideoCb videoCb) : FFmpeg(filename, AVMEDIA_TYPE_VIDEO), handleVideoData(videoCb) {
-	// Setup software scaling context for YUV to RGB conversion
-	m_swsContext.reset(sws_getContext(
-				m_codecContext->width, m_codecContext->height, m_codecContext->pix_fmt,
-				m_codecContext->width, m_codecContext->height, AV_PIX_FMT_RGB24,
-				SWS_POINT, nullptr, nullptr, nullptr));
-}
+VideoFFmpeg::VideoFFmpeg(fs::path const& filename, VideoCb videoCb, FrameSource frameSource) :
+	FFmpeg(filename, AVMEDIA_TYPE_VIDEO), handleVideoData(videoCb), m_frameSource(frameSource) {}
 
 AudioFFmpeg::AudioFFmpeg(fs::path const& filename, int rate, AudioCb audioCb) :
 	FFmpeg(filename, AVMEDIA_TYPE_AUDIO), m_rate(rate), handleAudioData(audioCb) {
@@ -403,6 +401,7 @@ void FFmpeg::avcodec_free_context(AVCodecContext *avctx) {
 }
 
 void FFmpeg::handleOneFrame() {
+	TraceScope trace("decode");
 	bool read_one = false;
 	do {
 				std::unique_ptr<AVPacket, std::function<void(AVPacket*)>> pkt(av_packet_alloc(), [] (auto *pkt) { av_packet_free(&pkt); });
@@ -469,18 +468,48 @@ void FFmpeg::handleSomeFrames() {
 	} while (ret >= 0);
 }
 
+namespace {
+	void copyPlane(std::uint8_t* dst, unsigned stride, unsigned rows, std::uint8_t const* src, int srcStride) {
+		if (static_cast<int>(stride) == srcStride) {
+			std::memcpy(dst, src, std::size_t(stride) * rows);
+			return;
+		}
+		for (unsigned y = 0; y < rows; ++y, dst += stride, src += srcStride) std::memcpy(dst, src, stride);
+	}
+
+	bool jpegFormat(AVPixelFormat fmt) {
+		return fmt == AV_PIX_FMT_YUVJ420P || fmt == AV_PIX_FMT_YUVJ422P || fmt == AV_PIX_FMT_YUVJ444P || fmt == AV_PIX_FMT_YUVJ440P || fmt == AV_PIX_FMT_YUVJ411P;
+	}
+}
+
 void VideoFFmpeg::processFrame(uFrame frame) {
-	// Convert into RGB and scale the data
-	auto w = static_cast<unsigned>((m_codecContext->width + 15) & ~15);
-	auto h = static_cast<unsigned>(m_codecContext->height);
-	Bitmap f;
+	// The frame stays in YUV and is converted to RGB by the video shader
+	auto const fmt = static_cast<AVPixelFormat>(frame->format);
+	auto const w = static_cast<unsigned>(frame->width);
+	auto const h = static_cast<unsigned>(frame->height);
+	bool const nv12 = fmt == AV_PIX_FMT_NV12;
+	VideoFrame f = m_frameSource ? m_frameSource() : VideoFrame();
 	f.timestamp = m_position;
-	f.fmt = pix::Format::RGB;
-	f.resize(w, h);
-	{
-		std::uint8_t* data = f.data();
-		int linesize = static_cast<int>(w * 3);
-		sws_scale(m_swsContext.get(), frame->data, frame->linesize, 0, static_cast<int>(h), &data, &linesize);
+	f.resize(w, h, nv12);
+	if (nv12 || fmt == AV_PIX_FMT_YUV420P || fmt == AV_PIX_FMT_YUVJ420P) {
+		for (unsigned i = 0; i < f.planes(); ++i) copyPlane(f.plane(i), f.planeStride(i), f.planeHeight(i), frame->data[i], frame->linesize[i]);
+		f.fullRange = fmt == AV_PIX_FMT_YUVJ420P || frame->color_range == AVCOL_RANGE_JPEG;
+		f.bt709 = frame->colorspace == AVCOL_SPC_BT709 || (frame->colorspace == AVCOL_SPC_UNSPECIFIED && h >= 720);
+	} else {
+		// Anything else (4:2:2, 10 bit, RGB...) is converted to yuv420p on the CPU
+		m_swsContext.reset(sws_getCachedContext(m_swsContext.release(),
+				frame->width, frame->height, fmt,
+				frame->width, frame->height, AV_PIX_FMT_YUV420P,
+				SWS_POINT, nullptr, nullptr, nullptr));
+		if (!m_swsContext) throw std::runtime_error("Cannot convert video pixel format " + std::to_string(frame->format));
+		std::uint8_t* data[] = { f.plane(0), f.plane(1), f.plane(2) };
+		int linesize[] = { static_cast<int>(f.planeStride(0)), static_cast<int>(f.planeStride(1)), static_cast<int>(f.planeStride(2)) };
+		sws_scale(m_swsContext.get(), frame->data, frame->linesize, 0, frame->height, data, linesize);
+		// swscale converts yuvj to MPEG levels and RGB with the BT.601 matrix; other YUV sources pass through as they are
+		AVPixFmtDescriptor const* desc = av_pix_fmt_desc_get(fmt);
+		bool const yuv = desc && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+		f.fullRange = yuv && !jpegFormat(fmt) && frame->color_range == AVCOL_RANGE_JPEG;
+		f.bt709 = yuv && (frame->colorspace == AVCOL_SPC_BT709 || (frame->colorspace == AVCOL_SPC_UNSPECIFIED && h >= 720));
 	}
 	handleVideoData(std::move(f));  // Takes ownership and may block until there is space
 }
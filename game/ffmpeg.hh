@@ -4,6 +4,7 @@
 #include "texture.hh"
 #include "util.hh"
 #include "libda/sample.hpp"
+#include "samplemix.hh"
 
 #include "aubio/aubio.h"
 
@@ -11,8 +12,10 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <functional>
 #include <future>
 #include <deque>
 #include <iostream>
@@ -123,17 +126,47 @@ class AudioFFmpeg : public FFmpeg {
 	std::unique_ptr<SwrContext, void(*)(SwrContext*)> m_resampleContext{nullptr, [] (auto p) { swr_close(p); swr_free(&p); }};
 };
 
+/// A decoded video frame in planar 4:2:0 YUV (three planes, or two with interleaved chroma for NV12), converted to RGB on the GPU
+struct VideoFrame {
+	std::vector<std::uint8_t> buf;  ///< All planes without padding; empty for the EOF marker
+	unsigned width = 0, height = 0;
+	bool nv12 = false;  ///< Chroma is a single plane of interleaved U and V samples
+	bool fullRange = false;  ///< JPEG (0..255) rather than MPEG (16..235) levels
+	bool bt709 = false;  ///< BT.709 rather than BT.601 colour matrix
+	double timestamp = 0.0;
+
+	unsigned chromaWidth() const { return (width + 1) / 2; }
+	unsigned chromaHeight() const { return (height + 1) / 2; }
+	unsigned planes() const { return nv12 ? 2 : 3; }
+	/// Bytes per row of the given plane
+	unsigned planeStride(unsigned i) const { return i == 0 ? width : nv12 ? 2 * chromaWidth() : chromaWidth(); }
+	unsigned planeHeight(unsigned i) const { return i == 0 ? height : chromaHeight(); }
+	std::size_t planeSize(unsigned i) const { return std::size_t(planeStride(i)) * planeHeight(i); }
+	std::size_t planeOffset(unsigned i) const { return i == 0 ? 0 : planeSize(0) + (i - 1) * planeSize(1); }
+	std::uint8_t* plane(unsigned i) { return buf.data() + planeOffset(i); }
+	std::uint8_t const* plane(unsigned i) const { return buf.data() + planeOffset(i); }
+	/// Set the size and layout, keeping the allocation if it is large enough
+	void resize(unsigned w, unsigned h, bool interleavedChroma) {
+		width = w;
+		height = h;
+		nv12 = interleavedChroma;
+		buf.resize(planeSize(0) + 2 * std::size_t(chromaWidth()) * chromaHeight());
+	}
+};
+
 class VideoFFmpeg : public FFmpeg {
   public:
-	using VideoCb = std::function<void(Bitmap)>;
-	VideoFFmpeg(fs::path const& file, VideoCb videoCb);
+	using VideoCb = std::function<void(VideoFrame&&)>;
+	/// Supplies a (possibly recycled) frame to decode into
+	using FrameSource = std::function<VideoFrame()>;
+	VideoFFmpeg(fs::path const& file, VideoCb videoCb, FrameSource frameSource = FrameSource());
 
   protected:
 	void processFrame(uFrame frame) override;
   private:
-	std::unique_ptr<SwsContext, void(*)(SwsContext*)> m_swsContext{nullptr, sws_freeContext};
-        VideoCb handleVideoData;
-
+	std::unique_ptr<SwsContext, void(*)(SwsContext*)> m_swsContext{nullptr, sws_freeContext};  ///< Only for pixel formats that cannot be uploaded as is
+	VideoCb handleVideoData;
+	FrameSource m_frameSource;
 };
 
 class AudioBuffer {
@@ -146,7 +179,11 @@ class AudioBuffer {
 	uFvec makePreviewBuffer();
 	void operator()(const std::int16_t *data, std::int64_t count, std::int64_t sample_position);
 	bool prepare(std::int64_t pos);
-	bool read(float* begin, std::int64_t samples, std::int64_t pos, float volume = 1.0f);
+	/**
+	* Mix (add) samples starting at pos into begin, converting and applying the gain in the same pass.
+	* Returns false on eof. A position outside of the buffered range triggers a seek (and mixes nothing).
+	*/
+	bool read(float* begin, std::int64_t samples, std::int64_t pos, samplemix::Gain gain = {});
 	bool terminating();
 	double duration();
 
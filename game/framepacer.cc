@@ -0,0 +1,66 @@
+#include "framepacer.hh"
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace {
+	constexpr unsigned relaxFrames = 120;  ///< On-time frames before the margin is reduced again
+	constexpr Seconds marginStep{ 0.0005 };
+}
+
+void FramePacer::period(Seconds period) {
+	if (period == m_period) return;
+	m_period = period;
+	m_deadline = {};
+	m_margin = minMargin;
+}
+
+FramePacer::TimePoint FramePacer::wakeTime() const {
+	if (m_period <= Seconds{} || m_deadline == TimePoint{}) return {};
+	return m_deadline - clockDur(predictedCost());
+}
+
+void FramePacer::workStarted(TimePoint now) {
+	m_workStart = now;
+}
+
+void FramePacer::swapStarted(TimePoint now) {
+	m_costs[m_costIndex] = now - m_workStart;
+	m_costIndex = (m_costIndex + 1) % m_costs.size();
+}
+
+void FramePacer::frameDone(TimePoint now) {
+	if (m_lastFrame != TimePoint{}) {
+		Seconds const frameTime = now - m_lastFrame;
+		for (Stats* stats: { &m_stats, &m_interval }) {
+			++stats->frames;
+			stats->total += frameTime;
+			stats->worst = std::max(stats->worst, frameTime);
+		}
+	}
+	m_lastFrame = now;
+	if (m_period <= Seconds{}) return;
+	if (m_deadline != TimePoint{}) {
+		// With vsync the swap returns around the deadline, so only count clearly late frames
+		if (now > m_deadline + clockDur(m_period / 4)) {
+			++m_stats.missed;
+			++m_interval.missed;
+			m_margin = std::min(m_margin + marginStep, m_period / 2);
+			m_onTime = 0;
+		} else if (++m_onTime >= relaxFrames) {
+			m_margin = std::max(m_margin - marginStep, minMargin);
+			m_onTime = 0;
+		}
+	}
+	// Keep a steady cadence while on time, but never try to catch up on lost frames
+	m_deadline = std::max(m_deadline, now) + clockDur(m_period);
+}
+
+FramePacer::Stats FramePacer::interval() {
+	return std::exchange(m_interval, {});
+}
+
+Seconds FramePacer::predictedCost() const {
+	return std::min(*std::max_element(m_costs.begin(), m_costs.end()) + m_margin, m_period);
+}
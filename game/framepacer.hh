@@ -0,0 +1,64 @@
+#pragma once
+
+#include "chrono.hh"
+
+#include <array>
+#include <cstddef>
+
+/**
+* @short Decides how long the main loop sleeps between frames.
+*
+* Instead of sleeping a fixed time, the pacer measures how long the work before each swap takes and
+* only sleeps until that work must start to make the next deadline. The deadlines are one period apart
+* (e.g. the display refresh interval or a frame rate cap); a late frame moves the deadline instead of
+* causing a burst of catch-up frames.
+*
+* The pacer works on real (Clock::Base) time and takes the current time as a parameter, so that it
+* does not depend on the frame capture virtual time and can be tested.
+**/
+class FramePacer {
+  public:
+	using TimePoint = Clock::Base::time_point;
+	struct Stats {
+		unsigned long frames = 0;
+		unsigned long missed = 0;  ///< Frames that were done clearly after their deadline
+		Seconds total{};  ///< Sum of the frame times
+		Seconds worst{};  ///< The longest frame time
+		Seconds average() const { return frames ? total / static_cast<double>(frames) : Seconds{}; }
+	};
+	/// Time allowed for the swap and sleep inaccuracy, on top of the measured work
+	static constexpr Seconds minMargin{ 0.001 };
+
+	/// Set the time between deadlines, zero for no limit
+	void period(Seconds period);
+	Seconds period() const { return m_period; }
+	/// When the work for the next frame should start (the past if it should start right away)
+	TimePoint wakeTime() const;
+	/// The work for a frame started (e.g. after sleeping until wakeTime)
+	void workStarted(TimePoint now);
+	/// The work is done and the frame is about to be swapped
+	void swapStarted(TimePoint now);
+	/// The frame was swapped
+	void frameDone(TimePoint now);
+	/// The expected duration of the work from workStarted to swapStarted, plus the margin
+	Seconds predictedCost() const;
+	/// Seconds added to the predicted cost, grows when deadlines are missed
+	Seconds margin() const { return m_margin; }
+	/// Statistics of all frames
+	Stats const& stats() const { return m_stats; }
+	/// Statistics of the frames since the previous call
+	Stats interval();
+
+  private:
+	static constexpr std::size_t costSamples = 32;  ///< The prediction is the worst of this many recent frames
+	Seconds m_period{};
+	Seconds m_margin = minMargin;
+	std::array<Seconds, costSamples> m_costs{};
+	std::size_t m_costIndex = 0;
+	unsigned m_onTime = 0;  ///< Frames since the margin was last changed
+	TimePoint m_workStart{};
+	TimePoint m_deadline{};  ///< Of the next frame, the epoch if none
+	TimePoint m_lastFrame{};  ///< When the previous frame was done, the epoch if none
+	Stats m_stats;
+	Stats m_interval;
+};
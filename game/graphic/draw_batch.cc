@@ -0,0 +1,227 @@
+#include "draw_batch.hh"
+
+#include "../log.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace glutil {
+	namespace {
+		constexpr std::size_t segmentSize = 1 << 16;  ///< Vertices per ring segment (3 MiB)
+		constexpr std::size_t segments = 3;  ///< Segments in the ring, each guarded by a fence
+		constexpr GLsizeiptr stride = sizeof(VertexInfo);
+
+		/// A ring of vertex storage in the shared VBO. Data is appended without synchronization; the GPU
+		/// is only waited for when wrapping around to a segment that might still be in use.
+		class StreamBuffer {
+		public:
+			void init() {
+				GLsizeiptr const bytes = static_cast<GLsizeiptr>(segments * segmentSize) * stride;
+				if (epoxy_gl_version() >= 44 || epoxy_has_gl_extension("GL_ARB_buffer_storage")) {
+					GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+					glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+					m_mapped = static_cast<VertexInfo*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+				} else {
+					glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+				}
+				SpdLogger::info(LogSystem::OPENGL, "Streaming vertices through a {} buffer.", m_mapped ? "persistently mapped" : "mapped");
+			}
+
+			void shutdown() {
+				for (auto& fence: m_fences) {
+					if (fence) glDeleteSync(fence);
+					fence = nullptr;
+				}
+				if (m_mapped) glUnmapBuffer(GL_ARRAY_BUFFER);
+				m_mapped = nullptr;
+				m_segment = m_used = 0;
+			}
+
+			/// Copy vertices into the ring (at most segmentSize). @return index of the first vertex in the VBO
+			GLint upload(VertexInfo const* data, std::size_t count) {
+				if (m_used + count > segmentSize) nextSegment();
+				std::size_t const first = m_segment * segmentSize + m_used;
+				m_used += count;
+				GLsizeiptr const bytes = static_cast<GLsizeiptr>(count) * stride;
+				if (m_mapped) {
+					std::memcpy(m_mapped + first, data, static_cast<std::size_t>(bytes));
+				} else {
+					GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+					GLintptr const offset = static_cast<GLintptr>(first) * stride;
+					GLErrorChecker::countCalls(2);
+					if (void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes, flags)) {
+						std::memcpy(ptr, data, static_cast<std::size_t>(bytes));
+						glUnmapBuffer(GL_ARRAY_BUFFER);
+					} else {
+						glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+					}
+				}
+				return static_cast<GLint>(first);
+			}
+
+		private:
+			void nextSegment() {
+				m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				m_segment = (m_segment + 1) % segments;
+				m_used = 0;
+				GLsync& fence = m_fences[m_segment];
+				if (!fence) return;
+				// Normally signaled long ago, as the other segments were filled in between
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+
+			VertexInfo* m_mapped = nullptr;
+			std::array<GLsync, segments> m_fences{};
+			std::size_t m_segment = 0;
+			std::size_t m_used = 0;
+		};
+
+		struct State {
+			StreamBuffer stream;
+			std::vector<VertexInfo> pending;  ///< Queued vertices as GL_TRIANGLES
+			GLuint program = 0;  ///< Selected program
+			std::optional<GLuint> boundProgram;
+			std::optional<std::pair<GLenum, GLuint>> texture;
+			GLuint wrapTexture = 0;
+			std::optional<bool> wrapRepeat;
+			std::optional<std::pair<GLenum, GLenum>> blend;
+		};
+
+		State& state() {
+			static State s;
+			return s;
+		}
+
+		void applyProgram(State& s) {
+			if (s.boundProgram == s.program) return;
+			DrawBatch::flush();
+			GLErrorChecker::countCalls();
+			glUseProgram(s.program);
+			s.boundProgram = s.program;
+		}
+	}
+
+	void DrawBatch::init() {
+		auto& s = state();
+		s.stream.init();
+		s.pending.reserve(segmentSize);
+	}
+
+	void DrawBatch::shutdown() {
+		auto& s = state();
+		s.pending.clear();
+		s.stream.shutdown();
+	}
+
+	void DrawBatch::add(VertexInfo const* vertices, std::size_t count, GLenum mode) {
+		auto& s = state();
+		applyProgram(s);
+		switch (mode) {
+			case GL_TRIANGLE_STRIP:
+				for (std::size_t i = 2; i < count; ++i) s.pending.insert(s.pending.end(), vertices + i - 2, vertices + i + 1);
+				break;
+			case GL_TRIANGLES:
+				s.pending.insert(s.pending.end(), vertices, vertices + count - count % 3);
+				break;
+			default:
+				flush();
+				if (count > segmentSize) {
+					SpdLogger::error(LogSystem::OPENGL, "DrawBatch: cannot draw {} vertices at once", count);
+					return;
+				}
+				GLErrorChecker::countDraw();
+				glDrawArrays(mode, s.stream.upload(vertices, count), static_cast<GLsizei>(count));
+		}
+	}
+
+	void DrawBatch::flush() {
+		auto& s = state();
+		if (s.pending.empty()) return;
+		GLErrorChecker glerror("DrawBatch::flush");
+		constexpr std::size_t chunkSize = segmentSize - segmentSize % 3;
+		for (std::size_t pos = 0; pos < s.pending.size(); pos += chunkSize) {
+			std::size_t const count = std::min(chunkSize, s.pending.size() - pos);
+			GLErrorChecker::countDraw();
+			glDrawArrays(GL_TRIANGLES, s.stream.upload(s.pending.data() + pos, count), static_cast<GLsizei>(count));
+		}
+		s.pending.clear();
+	}
+
+	void DrawBatch::useProgram(GLuint program) {
+		state().program = program;
+	}
+
+	void DrawBatch::bindProgram(GLuint program) {
+		auto& s = state();
+		s.program = program;
+		applyProgram(s);
+	}
+
+	GLuint DrawBatch::program() {
+		return state().program;
+	}
+
+	void DrawBatch::programDeleted(GLuint program) {
+		auto& s = state();
+		flush();
+		// The id may be reused by a new program, so the binding is no longer known
+		if (s.boundProgram == program) s.boundProgram.reset();
+		if (s.program == program) s.program = 0;
+	}
+
+	void DrawBatch::bindTexture(GLenum target, GLuint id) {
+		auto& s = state();
+		auto const texture = std::make_pair(target, id);
+		if (s.texture == texture) return;
+		flush();
+		GLErrorChecker::countCalls(2);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(target, id);
+		s.texture = texture;
+	}
+
+	void DrawBatch::bindTexture(GLenum target, GLuint id, unsigned unit) {
+		if (unit == 0) return bindTexture(target, id);
+		flush();
+		GLErrorChecker::countCalls(3);
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, id);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void DrawBatch::textureDeleted(GLuint id) {
+		auto& s = state();
+		flush();
+		if (s.texture && s.texture->second == id) s.texture.reset();
+		if (s.wrapTexture == id) s.wrapRepeat.reset();
+	}
+
+	void DrawBatch::textureWrap(GLenum target, bool repeat) {
+		auto& s = state();
+		GLuint const id = s.texture ? s.texture->second : 0;
+		if (s.texture && s.wrapTexture == id && s.wrapRepeat == repeat) return;
+		flush();
+		GLErrorChecker::countCalls(2);
+		GLint const mode = repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, mode);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, mode);
+		s.wrapTexture = id;
+		s.wrapRepeat = repeat;
+	}
+
+	void DrawBatch::blendFunc(GLenum src, GLenum dst) {
+		auto& s = state();
+		auto const blend = std::make_pair(src, dst);
+		if (s.blend == blend) return;
+		flush();
+		GLErrorChecker::countCalls();
+		glBlendFunc(src, dst);
+		s.blend = blend;
+	}
+}
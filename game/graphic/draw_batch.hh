@@ -0,0 +1,52 @@
+#pragma once
+
+#include "glutil.hh"
+
+#include <epoxy/gl.h>
+
+#include <cstddef>
+
+namespace glutil {
+
+	/**
+	* @short Frame-level batching of vertex draws.
+	*
+	* Consecutive draws that use the same GL state are merged into one glDrawArrays call and all vertex
+	* data is streamed through a ring buffer in the shared VBO instead of reallocating it for every draw.
+	* Draws are never reordered, so blending and the painter's order stay exactly as before.
+	*
+	* For this to work, all GL state that affects drawing must either be set through the tracking
+	* functions below (which only flush when the state really changes), or flush() must be called
+	* before changing it (glEnable, viewports, FBOs, UBO writes, texture uploads...).
+	**/
+	class DrawBatch {
+	public:
+		/// Set up the streaming buffer in the currently bound GL_ARRAY_BUFFER (the shared VBO)
+		static void init();
+		/// Release the streaming buffer
+		static void shutdown();
+		/// Queue vertices for drawing with the current state (GL_TRIANGLE_STRIP and GL_TRIANGLES are merged)
+		static void add(VertexInfo const* vertices, std::size_t count, GLenum mode);
+		/// Issue all queued draws
+		static void flush();
+
+		/// Select a shader program for the next draws (bound lazily, so that restoring a program does not break a batch)
+		static void useProgram(GLuint program);
+		/// Bind a shader program immediately (e.g. for setting uniforms)
+		static void bindProgram(GLuint program);
+		/// The program selected for the next draws
+		static GLuint program();
+		/// Forget a program that is about to be deleted
+		static void programDeleted(GLuint program);
+		/// Bind a texture to unit 0
+		static void bindTexture(GLenum target, GLuint id);
+		/// Bind a texture to another unit (for multi-texture shaders; always flushes, unit 0 stays active)
+		static void bindTexture(GLenum target, GLuint id, unsigned unit);
+		/// Forget a texture that is about to be deleted
+		static void textureDeleted(GLuint id);
+		/// Set the wrap mode of the bound texture (repeat or clamp to edge)
+		static void textureWrap(GLenum target, bool repeat);
+		/// Set the blending function
+		static void blendFunc(GLenum src, GLenum dst);
+	};
+}
@@ -0,0 +1,118 @@
+#include "frame_capture.hh"
+
+#include "draw_batch.hh"
+#include "../log.hh"
+#include "../trace.hh"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+	/// Rows of glReadPixels are aligned to 4 byte boundaries
+	unsigned rowStride(unsigned width) { return (width * 3 + 3) & ~3u; }
+}
+
+FrameCapture::FrameCapture(): m_thread(&FrameCapture::run, this) {
+	for (auto& readback: m_readbacks) glGenBuffers(1, &readback.pbo);
+}
+
+FrameCapture::~FrameCapture() {
+	update(true);
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_quit = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();  // Writes the remaining jobs first
+	for (auto& readback: m_readbacks) glDeleteBuffers(1, &readback.pbo);
+}
+
+void FrameCapture::read(unsigned width, unsigned height, fs::path const& filename) {
+	Readback& readback = m_readbacks[m_next];
+	if (readback.fence) fetch(readback);  // All buffers are busy, so the oldest one must be finished first
+	m_next = (m_next + 1) % m_readbacks.size();
+	glutil::DrawBatch::flush();
+	glutil::GLErrorChecker glerror("FrameCapture::read");
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+	glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(rowStride(width)) * height, nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.width = width;
+	readback.height = height;
+	readback.filename = filename;
+}
+
+void FrameCapture::update(bool wait) {
+	// Oldest first, so that the frames are written in order
+	for (std::size_t i = 0; i < m_readbacks.size(); ++i) {
+		Readback& readback = m_readbacks[(m_next + i) % m_readbacks.size()];
+		if (!readback.fence) continue;
+		if (!wait && glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) break;
+		fetch(readback);
+	}
+}
+
+std::size_t FrameCapture::pending() {
+	std::size_t count = 0;
+	for (auto const& readback: m_readbacks) if (readback.fence) ++count;
+	std::lock_guard<std::mutex> l(m_mutex);
+	return count + m_jobs.size() + (m_writing ? 1 : 0);
+}
+
+void FrameCapture::fetch(Readback& readback) {
+	TraceScope trace("fetch frame");
+	while (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+	glDeleteSync(readback.fence);
+	readback.fence = nullptr;
+	Job job;
+	job.stride = rowStride(readback.width);
+	job.filename = std::move(readback.filename);
+	Bitmap& img = job.bitmap;
+	img.width = readback.width;
+	img.height = readback.height;
+	img.buf.resize(std::size_t{ job.stride } * img.height);
+	img.fmt = pix::Format::RGB;
+	img.linearPremul = true; // Not really, but this will use correct gamma.
+	img.bottomFirst = true;
+	GLsizeiptr const bytes = static_cast<GLsizeiptr>(img.buf.size());
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+	if (void const* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+		std::memcpy(img.buf.data(), ptr, img.buf.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, bytes, img.buf.data());
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	{
+		// Wait if the writer is behind, so that capturing every frame cannot use up all memory
+		std::unique_lock<std::mutex> l(m_mutex);
+		m_condition.wait(l, [this] { return m_jobs.size() < maxJobs; });
+		m_jobs.push_back(std::move(job));
+	}
+	m_condition.notify_all();
+}
+
+void FrameCapture::run() {
+	Trace::threadName("frame writer");
+	std::unique_lock<std::mutex> l(m_mutex);
+	while (true) {
+		m_condition.wait(l, [this] { return m_quit || !m_jobs.empty(); });
+		if (m_jobs.empty()) return;  // Quitting, and everything has been written
+		Job job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_writing = true;
+		l.unlock();
+		m_condition.notify_all();
+		try {
+			TraceScope trace("write PNG");
+			writePNG(job.filename, job.bitmap, job.stride);
+			SpdLogger::info(LogSystem::IMAGE, "Frame saved, file={} ({}x{}).", job.filename, job.bitmap.width, job.bitmap.height);
+		} catch (std::exception& e) {
+			SpdLogger::error(LogSystem::IMAGE, "Saving frame failed, file={}, exception={}", job.filename, e.what());
+		}
+		l.lock();
+		m_writing = false;
+		m_condition.notify_all();
+	}
+}
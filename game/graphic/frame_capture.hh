@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../fs.hh"
+#include "../image.hh"
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+* @short Saves rendered frames as PNG files without stalling the render thread.
+*
+* read() only starts an asynchronous copy of the back buffer into a pixel buffer object. The pixels are
+* fetched by update() a frame or two later, when the GPU is done with them, and a worker thread encodes
+* and writes the PNG files.
+**/
+class FrameCapture {
+  public:
+	/// Needs a current OpenGL context
+	FrameCapture();
+	/// Waits until all frames have been written
+	~FrameCapture();
+	FrameCapture(FrameCapture const&) = delete;
+	FrameCapture& operator=(FrameCapture const&) = delete;
+	/// Start copying the back buffer (call after drawing, before swapping) to be saved as filename
+	void read(unsigned width, unsigned height, fs::path const& filename);
+	/// Pass the completed copies to the writer (call once per frame); with wait, also the copies still in progress
+	void update(bool wait = false);
+	/// The number of frames being copied or written
+	std::size_t pending();
+
+  private:
+	struct Readback {
+		GLuint pbo = 0;
+		GLsync fence = nullptr;  ///< Set while the copy is in progress
+		unsigned width = 0;
+		unsigned height = 0;
+		fs::path filename;
+	};
+	struct Job {
+		Bitmap bitmap;
+		unsigned stride = 0;
+		fs::path filename;
+	};
+	/// Wait for the copy to finish and queue its pixels for writing
+	void fetch(Readback& readback);
+	/// The writer thread
+	void run();
+
+	static constexpr std::size_t maxJobs = 4;  ///< Frames waiting for the writer before fetch blocks
+	std::array<Readback, 3> m_readbacks;
+	std::size_t m_next = 0;  ///< The oldest readback, which is used next
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<Job> m_jobs;
+	bool m_writing = false;
+	bool m_quit = false;
+	std::thread m_thread;
+};
@@ -56,7 +56,8 @@ void Shader::dumpInfoLog(GLuint id) {
 }
 
 void Shader::bindUniformBlocks() {
-	glUseProgram(program);
+	glutil::DrawBatch::flush();
+	glutil::DrawBatch::bindProgram(program);
 	glBindBuffer(GL_UNIFORM_BUFFER,Window::UBO());
 	GLint64 bufferSize = glutil::danceNoteUniforms::offset() + glutil::danceNoteUniforms::size();
 	glBufferData(GL_UNIFORM_BUFFER, bufferSize, NULL, GL_DYNAMIC_DRAW);
@@ -92,6 +93,7 @@ void Shader::bindUniformBlocks() {
 Shader::Shader(std::string const& name): name(name), program(0) {}
 
 Shader::~Shader() {
+	glutil::DrawBatch::programDeleted(program);
 	glDeleteProgram(program);
 	std::for_each(shader_ids.begin(), shader_ids.end(), glDeleteShader);
 }
@@ -183,7 +185,7 @@ Shader& Shader::link() {
 
 Shader& Shader::bind() {
 	glutil::GLErrorChecker ec("Shader::bind");
-	glUseProgram(program);
+	glutil::DrawBatch::bindProgram(program);
 	return *this;
 }
 
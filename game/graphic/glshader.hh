@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../fs.hh"
+#include "draw_batch.hh"
 #include "glutil.hh"
 #include <forward_list>
 #include <map>
@@ -8,20 +9,21 @@
 #include <vector>
 #include <epoxy/gl.h>
 
+/// A uniform location of a bound program. Setting it flushes the queued draws first, as they were made with the old value.
 struct Uniform {
 	GLint id;
 	explicit Uniform(GLint id): id(id) {}
-	void set(int value) { glUniform1i(id, value); }
-	void set(float value) { glUniform1f(id, value); }
-	void set(int x, int y) { glUniform2i(id, x, y); }
-	void set(float x, float y) { glUniform2f(id, x, y); }
-	void set(int x, int y, int z) { glUniform3i(id, x, y, z); }
-	void set(float x, float y, float z) { glUniform3f(id, x, y, z); }
-	void set(int x, int y, int z, int w) { glUniform4i(id, x, y, z, w); }
-	void set(float x, float y, float z, float w) { glUniform4f(id, x, y, z, w); }
-	void set(glmath::vec4 const& v) { glUniform4fv(id, 1, glm::value_ptr(v)); }
-	void setMat3(glmath::mat3 const& m) { glUniformMatrix3fv(id, 1, GL_FALSE, &m[0][0]); }
-	void setMat4(glmath::mat4 const& m) { glUniformMatrix4fv(id, 1, GL_FALSE, &m[0][0]); }
+	void set(int value) { glutil::DrawBatch::flush(); glUniform1i(id, value); }
+	void set(float value) { glutil::DrawBatch::flush(); glUniform1f(id, value); }
+	void set(int x, int y) { glutil::DrawBatch::flush(); glUniform2i(id, x, y); }
+	void set(float x, float y) { glutil::DrawBatch::flush(); glUniform2f(id, x, y); }
+	void set(int x, int y, int z) { glutil::DrawBatch::flush(); glUniform3i(id, x, y, z); }
+	void set(float x, float y, float z) { glutil::DrawBatch::flush(); glUniform3f(id, x, y, z); }
+	void set(int x, int y, int z, int w) { glutil::DrawBatch::flush(); glUniform4i(id, x, y, z, w); }
+	void set(float x, float y, float z, float w) { glutil::DrawBatch::flush(); glUniform4f(id, x, y, z, w); }
+	void set(glmath::vec4 const& v) { glutil::DrawBatch::flush(); glUniform4fv(id, 1, glm::value_ptr(v)); }
+	void setMat3(glmath::mat3 const& m) { glutil::DrawBatch::flush(); glUniformMatrix3fv(id, 1, GL_FALSE, &m[0][0]); }
+	void setMat4(glmath::mat4 const& m) { glutil::DrawBatch::flush(); glUniformMatrix4fv(id, 1, GL_FALSE, &m[0][0]); }
 };
 
 struct Shader {
@@ -47,6 +49,8 @@ struct Shader {
 
 	/** Binds the shader into use. */
 	Shader& bind();
+	/** The shader program object id */
+	GLuint id() const { return program; }
 
 	/** Allow setting uniforms in a chain. Shader needs to be in use.*/
 
@@ -76,15 +80,12 @@ private:
 };
 
 
-/** Temporarily switch shader in a RAII manner. */
+/** Temporarily switch shader in a RAII manner. The program is bound when something is drawn with it. */
 struct UseShader {
-	UseShader(Shader& new_shader): m_shader(new_shader) {
-		GLint _temp;
-		glGetIntegerv(GL_CURRENT_PROGRAM, &_temp);
-		m_old = static_cast<GLuint>(_temp);
-		m_shader.bind();
+	UseShader(Shader& new_shader): m_shader(new_shader), m_old(glutil::DrawBatch::program()) {
+		glutil::DrawBatch::useProgram(m_shader.id());
 	}
-	~UseShader() { glUseProgram(m_old); }
+	~UseShader() { glutil::DrawBatch::useProgram(m_old); }
 	/// Access the bound shader
 	Shader& operator()() { return m_shader; }
 
@@ -1,8 +1,12 @@
 #include "glutil.hh"
+#include "draw_batch.hh"
 #include "../log.hh"
 #include "video_driver.hh"
 #include "window.hh"
 
+#include <cstring>
+#include <utility>
+
 namespace glutil {
 
 	GLintptr alignOffset(GLintptr offset) {
@@ -20,33 +24,86 @@ namespace glutil {
 	}
 
 	void VertexArray::draw(GLint mode) {
-		GLErrorChecker glerror("VertexArray::draw");
 		if (empty()) return;
+		DrawBatch::add(m_vertices.data(), m_vertices.size(), static_cast<GLenum>(mode));
+	}
+
+	UseDepthTest::UseDepthTest() {
+		DrawBatch::flush();
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+	}
 
-		glBufferData(GL_ARRAY_BUFFER, stride() * size(), &m_vertices.front(), GL_DYNAMIC_DRAW);
+	UseDepthTest::~UseDepthTest() {
+		DrawBatch::flush();
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	GLErrorChecker::GLErrorChecker(char const* info) {
+		stack.push_back({ info, nullptr });
+		if (s_mode == Mode::PER_SCOPE) check("before starting");
+	}
 
-		glerror.check("draw arrays");
-		glDrawArrays(mode, 0, size());
+	GLErrorChecker::~GLErrorChecker() {
+		if (s_mode == Mode::PER_SCOPE) check("after finishing");
+		stack.pop_back();
 	}
 
-	GLErrorChecker::GLErrorChecker(std::string const& info): info(info) {
-		stack.push_back(std::string());
-		check("before starting");
-		stack.back() = info;
+	void GLErrorChecker::check(char const* what) {
+		if (s_mode == Mode::PER_SCOPE) {
+			++s_calls;
+			GLenum err = glGetError();
+			if (err != GL_NO_ERROR) report(msg(err), what);
+		}
+		stack.back().what = what;
 	}
 
-	GLErrorChecker::~GLErrorChecker() { check("after finishing"); stack.pop_back(); }
+	void GLErrorChecker::report(std::string const& message, char const* milestone) {
+		++s_errors;
+		// Prefix with all currently active GLErrorChecker contexts
+		std::string logmsg;
+		for (std::size_t i = 0; i < stack.size(); ++i) {
+			Scope const& s = stack[i];
+			if (milestone && i + 1 == stack.size()) fmt::format_to(std::back_inserter(logmsg), "{} {}: ", s.info, milestone);
+			else if (s.what) fmt::format_to(std::back_inserter(logmsg), "{} after {}: ", s.info, s.what);
+			else fmt::format_to(std::back_inserter(logmsg), "{}: ", s.info);
+		}
+		SpdLogger::error(LogSystem::OPENGL, logmsg.append(message));
+	}
+
+	void GLAPIENTRY GLErrorChecker::debugMessage(GLenum, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* message, void const*) {
+		std::string text(message, length < 0 ? std::strlen(message) : static_cast<std::size_t>(length));
+		if (type == GL_DEBUG_TYPE_ERROR) report(text, nullptr);
+		else if (severity == GL_DEBUG_SEVERITY_HIGH) SpdLogger::warn(LogSystem::OPENGL, "GL debug message id={}: {}", id, text);
+		else SpdLogger::debug(LogSystem::OPENGL, "GL debug message id={}: {}", id, text);
+	}
+
+	void GLErrorChecker::init(bool debug) {
+		if (epoxy_gl_version() >= 43 || epoxy_has_gl_extension("GL_KHR_debug")) {
+			glEnable(GL_DEBUG_OUTPUT);
+			// Synchronous output runs the callback inside the failing call, so that the scope stack is right
+			if (debug) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+			glDebugMessageCallback(&GLErrorChecker::debugMessage, nullptr);
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+			s_mode = Mode::DEBUG_OUTPUT;
+		} else {
+			s_mode = debug ? Mode::PER_SCOPE : Mode::PER_FRAME;
+		}
+		static char const* const names[] = { "glGetError once per frame", "glGetError in every scope", "KHR_debug" };
+		SpdLogger::info(LogSystem::OPENGL, "Checking GL errors with {}.", names[static_cast<int>(s_mode)]);
+	}
 
-	void GLErrorChecker::check(std::string const& what) {
-		GLenum err = glGetError();
-		if (err != GL_NO_ERROR) {
-			stack.back()= fmt::format("{} {}", info, what);
-			// Prefix with all currently active GLErrorChecker contexts
-			std::string logmsg;
-			for (auto s: stack) fmt::format_to(std::back_inserter(logmsg), "{}: ", s);
-			SpdLogger::error(LogSystem::OPENGL, logmsg.append(msg(err)));
+	FrameCounters GLErrorChecker::endFrame() {
+		if (s_mode == Mode::PER_FRAME) {
+			++s_calls;
+			GLenum err = glGetError();
+			if (err != GL_NO_ERROR) report(msg(err), "during the frame");
 		}
-		stack.back() = info + " after " + what;
+		FrameCounters counters;
+		counters.calls = std::exchange(s_calls, 0u);
+		counters.draws = std::exchange(s_draws, 0u);
+		counters.errors = s_errors.exchange(0);
+		return counters;
 	}
 
 /* static */ std::string GLErrorChecker::msg(GLenum err) {
@@ -63,6 +120,10 @@ namespace glutil {
 	}
 }
 
-/* static */ thread_local std::vector<std::string> GLErrorChecker::stack;
+/* static */ thread_local std::vector<GLErrorChecker::Scope> GLErrorChecker::stack;
+/* static */ GLErrorChecker::Mode GLErrorChecker::s_mode = GLErrorChecker::Mode::PER_SCOPE;
+/* static */ unsigned GLErrorChecker::s_calls = 0;
+/* static */ unsigned GLErrorChecker::s_draws = 0;
+/* static */ std::atomic<unsigned> GLErrorChecker::s_errors{ 0 };
 
 }
@@ -4,6 +4,7 @@
 #include "../color.hh"
 #include "glmath.hh"
 #include <epoxy/gl.h>
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <vector>
@@ -75,7 +76,7 @@ namespace glutil {
 	}; // 32 bytes
 	// Total 368 bytes
 
-	/// Handy vertex array capable of drawing itself
+	/// Handy vertex array capable of drawing itself (through DrawBatch)
 	class VertexArray {
 	private:
 		std::vector<VertexInfo> m_vertices;
@@ -133,27 +134,53 @@ namespace glutil {
 	/// Wrapper struct for RAII
 	struct UseDepthTest {
 		/// enable depth test (for 3d objects)
-		UseDepthTest() {
-			glClear(GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-		}
-		~UseDepthTest() {
-			glDisable(GL_DEPTH_TEST);
-		}
+		UseDepthTest();
+		~UseDepthTest();
+	};
+
+	/// Per-frame counters of GL activity
+	struct FrameCounters {
+		unsigned calls = 0;  ///< GL calls of the draw path (draws, vertex uploads, state and uniform changes)
+		unsigned draws = 0;  ///< Draw calls
+		unsigned errors = 0;  ///< GL errors reported
 	};
 
-	/// Checks for OpenGL error and displays it with given location info
+	/**
+	* @short Checks for OpenGL errors and reports them with the active scopes as location info.
+	*
+	* With KHR_debug the driver reports errors through a callback and a scope only pushes two pointers.
+	* Otherwise glGetError is called once per frame, or in every scope and check() in debug mode
+	* (graphic/gl_debug), which also makes KHR_debug output synchronous so that errors get the right scope.
+	**/
 	class GLErrorChecker {
-		static thread_local std::vector<std::string> stack;
-		std::string info;
-		void setWhat(std::string what);
 	public:
-		GLErrorChecker(std::string const& info);
+		/// @param info scope name, must be a string literal (only the pointer is kept)
+		explicit GLErrorChecker(char const* info);
 		~GLErrorChecker();
-		void check(std::string const& what = "check()");  ///< An error-check milestone; will log and  any active GL errors
+		GLErrorChecker(GLErrorChecker const&) = delete;
+		GLErrorChecker& operator=(GLErrorChecker const&) = delete;
+		void check(char const* what = "check()");  ///< An error-check milestone; will log any active GL errors in debug mode
 		static void reset() { glGetError(); }  ///< Ignore any existing error
 		static std::string msg(GLenum err);
+		/// Select the checking mode once a GL context exists
+		static void init(bool debug);
+		/// Check for errors of the frame (if nothing else does) and return and reset the frame counters
+		static FrameCounters endFrame();
+		static void countCalls(unsigned calls = 1) { s_calls += calls; }
+		static void countDraw() { ++s_draws; ++s_calls; }
+
+	private:
+		enum class Mode { PER_FRAME, PER_SCOPE, DEBUG_OUTPUT };
+		struct Scope {
+			char const* info;
+			char const* what;  ///< Last milestone passed
+		};
+		static void report(std::string const& message, char const* milestone);
+		static void GLAPIENTRY debugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* message, void const* user);
+		static thread_local std::vector<Scope> stack;
+		static Mode s_mode;
+		static unsigned s_calls;
+		static unsigned s_draws;
+		static std::atomic<unsigned> s_errors;  ///< Debug messages may come from driver threads
 	};
 }
-
-
@@ -1,7 +1,12 @@
 #include "text_renderer.hh"
 
+#include "log.hh"
+#include "lrucache.hh"
+
+#include <fmt/format.h>
 #include <pango/pangocairo.h>
 
+#include <cstddef>
 #include <memory>
 
 namespace {
@@ -29,10 +34,32 @@ namespace {
 	void alignFactor(float& factor) {
 		factor *= 2.0f;  // HACK to improve text quality without affecting compatibility with old versions
 	}
+
+	struct CachedText {
+		std::shared_ptr<Texture> texture;
+		float width;
+		float height;
+	};
+
+	/// Lyrics and menus keep drawing the same strings, so keep their textures around (limited to 64 MiB)
+	LruCache<std::string, CachedText>& cache() {
+		static LruCache<std::string, CachedText> cache(512, 64 << 20);
+		return cache;
+	}
+
+	std::string cacheKey(std::string const& text, TextStyle const& style, float m) {
+		auto const& f = style.fill_col;
+		auto const& s = style.stroke_col;
+		return fmt::format("{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{},{},{},{}|{},{},{},{}|{}",
+		  style.fontfamily, style.fontstyle, style.fontweight, style.fontalign, style.fontsize, style.stroke_width,
+		  style.stroke_miterlimit, style.stroke_linejoin, style.stroke_linecap, m, f.r, f.g, f.b, f.a, s.r, s.g, s.b, s.a, text);
+	}
 }
 
 OpenGLText TextRenderer::render(std::string const& text, TextStyle const& style, float m) {
 	alignFactor(m);
+	auto const key = cacheKey(text, style, m);
+	if (CachedText* cached = cache().find(key)) return OpenGLText(text, cached->texture, cached->width, cached->height);
 
 	// Setup font settings
 	auto alignment = parseAlignment(style.fontalign);
@@ -98,11 +125,12 @@ OpenGLText TextRenderer::render(std::string const& text, TextStyle const& style,
 	auto bitmapWidth = static_cast<unsigned>(cairo_image_surface_get_width(surface.get()));
 	auto bitmapHeight = static_cast<unsigned>(cairo_image_surface_get_height(surface.get()));
 	bitmap.resize(bitmapWidth, bitmapHeight);
-	auto texture = std::make_unique<Texture>();
+	auto texture = std::make_shared<Texture>();
 	texture->load(bitmap, true);
 
 	// We don't want text quality multiplier m to affect rendering size...
-	return OpenGLText(text, texture, width / m, height / m);
+	CachedText const& cached = cache().insert(key, { texture, width / m, height / m }, std::size_t{ bitmapWidth } * bitmapHeight * 4);
+	return OpenGLText(text, cached.texture, cached.width, cached.height);
 }
 
 Size TextRenderer::measure(const std::string& text, const TextStyle& style, float m) {
@@ -134,3 +162,8 @@ Size TextRenderer::measure(const std::string& text, const TextStyle& style, floa
 	return {width / m, height / m};
 }
 
+void TextRenderer::clearCache() {
+	auto& c = cache();
+	SpdLogger::info(LogSystem::TEXT, "Text cache: {} hits, {} misses, {} strings using {} KiB.", c.hits(), c.misses(), c.size(), c.cost() >> 10);
+	c.clear();
+}
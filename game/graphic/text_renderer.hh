@@ -7,7 +7,10 @@
 
 class TextRenderer {
 public:
+	/// Rendered textures are cached by text and style, so that repeated strings are only drawn once
 	OpenGLText render(std::string const&, TextStyle const&, float m);
 	Size measure(std::string const&, TextStyle const&, float m);
+	/// Drop the cached textures, must be called while the OpenGL context still exists
+	static void clearCache();
 };
 
@@ -24,7 +24,9 @@ namespace Global {
 }
 
 float getSeparation() {
-	return config["graphic/stereo3d"].b() ? 0.001f * config["graphic/stereo3dseparation"].f() : 0.0f;
+	static ConfigHandle<bool> const stereo3d("graphic/stereo3d");
+	static ConfigHandle<float> const separation("graphic/stereo3dseparation");
+	return *stereo3d ? 0.001f * *separation : 0.0f;
 }
 
 glmath::mat4 farTransform() {
@@ -1,10 +1,13 @@
 #include "window.hh"
 
 #include "color_trans.hh"
+#include "draw_batch.hh"
+#include "frame_capture.hh"
 #include "configuration.hh"
 #include "game.hh"
 #include "log.hh"
 #include "platform.hh"
+#include "text_renderer.hh"
 #include "view_trans.hh"
 #include "video_driver.hh"
 
@@ -13,6 +16,8 @@
 #include <SDL_rect.h>
 #include <SDL_video.h>
 
+#include <optional>
+
 GLuint Window::m_ubo = 0;
 GLuint Window::m_vao = 0;
 GLuint Window::m_vbo = 0;
@@ -96,6 +101,8 @@ void Window::start() {
 		GLattrSetter attr_buf(SDL_GL_BUFFER_SIZE, 32);
 		GLattrSetter attr_d(SDL_GL_DEPTH_SIZE, 24);
 		GLattrSetter attr_db(SDL_GL_DOUBLEBUFFER, 1);
+		std::optional<GLattrSetter> attr_debug;
+		if (config["graphic/gl_debug"].b()) attr_debug.emplace(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
 		Uint32 flags = SDL_WINDOW_HIDDEN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
 		if (config["graphic/highdpi"].b()) {
 			flags |= SDL_WINDOW_ALLOW_HIGHDPI;
@@ -181,10 +188,12 @@ void Window::start() {
 		glContext.reset(SDL_GL_CreateContext(screen.get()));
 		if (glContext == nullptr) throw std::runtime_error(std::string("SDL_GL_CreateContext failed with error: ") + SDL_GetError());
 		if (epoxy_gl_version() < 33) throw std::runtime_error("Performous needs at least OpenGL 3.3+ Core profile to run.");
+		glutil::GLErrorChecker::init(config["graphic/gl_debug"].b());
 		glutil::GLErrorChecker error("Initializing buffers");
 		{
 			initBuffers();
 		}
+		m_capture = std::make_unique<FrameCapture>();
 	}
 	SDL_SetWindowMinimumSize(screen.get(), 640, 360);
 	SDL_GetWindowPosition(screen.get(), &m_windowX, &m_windowY);
@@ -208,6 +217,9 @@ void Window::start() {
 }
 
 Window::~Window() {
+	m_capture.reset();  // Finish saving screenshots
+	TextRenderer::clearCache();
+	glutil::DrawBatch::shutdown();
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	glBindVertexArray(0);
@@ -224,6 +236,7 @@ void Window::createShaders() {
 			// Compile geometry shaders when stereo is requested
 			shader("color").compileFile(findFile("shaders/stereo3d.geom"));
 			shader("texture").compileFile(findFile("shaders/stereo3d.geom"));
+			shader("video").compileFile(findFile("shaders/stereo3d.geom"));
 			shader("3dobject").compileFile(findFile("shaders/stereo3d.geom"));
 			shader("dancenote").compileFile(findFile("shaders/stereo3d.geom"));
 		}
@@ -246,6 +259,16 @@ void Window::createShaders() {
 	  .compileFile(findFile("shaders/core.frag"))
 	  .link()
 	  .bindUniformBlocks();
+	shader("video")
+	  .addDefines("#define ENABLE_TEXTURING\n")
+	  .addDefines("#define ENABLE_VERTEX_COLOR\n")
+	  .addDefines("#define ENABLE_YUV\n")
+	  .compileFile(findFile("shaders/core.vert"))
+	  .compileFile(findFile("shaders/core.frag"))
+	  .link()
+	  .bindUniformBlocks();
+	shader("video")["texU"].set(1);
+	shader("video")["texV"].set(2);
 	shader("3dobject")
 	  .addDefines("#define ENABLE_LIGHTING\n")
 	  .compileFile(findFile("shaders/core.vert"))
@@ -290,14 +313,17 @@ void Window::initBuffers() {
 	glVertexAttribPointer(vertNormal, 3, GL_FLOAT, GL_FALSE, stride, (void *)offsetof(glutil::VertexInfo, vertNormal));
 	glEnableVertexAttribArray(vertColor);
 	glVertexAttribPointer(vertColor, 4, GL_FLOAT, GL_FALSE, stride, (void *)offsetof(glutil::VertexInfo, vertColor));
+	glutil::DrawBatch::init();
 }
 
 void Window::blank() {
+	glutil::DrawBatch::flush();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 void Window::updateStereo(float sepFactor) {
 	try {
+		glutil::DrawBatch::flush();
 		m_stereoUniforms.sepFactor = sepFactor;
 		m_stereoUniforms.z0 = (Constant::z0 - 2.0f * Constant::nearDistance);
 		glBufferSubData(GL_UNIFORM_BUFFER, m_stereoUniforms.offset(), m_stereoUniforms.size(), &m_stereoUniforms);
@@ -305,30 +331,40 @@ void Window::updateStereo(float sepFactor) {
 }
 
 void Window::updateColor() {
+	// Draws queued with the previous color can only be merged with later ones if it stays the same
+	if (m_matrixUniforms.colorMatrix != Global::color) glutil::DrawBatch::flush();
 	m_matrixUniforms.colorMatrix = Global::color;
+	glutil::GLErrorChecker::countCalls();
 	glBufferSubData(GL_UNIFORM_BUFFER, (glutil::shaderMatrices::offset() + static_cast<GLint>(offsetof(glutil::shaderMatrices, colorMatrix))), sizeof(glmath::mat4), &m_matrixUniforms.colorMatrix);
 }
 
 void Window::updateLyricHighlight(glmath::vec4 const& fill, glmath::vec4 const& stroke, glmath::vec4 const& newFill, glmath::vec4 const& newStroke) {
+	auto& u = m_lyricColorUniforms;
+	if (u.origFill != fill || u.origStroke != stroke || u.newFill != newFill || u.newStroke != newStroke) glutil::DrawBatch::flush();
 	m_lyricColorUniforms.origFill = fill;
 	m_lyricColorUniforms.origStroke = stroke;
 	m_lyricColorUniforms.newFill = newFill;
 	m_lyricColorUniforms.newStroke = newStroke;
+	glutil::GLErrorChecker::countCalls();
 	glBufferSubData(GL_UNIFORM_BUFFER, m_lyricColorUniforms.offset(), m_lyricColorUniforms.size(), &m_lyricColorUniforms);
 }
 
 void Window::updateLyricHighlight(glmath::vec4 const& fill, glmath::vec4 const& stroke) {
+	if (m_lyricColorUniforms.newFill != fill || m_lyricColorUniforms.newStroke != stroke) glutil::DrawBatch::flush();
 	m_lyricColorUniforms.newFill = fill;
 	m_lyricColorUniforms.newStroke = stroke;
+	glutil::GLErrorChecker::countCalls();
 	glBufferSubData(GL_UNIFORM_BUFFER, m_lyricColorUniforms.offset(), m_lyricColorUniforms.size(), &m_lyricColorUniforms);
 }
 
 void Window::updateTransforms() {
 	using namespace glmath;
 	mat4 normal(Global::modelview);
+	if (m_matrixUniforms.projMatrix != Global::projection || m_matrixUniforms.mvMatrix != Global::modelview) glutil::DrawBatch::flush();
 	m_matrixUniforms.projMatrix = Global::projection;
 	m_matrixUniforms.mvMatrix = Global::modelview;
 	m_matrixUniforms.normalMatrix = normal;
+	glutil::GLErrorChecker::countCalls();
 	glBufferSubData(GL_UNIFORM_BUFFER, m_matrixUniforms.offset(), m_matrixUniforms.size(), &m_matrixUniforms);
 }
 
@@ -336,8 +372,10 @@ void Window::render(Game &game, std::function<void (void)> drawFunc) {
 	glutil::GLErrorChecker glerror("Window::render");
 	auto& window = game.getWindow();
 	ViewTrans trans(*this);  // Default frustum
-	bool stereo = config["graphic/stereo3d"].b();
-	auto const type = static_cast<Stereo3dType>(config["graphic/stereo3dtype"].ui());
+	static ConfigHandle<bool> const stereo3d("graphic/stereo3d");
+	static ConfigHandle<unsigned short> const stereo3dType("graphic/stereo3dtype");
+	bool stereo = *stereo3d;
+	auto const type = static_cast<Stereo3dType>(*stereo3dType);
 
 	static bool warn3d = false;
 	if (!stereo) warn3d = false;
@@ -353,13 +391,14 @@ void Window::render(Game &game, std::function<void (void)> drawFunc) {
 	// Over/under only available in fullscreen
 	if (stereo && type == Stereo3dType::OverUnder && !m_fullscreen) stereo = false;
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glutil::DrawBatch::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	updateStereo(stereo ? getSeparation() : 0.0f);
 	glerror.check("setup");
 	// Can we do direct to framebuffer rendering (no FBO)?
 	if (!stereo || type == Stereo3dType::OverUnder) {
 		view(stereo);
 		drawFunc();
+		glutil::DrawBatch::flush();
 		return;
 	}
 	// Render both eyes to FBO (full resolution top/bottom for anaglyph)
@@ -377,6 +416,7 @@ void Window::render(Game &game, std::function<void (void)> drawFunc) {
 	// Render to actual framebuffer from FBOs
 	UseTexture use(window, getFBO().getTexture());
 	view(0);  // Viewport for drawable area
+	glutil::DrawBatch::flush();
 	glDisable(GL_BLEND);
 	glmath::mat4 colorMatrix = glmath::mat4(1.0f);
 	updateStereo(0.0f);  // Disable stereo mode while we composite
@@ -406,20 +446,23 @@ void Window::render(Game &game, std::function<void (void)> drawFunc) {
 		dim.center((num == 0 ? 0.25f : -0.25f) * dim.h());
 		if (num == 1) {
 			// Right eye blends over the left eye
+			glutil::DrawBatch::flush();
 			glEnable(GL_BLEND);
-			glBlendFunc(GL_ONE, GL_ONE);
+			glutil::DrawBatch::blendFunc(GL_ONE, GL_ONE);
 		}
 		getFBO().getTexture().draw(window, dim, TexCoords(0.0f, 1.0f, 1.0f, 0));
 	}
+	glutil::DrawBatch::flush();
 }
 
 void Window::view(unsigned num) {
 	glutil::GLErrorChecker glerror("Window::view");
+	glutil::DrawBatch::flush();
 	// Set flags
 	glClearColor (0.0f, 0.0f, 0.0f, 1.0f);
 	glDisable(GL_DEPTH_TEST);
 	glDisable(GL_CULL_FACE);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glutil::DrawBatch::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_BLEND);
 	if (GL_EXT_framebuffer_sRGB) glEnable(GL_FRAMEBUFFER_SRGB);
 	glerror.check("setup");
@@ -456,7 +499,21 @@ void Window::view(unsigned num) {
 }
 
 void Window::swap() {
+	static ConfigHandle<bool> const vsync("graphic/vsync");
+	glutil::DrawBatch::flush();
+	int const swapInterval = *vsync ? 1 : 0;
+	if (swapInterval != m_swapInterval) {
+		m_swapInterval = swapInterval;
+		if (SDL_GL_SetSwapInterval(swapInterval) != 0) SpdLogger::warning(LogSystem::OPENGL, "Setting vsync={} failed, error={}", *vsync, SDL_GetError());
+	}
 	SDL_GL_SwapWindow(screen.get());
+	if (m_capture) m_capture->update();  // Save screenshots whose pixels have arrived
+}
+
+double Window::refreshRate() const {
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(screen.get(), &mode) != 0) return 0.0;
+	return mode.refresh_rate;
 }
 
 void Window::event(Uint8 const& eventID, Sint32 const& data1, Sint32 const& data2) {
@@ -560,8 +617,7 @@ void Window::resize() {
 	}
 }
 
-void Window::screenshot() {
-	Bitmap img;
+void Window::screenshot(fs::path filename) {
 	int nativeW;
 	int nativeH;
 	if (std::stoi(SDL_GetHint("SDL_HINT_VIDEO_HIGHDPI_DISABLED")) == 1) {
@@ -570,24 +626,17 @@ void Window::screenshot() {
 	else {
 		SDL_GL_GetDrawableSize(screen.get(), &nativeW, &nativeH);
 	}
-	img.width = static_cast<unsigned>(nativeW);
-	img.height = static_cast<unsigned>(nativeH);
-	unsigned stride = (img.width * 3 + 3) & ~3u;  // Rows are aligned to 4 byte boundaries
-	img.buf.resize(stride * img.height);
-	img.fmt = pix::Format::RGB;
-	img.linearPremul = true; // Not really, but this will use correct gamma.
-	img.bottomFirst = true;
-	// Get pixel data from OpenGL
-	glReadPixels(0, 0, img.width, img.height, GL_RGB, GL_UNSIGNED_BYTE, img.data());
-	// Compose filename with first available number
-	fs::path filename;
-	for (unsigned i = 1;; ++i) {
-		filename = PathCache::getHomeDir() / ("Performous_" + std::to_string(i) + ".png");
-		if (!fs::exists(filename)) break;
+	// Compose filename with first available number (after those still being saved)
+	while (filename.empty()) {
+		fs::path name = PathCache::getHomeDir() / ("Performous_" + std::to_string(++m_screenshotNumber) + ".png");
+		if (!fs::exists(name)) filename = name;
 	}
-	// Save to disk
-	writePNG(filename.string(), img, stride);
-	SpdLogger::info(LogSystem::OPENGL, "Screenshot taken, file={} ({}x{}).", filename, img.width, img.height);
+	// Only the copy to a pixel buffer is started here; the image is saved when it is ready
+	m_capture->read(static_cast<unsigned>(nativeW), static_cast<unsigned>(nativeH), filename);
+}
+
+std::size_t Window::screenshotsPending() {
+	return m_capture ? m_capture->pending() : 0;
 }
 
 Window::SDLSystem::SDLSystem() {
@@ -15,6 +15,7 @@
 struct SDL_Surface;
 struct SDL_Window;
 class FBO;
+class FrameCapture;
 class Game;
 
 float screenW();
@@ -39,12 +40,17 @@ class Window {
 	void initBuffers();
 	/// swaps buffers
 	void swap();
+	/// The refresh rate of the display showing the window in Hz, zero if unknown
+	double refreshRate() const;
 	/// Handle window events
 	void event(Uint8 const& eventID, Sint32 const& data1, Sint32 const& data2);
 	/// Resize window (contents) / toggle full screen according to config. Returns true if resized.
 	void resize();
-	/// take a screenshot
-	void screenshot();
+	/// Take a screenshot of what has been drawn (call before swap). It is saved in the background,
+	/// to filename or by default to the first free Performous_N.png in the home folder.
+	void screenshot(fs::path filename = {});
+	/// The number of screenshots still being saved
+	std::size_t screenshotsPending();
 
 	/// Return reference to Uniform Buffer Object.
 	static GLuint const& UBO() { return Window::m_ubo; }
@@ -95,6 +101,8 @@ class Window {
 	std::unique_ptr<FBO> m_fbo;
 	int m_windowX = 0;
 	int m_windowY = 0;
+	unsigned m_screenshotNumber = 0;
+	int m_swapInterval = -2;  ///< As last set with SDL_GL_SetSwapInterval (-2 before setting it)
 
 	// Careful, Shaders depends on SDL_Window, thus m_shaders need to be
 	// destroyed before screen (and thus be creater after)
@@ -104,4 +112,5 @@ class Window {
 	std::unique_ptr<SDL_Window, void (*)(SDL_Window*)> screen;
 	std::unique_ptr<std::remove_pointer_t<SDL_GLContext> /* SDL_GLContext is a void* */, void (*)(SDL_GLContext)> glContext;
 	std::unique_ptr<ShaderManager> m_shaderManager;
+	std::unique_ptr<FrameCapture> m_capture;
 };
@@ -38,6 +38,11 @@ namespace {
 	float tc(float y) { return static_cast<float>(y * 0.1); } // Get texture coordinates for animating hold notes
 	const double maxTolerance = 0.15; // Maximum error in seconds
 
+	double beatTime(double beat) { return beat; }
+	double chordBegin(GuitarChord const& chord) { return chord.begin; }
+	/// Drum chords are drawn at their begin time only
+	auto chordEnd(bool drums) { return [drums](GuitarChord const& chord) { return drums ? chord.begin : chord.end; }; }
+
 	const float drumfill_min_rate = 6.0; // The rate of hits per second required to complete a drum fill
 	double points(double error) {
 		// error    points
@@ -312,8 +317,10 @@ bool GuitarGraph::difficulty(Difficulty level, bool check_only) {
 
 /// Core engine
 void GuitarGraph::engine() {
+	static ConfigHandle<float> const controllerDelay("audio/controller_delay");
 	double time = m_audio.getPosition();
-	time -= config["audio/controller_delay"].f();
+	auto const now = Clock::now();
+	time -= *controllerDelay;
 	doUpdates();
 	if (!m_drumfills.empty()) updateDrumFill(time); // Drum Fills / BREs
 	m_whammy = 0;
@@ -380,19 +387,21 @@ void GuitarGraph::engine() {
 
 		// Disable gameplay when game is paused
 		if (m_audio.isPaused()) continue;
+		// Judge against the time of the hit rather than of this frame
+		double const hitTime = eventTime(time, now, ev);
 
 		// Guitar specific actions
 		if (!m_drums) {
 			if (ev.button == input::ButtonId::GUITAR_GODMODE && ev.pressed()) activateStarpower();
 			if (ev.button == input::ButtonId::GUITAR_WHAMMY) m_whammy = (1.0 + ev.value + 2.0*(rand()/double(RAND_MAX))) / 4.0;
-			if (buttonId <= m_pads && !ev.pressed()) endHold(buttonId, time);
+			if (buttonId <= m_pads && !ev.pressed()) endHold(buttonId, hitTime);
 		}
 
 		// Playing
 		if (m_drums) {
-			if (ev.pressed() && ev.button.layer() < 8 && ev.button.num() < m_pads) drumHit(time, ev.button.layer(), ev.button.num());
+			if (ev.pressed() && ev.button.layer() < 8 && ev.button.num() < m_pads) drumHit(hitTime, ev.button.layer(), ev.button.num());
 		} else {
-			guitarPlay(time, ev);
+			guitarPlay(hitTime, ev);
 		}
 		if (m_score < 0) m_score = 0;
 	}
@@ -630,7 +639,7 @@ void GuitarGraph::drumHit(double time, unsigned layer, unsigned fret) {
 		Duration const* dur = m_chordIt->dur[fret];
 		// Record the hit event
 		m_events.push_back(Event(time, 1, static_cast<int>(fret), dur));
-		m_notes[dur] = static_cast<unsigned>(m_events.size());
+		m_notes[dur] = m_chordIt->event[fret] = static_cast<unsigned>(m_events.size());
 		// Scoring - be a little more generous for kids
 		double score = (m_level == Difficulty::KIDS) ? points(tolerance/2.0f) : points(tolerance);
 		m_chordIt->score += static_cast<float>(score);
@@ -733,7 +742,7 @@ void GuitarGraph::guitarPlay(double time, input::Event const& ev) {
 			if (!m_chordIt->fret[fret]) continue;
 			Duration const* dur = m_chordIt->dur[fret];
 			m_events.push_back(Event(time, 1 + picked, static_cast<int>(fret), dur));
-			m_notes[dur] = static_cast<unsigned>(m_events.size());
+			m_notes[dur] = m_chordIt->event[fret] = static_cast<unsigned>(m_events.size());
 			m_holds[fret] = static_cast<unsigned>(m_events.size());
 			if (first_time) {
 				m_flames[fret].push_back(AnimValue(0.0, flameSpd));
@@ -795,8 +804,12 @@ void GuitarGraph::drawNotes(double time) {
 
 	glmath::vec4 neckglow{};  // Used for calculating the average neck color
 
-	// Iterate chords
-	for (auto& chord: m_chords) {
+	// Iterate the chords on screen
+	m_chordWindow.update(m_chords, time + past, time + future, chordBegin, chordEnd(m_drums), [](GuitarChord& chord) {
+		chord.passed = true; // Mark as past note for rewinding
+	});
+	for (auto i = m_chordWindow.first(); i < m_chordWindow.last(); ++i) {
+		GuitarChord& chord = m_chords[i];
 		float tBeg = static_cast<float>(chord.begin - time);
 		float tEnd = static_cast<float>(m_drums ? tBeg : chord.end - time);
 		if (tBeg > future) break;
@@ -819,7 +832,7 @@ void GuitarGraph::drawNotes(double time) {
 		for (unsigned fret = 0; fret < m_pads; ++fret) {
 			if (!chord.fret[fret] || (tBeg > maxTolerance && chord.releaseTimes[fret] > 0)) continue;
 			if (tEnd > future) tEnd = future;
-			unsigned event = m_notes[chord.dur[fret]];
+			unsigned event = chord.event[fret];
 			float glow = 0.0f;
 			float whammy = 0.0f;
 			if (event > 0) {
@@ -874,9 +887,13 @@ void GuitarGraph::drawNeckStuff(double time) {
 		UseTexture tex(m_game.getWindow(), *m_neck);
 		glutil::VertexArray va;
 		float w = (m_drums ? 2.0f : 2.5f);
-		float texCoord = 0.0f;
-		float tBeg = 0.0f, tEnd;
-		for (auto it = m_song.beats.begin(); it != m_song.beats.end() && tBeg < future; ++it, texCoord += texCoordStep, tBeg = tEnd) {
+		auto const& beats = m_song.beats;
+		m_beatWindow.update(beats, time + past, time + future, beatTime, beatTime);
+		// Start from the last beat line before the window, so that the neck reaches past the cursor
+		std::size_t const start = m_beatWindow.first() > 0 ? m_beatWindow.first() - 1 : 0;
+		float texCoord = static_cast<float>(start) * texCoordStep;
+		float tBeg = start > 0 ? static_cast<float>(beats[start - 1] - time) : 0.0f, tEnd;
+		for (auto it = beats.begin() + static_cast<std::ptrdiff_t>(start); it != beats.end() && tBeg < future; ++it, texCoord += texCoordStep, tBeg = tEnd) {
 			tEnd = static_cast<float>(*it - time);
 			//if (tEnd < past) continue;
 			if (tEnd > future) {
@@ -1049,8 +1066,10 @@ void GuitarGraph::drawNote(unsigned fret, Color color, double tBeg, double tEnd,
 		y = yEnd + fretWid;
 		vertexPair(va, x, y, color, doanim ? tc(static_cast<float>(y + t)) : 0.20f);
 		vertexPair(va, x, yEnd, color, doanim ? tc(static_cast<float>(yEnd + t)) : 0.0f);
+		glutil::DrawBatch::flush();
 		glDisable(GL_DEPTH_TEST);
 		va.draw();
+		glutil::DrawBatch::flush();
 		glEnable(GL_DEPTH_TEST);
 		// Render the fret object
 		{
@@ -1237,6 +1256,7 @@ void GuitarGraph::updateChords() {
 		m_chords.push_back(c);
 	}
 	m_chordIt = m_chords.begin();
+	m_chordWindow.reset(m_chords, chordBegin, chordEnd(m_drums));
 
 	m_hasTomTrack = false;
 	if(m_drums) {
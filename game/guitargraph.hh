@@ -2,6 +2,7 @@
 
 #include "instrumentgraph.hh"
 #include "3dobject.hh"
+#include "timewindow.hh"
 
 #include <cstdint>
 
@@ -17,12 +18,14 @@ struct GuitarChord {
 	bool passed; // Set to true for notes that should not re-appear when rewinding
 	unsigned status; // Guitar: 0 = not played, 1 = tapped, 2 = picked, drums: number of pads hit
 	float score;
+	unsigned event[5]; // m_events index + 1 of the hit on each fret, 0 if not played
 	AnimValue hitAnim[5];
 	double releaseTimes[5];
 	GuitarChord(): begin(), end(), polyphony(), tappable(), passed(), status(), score() {
 		std::fill(fret, fret + 5, false);
 		std::fill(fret_cymbal, fret_cymbal + 5, false);
 		std::fill(dur, dur + 5, static_cast<Duration const*>(nullptr));
+		std::fill(event, event + 5, 0u);
 		std::fill(hitAnim, hitAnim + 5, AnimValue(0.0, 1.5));
 		std::fill(releaseTimes, releaseTimes + 5, 0.0);
 	}
@@ -135,6 +138,8 @@ class GuitarGraph: public InstrumentGraph {
 	typedef std::vector<GuitarChord> Chords;
 	Chords m_chords;
 	Chords::iterator m_chordIt;
+	TimeWindow m_chordWindow; /// chords on screen
+	TimeWindow m_beatWindow; /// beat lines on screen
 	typedef std::map<Duration const*, unsigned> NoteStatus; // Note in song to m_events[unsigned - 1] or 0 for not played
 	NoteStatus m_notes;
 	std::vector<Duration> m_solos; /// holds guitar solos
@@ -0,0 +1,23 @@
+#include "gzip.hh"
+
+#include <zlib.h>
+
+#include <stdexcept>
+
+std::string gzip(std::string_view data) {
+	z_stream stream{};
+	// 15 bits of window plus 16 selects the gzip header instead of zlib's
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw std::runtime_error("gzip: deflateInit2 failed");
+	}
+	std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	stream.avail_in = static_cast<uInt>(data.size());
+	stream.next_out = reinterpret_cast<Bytef*>(out.data());
+	stream.avail_out = static_cast<uInt>(out.size());
+	int const ret = deflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+	if (ret != Z_STREAM_END) throw std::runtime_error("gzip: deflate failed");
+	return out;
+}
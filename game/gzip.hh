@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/// Compress data in the gzip format (as used by HTTP Content-Encoding: gzip)
+std::string gzip(std::string_view data);
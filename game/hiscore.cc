@@ -19,9 +19,11 @@ bool Hiscore::reachedHiscore(unsigned score, SongId songid, unsigned short level
 		return false; // come on, did you even try to sing?
 	}
 
+	SongEntry const* entry = findSong(songid);
+	if (!entry) return true; // nothing found for that song -> true
 	unsigned position = 0;
-	for (auto const& elem: m_hiscore) {
-		if (elem.songid != songid) continue;
+	for (auto const& it: entry->scores) {
+		auto const& elem = *it;
 		if (elem.track != track) continue;
 		if (elem.level != level) continue;
 		if (score > elem.score) return true;
@@ -30,56 +32,88 @@ bool Hiscore::reachedHiscore(unsigned score, SongId songid, unsigned short level
 	return true; // nothing found for that song -> true
 }
 
-void Hiscore::addHiscore(unsigned score, const PlayerId& playerid, SongId songid, unsigned short level, std::string const& track) {
-	addHiscore({score, playerid, songid, level, track});
+bool Hiscore::addHiscore(unsigned score, const PlayerId& playerid, SongId songid, unsigned short level, std::string const& track) {
+	return addHiscore({score, playerid, songid, level, track});
 }
 
-void Hiscore::addHiscore(HiscoreItem&& item) {
+bool Hiscore::addHiscore(HiscoreItem&& item) {
 	if (item.track.empty())
 		throw std::runtime_error("No track given");
 	if (!reachedHiscore(item.score, item.songid, item.level, item.track))
-		return;
-	m_hiscore.insert(std::move(item));
+		return false;
+	auto const it = m_hiscore.insert(std::move(item));
+	SongEntry& entry = m_bySong[it->songid];
+	// Equal scores go after the existing ones, as in the multiset
+	auto const pos = std::upper_bound(entry.scores.begin(), entry.scores.end(), it, [](auto const& a, auto const& b) { return *a < *b; });
+	entry.scores.insert(pos, it);
+	SongStats& stats = entry.levels[it->level];
+	stats.best = std::max(stats.best, it->score);
+	++stats.count;
+	return true;
+}
+
+Hiscore::SongEntry const* Hiscore::findSong(SongId songid) const {
+	auto const it = m_bySong.find(songid);
+	return it == m_bySong.end() ? nullptr : &it->second;
 }
 
 Hiscore::HiscoreVector Hiscore::queryHiscore(std::optional<PlayerId> playerid, std::optional<SongId> songid, std::string const& track, std::optional<unsigned> max) const {
 	HiscoreVector hv;
-	for (auto const& h: m_hiscore) {
-		if (playerid && playerid.value() != h.playerid) continue;
-		if (songid && songid.value() != h.songid) continue;
-		if (currentLevel() != h.level) continue;
-		if (!track.empty() && track != h.track) continue;
-		if (max && --max.value() == 0) break;
+	auto const level = currentLevel();
+	auto const add = [&](HiscoreItem const& h) {
+		if (playerid && playerid.value() != h.playerid) return true;
+		if (level != h.level) return true;
+		if (!track.empty() && track != h.track) return true;
+		if (max && --max.value() == 0) return false;
 		hv.push_back(h);
+		return true;
+	};
+	if (songid) {
+		if (SongEntry const* entry = findSong(songid.value())) {
+			for (auto const& it: entry->scores) if (!add(*it)) break;
+		}
+	} else {
+		for (auto const& h: m_hiscore) if (!add(h)) break;
 	}
 	return hv;
 }
 
 bool Hiscore::hasHiscore(const SongId& songid) const {
-	return std::any_of(m_hiscore.begin(),m_hiscore.end(), [&songid, level = currentLevel()](auto const& h) {
-		return songid == h.songid && level == h.level;
-	});
+	return getStats(songid, currentLevel()).count > 0;
 }
 
 unsigned Hiscore::getHiscore(SongId songid) const {
-	for (auto const& score: m_hiscore) {
-		if (songid == score.songid && currentLevel() == score.level) {
-			return score.score;
-		}
-	}
-
-	return 0;
+	return getStats(songid, currentLevel()).best;
 }
 
 std::vector<HiscoreItem> Hiscore::getHiscores(SongId songid) const {
 	auto scores = std::vector<HiscoreItem>{};
+	SongEntry const* entry = findSong(songid);
+	if (!entry) return scores;
 
-	std::copy_if(m_hiscore.begin(), m_hiscore.end(), std::back_inserter(scores),
-		[&](auto const& score){return songid == score.songid && currentLevel() == score.level;});
+	auto const level = currentLevel();
+	for (auto const& it: entry->scores) {
+		if (it->level == level) scores.push_back(*it);
+	}
 
 	return scores;
 }
 
+Hiscore::SongStats Hiscore::getStats(SongId songid, unsigned short level) const {
+	SongEntry const* entry = findSong(songid);
+	if (!entry) return {};
+	auto const it = entry->levels.find(level);
+	return it == entry->levels.end() ? SongStats() : it->second;
+}
+
+std::vector<Hiscore::SongStats> Hiscore::getStats(std::vector<std::optional<SongId>> const& songids) const {
+	std::vector<SongStats> result;
+	result.reserve(songids.size());
+	auto const level = currentLevel();
+	for (auto const& songid: songids) result.push_back(songid ? getStats(*songid, level) : SongStats());
+	return result;
+}
+
 void Hiscore::load(xmlpp::NodeSet const& nodes) {
 	for (auto const& n: nodes) {
 		xmlpp::Element& element = dynamic_cast<xmlpp::Element&>(*n);
@@ -5,15 +5,34 @@
 #include "player.hh"
 #include "songitems.hh"
 
+#include <map>
+#include <optional>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+/**The hiscore list.
+
+  All scores are kept ordered best first, and additionally indexed by song
+  with per-song aggregates maintained on insertion, so that queries about
+  one song (or all songs) do not scan the whole list.
+  */
 class Hiscore {
 public:
 	static const unsigned MaximumScorePoints;
 	static const unsigned MaximumStoredScores;
 
+	Hiscore() = default;
+	Hiscore(Hiscore const&) = delete;
+	Hiscore& operator=(Hiscore const&) = delete;
+
+	/// Aggregates of the scores of a song on one level
+	struct SongStats {
+		unsigned best = 0;  ///< Highest score on any track
+		unsigned count = 0;  ///< Number of stored scores on all tracks
+	};
+
 	void load(xmlpp::NodeSet const& n);
 	void save(xmlpp::Element *players);
 
@@ -40,8 +59,9 @@ public:
 	  in its valid interval. If one of this conditions is not net a
 	  HiscoreException will be raised.
 	  */
-	void addHiscore(unsigned score, const PlayerId& playerid, SongId songid, unsigned short level, std::string const& track);
-	void addHiscore(HiscoreItem&&);
+	bool addHiscore(unsigned score, const PlayerId& playerid, SongId songid, unsigned short level, std::string const& track);
+	/// @return true if the score was added (it is not if the list for the song is full of better scores)
+	bool addHiscore(HiscoreItem&&);
 
 	using HiscoreVector = std::vector<HiscoreItem>;
 
@@ -51,10 +71,23 @@ public:
 	std::vector<HiscoreItem> getHiscores(unsigned songid) const;
 	HiscoreVector queryHiscore(std::optional<PlayerId> playerid, std::optional<SongId> songid, std::string const& track, std::optional<unsigned> max = std::nullopt) const;
 	bool hasHiscore(const SongId& songid) const;
+	/// Aggregates of a song on the given level (zero if it has no scores)
+	SongStats getStats(SongId songid, unsigned short level) const;
+	/// Aggregates of many songs on the current level in one call (zero for songs not in the database)
+	std::vector<SongStats> getStats(std::vector<std::optional<SongId>> const& songids) const;
 	std::size_t size() const { return m_hiscore.size(); }
+	/// Call f for every HiscoreItem, best first
+	template <typename F> void forEach(F&& f) const { for (auto const& h: m_hiscore) f(h); }
 
   private:
 	using hiscore_t = std::multiset<HiscoreItem>;
+	struct SongEntry {
+		std::vector<hiscore_t::const_iterator> scores;  ///< Best first, in the same order as in m_hiscore
+		std::map<unsigned short, SongStats> levels;
+	};
+	SongEntry const* findSong(SongId songid) const;
+
 	hiscore_t m_hiscore;
+	std::unordered_map<SongId, SongEntry> m_bySong;  ///< Index of m_hiscore by song
 	unsigned short currentLevel() const;
 };
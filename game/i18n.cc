@@ -95,6 +95,7 @@ std::to_string(error.get()) + ": " + error.errorName());
 	UnicodeUtil::m_sortCollator.reset(sort);
 	UnicodeUtil::m_searchCollator->setStrength(icu::Collator::PRIMARY);
 	UnicodeUtil::m_sortCollator->setStrength(icu::Collator::SECONDARY);
+	UnicodeUtil::collatorsChanged();
 
 	// We ideally want an ICU locale to feed to the case-mapping functions in UnicodeUtil.
 	auto icuLoc = icu::Locale::createCanonical(getCurrentLanguage().first.c_str());
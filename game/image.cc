@@ -5,6 +5,7 @@
 #include <jpeglib.h>
 #include <png.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -175,7 +176,7 @@ void loadJPEG(Bitmap& bitmap, fs::path const& filename) {
 	}
 	jpeg_start_decompress(&cinfo);
 	bitmap.resize(cinfo.output_width, cinfo.output_height);
-	unsigned stride = (bitmap.width * 3 + 3) & ~3u;  // Number of bytes per row (word-aligned)
+	unsigned stride = bitmap.width * 3;  // Number of bytes per row (no padding, like pix::Format::RGB everywhere)
 	unsigned char* ptr = &bitmap.buf[0];
 	while (cinfo.output_scanline < bitmap.height) {
 		jpeg_read_scanlines(&cinfo, &ptr, 1);
@@ -264,6 +265,32 @@ void Bitmap::crop(const unsigned width, const unsigned height, const unsigned x,
 	this->height = height;
 }
 
+void Bitmap::shrink(unsigned maxSize) {
+	if (ptr) throw std::logic_error("Cannot Bitmap::shrink foreign pointers.");
+	unsigned const bpp = (fmt == pix::Format::RGB || fmt == pix::Format::BGR) ? 3 : 4;
+	while (maxSize > 0 && (width > maxSize || height > maxSize)) {
+		unsigned const w = std::max(width / 2, 1u);
+		unsigned const h = std::max(height / 2, 1u);
+		// A side of one pixel stays as it is, an odd last row or column is dropped
+		unsigned const dx = width > 1 ? bpp : 0;
+		std::size_t const dy = height > 1 ? std::size_t{ width } * bpp : 0;
+		// The result is written over the source, always behind the pixels still to be read
+		for (unsigned y = 0; y < h; ++y) {
+			for (unsigned x = 0; x < w; ++x) {
+				std::size_t const src = (std::size_t{ 2 * y } * width + 2 * x) * bpp;
+				std::size_t const dst = (std::size_t{ y } * w + x) * bpp;
+				for (unsigned c = 0; c < bpp; ++c) {
+					unsigned const sum = buf[src + c] + buf[src + dx + c] + buf[src + dy + c] + buf[src + dy + dx + c];
+					buf[dst + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		width = w;
+		height = h;
+		buf.resize(std::size_t{ w } * h * bpp);
+	}
+}
+
 void Bitmap::copyFromCairo(cairo_surface_t* surface) {
 	unsigned width = static_cast<unsigned>(cairo_image_surface_get_width(surface));
 	unsigned height = static_cast<unsigned>(cairo_image_surface_get_height(surface));
@@ -47,6 +47,8 @@ struct Bitmap {
 	unsigned char* data() { return ptr ? ptr : buf.data(); }
 	void copyFromCairo(cairo_surface_t* surface);
 	void crop(const unsigned width, const unsigned height, const unsigned x, const unsigned y);
+	/// Halve the size (averaging 2x2 pixels) until neither side is larger than maxSize; ar is kept
+	void shrink(unsigned maxSize);
 };
 
 enum class ImageType { UNKNOWN, PNG, JPEG, WEBP, SVG };  // Types of images we can identify
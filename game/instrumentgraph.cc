@@ -62,6 +62,13 @@ void InstrumentGraph::setupPauseMenu() {
 }
 
 
+double InstrumentGraph::eventTime(double time, Time now, input::Event const& ev) {
+	if (ev.time == Time()) return time;  // Synthetic event
+	// Older events were held up by a stall (e.g. loading) and are judged as if they had just happened
+	constexpr double maxAge = 0.25;
+	return time - clamp(Seconds(now - ev.time).count(), 0.0, maxAge);
+}
+
 void InstrumentGraph::doUpdates() {
 	if (!menuOpen() && !m_ready) {
 		m_ready = true;
@@ -133,6 +133,8 @@ public:
 	// Shared functions for derived classes
 	void drawPopups();
 	void handleCountdown(double time, double beginTime);
+	/// The song time when an input event occurred, given the song time now (events may have waited for a frame)
+	static double eventTime(double time, Time now, input::Event const& ev);
 
 	// Functions not really shared, but needed here
 	Color const& color(unsigned fret) const;
@@ -103,8 +103,9 @@ void LayoutSinger::drawScore(Window& window, PositionMode position) {
 }
 
 void LayoutSinger::draw(Window& window, double time, PositionMode position) {
+	static ConfigHandle<unsigned short> const karaokeMode("game/karaoke_mode");
 	// Draw notes and pitch waves (only when not in karaoke mode)
-	if (!config["game/karaoke_mode"].ui()) {
+	if (!*karaokeMode) {
 		switch(position) {
 			case LayoutSinger::PositionMode::FULL:
 				m_noteGraph.draw(window, time, m_database, NoteGraph::Position::FULLSCREEN);
@@ -128,7 +129,7 @@ void LayoutSinger::draw(Window& window, double time, PositionMode position) {
 		Dimensions pos;
 		switch(position) {
 			case LayoutSinger::PositionMode::FULL:
-				if(config["game/karaoke_mode"].ui() >= 2) {
+				if(*karaokeMode >= 2) {
 					pos.center(0.0f);
 				} else {
 					pos.screenBottom(-0.07f);
@@ -175,7 +176,7 @@ void LayoutSinger::draw(Window& window, double time, PositionMode position) {
 		}
 	}
 
-	if (!config["game/karaoke_mode"].ui())
+	if (!*karaokeMode)
 		drawScore(window, position); // draw score if not in karaoke mode
 }
 
@@ -5,10 +5,19 @@
  */
 
 #include "sample.hpp"
+#include <cmath>
 #include <complex>
 #include <cstddef>
 #include <vector>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DA_FFT_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define DA_FFT_NEON 1
+#include <arm_neon.h>
+#endif
+
 
 namespace da {
 
@@ -70,6 +79,184 @@ namespace da {
 		return data;
 	}
 
+	namespace fft_detail {
+		/// Scalar lane for the butterfly kernel (used for short stages and when no SIMD is available)
+		struct F1 {
+			static constexpr std::size_t width = 1;
+			float v;
+			static F1 load(float const* p) { return { *p }; }
+			void store(float* p) const { *p = v; }
+			friend F1 operator+(F1 a, F1 b) { return { a.v + b.v }; }
+			friend F1 operator-(F1 a, F1 b) { return { a.v - b.v }; }
+			friend F1 operator*(F1 a, F1 b) { return { a.v * b.v }; }
+		};
+#if defined(DA_FFT_SSE)
+		struct F4 {
+			static constexpr std::size_t width = 4;
+			__m128 v;
+			static F4 load(float const* p) { return { _mm_loadu_ps(p) }; }
+			void store(float* p) const { _mm_storeu_ps(p, v); }
+			friend F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+			friend F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+			friend F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+		};
+#elif defined(DA_FFT_NEON)
+		struct F4 {
+			static constexpr std::size_t width = 4;
+			float32x4_t v;
+			static F4 load(float const* p) { return { vld1q_f32(p) }; }
+			void store(float* p) const { vst1q_f32(p, v); }
+			friend F4 operator+(F4 a, F4 b) { return { vaddq_f32(a.v, b.v) }; }
+			friend F4 operator-(F4 a, F4 b) { return { vsubq_f32(a.v, b.v) }; }
+			friend F4 operator*(F4 a, F4 b) { return { vmulq_f32(a.v, b.v) }; }
+		};
+#else
+		using F4 = F1;
+#endif
+
+		/**
+		* One radix-4 decimation-in-time stage on split real/imaginary data, combining sub-transforms of
+		* size m into transforms of size 4m. w1 holds exp(-i tau j / 2m) and w2 exp(-i tau j / 4m) for j < m.
+		**/
+		template<typename V> void radix4(float* re, float* im, std::size_t n, std::size_t m,
+		  float const* w1re, float const* w1im, float const* w2re, float const* w2im) {
+			for (std::size_t g = 0; g < n; g += 4 * m) {
+				float* r = re + g;
+				float* i = im + g;
+				for (std::size_t j = 0; j < m; j += V::width) {
+					const V c1r = V::load(w1re + j), c1i = V::load(w1im + j);
+					const V c2r = V::load(w2re + j), c2i = V::load(w2im + j);
+					const V x0r = V::load(r + j), x0i = V::load(i + j);
+					const V x2r = V::load(r + j + 2 * m), x2i = V::load(i + j + 2 * m);
+					V tr = V::load(r + j + m), ti = V::load(i + j + m);
+					const V x1r = tr * c1r - ti * c1i, x1i = tr * c1i + ti * c1r;
+					tr = V::load(r + j + 3 * m); ti = V::load(i + j + 3 * m);
+					const V x3r = tr * c1r - ti * c1i, x3i = tr * c1i + ti * c1r;
+					// Two radix-2 butterflies of the previous size...
+					const V a0r = x0r + x1r, a0i = x0i + x1i, a1r = x0r - x1r, a1i = x0i - x1i;
+					const V b0r = x2r + x3r, b0i = x2i + x3i, b1r = x2r - x3r, b1i = x2i - x3i;
+					// ...combined, where the twiddle of the odd outputs is the even one times -i
+					const V u0r = b0r * c2r - b0i * c2i, u0i = b0r * c2i + b0i * c2r;
+					const V u1r = b1r * c2r - b1i * c2i, u1i = b1r * c2i + b1i * c2r;
+					(a0r + u0r).store(r + j); (a0i + u0i).store(i + j);
+					(a1r + u1i).store(r + j + m); (a1i - u1r).store(i + j + m);
+					(a0r - u0r).store(r + j + 2 * m); (a0i - u0i).store(i + j + 2 * m);
+					(a1r - u1i).store(r + j + 3 * m); (a1i + u1r).store(i + j + 3 * m);
+				}
+			}
+		}
+	}
+
+	/**
+	* FFT of 2^P real samples with precomputed tables.
+	*
+	* The input is packed into a complex FFT of half the size (even samples as the real part,
+	* odd samples as the imaginary part) which is computed in radix-4 stages on split real and
+	* imaginary arrays, and then unpacked into the N/2 + 1 non-redundant bins of the real spectrum.
+	* The result matches fft<P> on the same data. Construct once and reuse; not thread-safe
+	* (the plan owns its scratch buffers).
+	**/
+	template<unsigned P> class RealFFT {
+		static_assert(P >= 2, "RealFFT requires at least four samples");
+	  public:
+		static constexpr std::size_t N = std::size_t(1) << P;  ///< Number of input samples
+		static constexpr std::size_t BINS = N / 2 + 1;  ///< Number of output bins (0 Hz to Nyquist)
+
+		RealFFT(): m_rev(M), m_re(M), m_im(M), m_unpackRe(M), m_unpackIm(M) {
+			// Bit-reversal permutation of the half-size transform
+			for (std::size_t i = 0, j = 0; i < M; ++i) {
+				m_rev[i] = j;
+				std::size_t bit = M >> 1;
+				for (; bit > 0 && (j & bit); bit >>= 1) j ^= bit;
+				j |= bit;
+			}
+			// Radix-4 stage twiddles, stored consecutively per stage
+			for (std::size_t m = firstStage(); m < M; m *= 4) {
+				const std::size_t offset = m_twiddles.size();
+				m_twiddles.resize(offset + 4 * m);
+				float* w = m_twiddles.data() + offset;
+				for (std::size_t j = 0; j < m; ++j) {
+					const double a = TAU * static_cast<double>(j) / static_cast<double>(4 * m);
+					w[j] = static_cast<float>(std::cos(2.0 * a));
+					w[j + m] = static_cast<float>(-std::sin(2.0 * a));
+					w[j + 2 * m] = static_cast<float>(std::cos(a));
+					w[j + 3 * m] = static_cast<float>(-std::sin(a));
+				}
+			}
+			// Twiddles for separating the packed halves, exp(-i tau k / N)
+			for (std::size_t k = 0; k < M; ++k) {
+				const double a = TAU * static_cast<double>(k) / static_cast<double>(N);
+				m_unpackRe[k] = static_cast<float>(std::cos(a));
+				m_unpackIm[k] = static_cast<float>(-std::sin(a));
+			}
+		}
+
+		/** Transform N samples from in, multiplied by window, into BINS complex values at out. **/
+		void operator()(float const* in, float const* window, std::complex<float>* out) {
+			float* re = m_re.data();
+			float* im = m_im.data();
+			for (std::size_t n = 0; n < M; ++n) {
+				re[m_rev[n]] = in[2 * n] * window[2 * n];
+				im[m_rev[n]] = in[2 * n + 1] * window[2 * n + 1];
+			}
+			transform();
+			unpack(out);
+		}
+
+		/** Transform N unwindowed samples. **/
+		void operator()(float const* in, std::complex<float>* out) {
+			float* re = m_re.data();
+			float* im = m_im.data();
+			for (std::size_t n = 0; n < M; ++n) {
+				re[m_rev[n]] = in[2 * n];
+				im[m_rev[n]] = in[2 * n + 1];
+			}
+			transform();
+			unpack(out);
+		}
+
+	  private:
+		static constexpr std::size_t M = N / 2;  ///< Size of the packed complex transform
+		/// Sub-transform size of the first radix-4 stage (a radix-2 stage goes first when M is not a power of four)
+		static constexpr std::size_t firstStage() { return (P - 1) % 2 ? 2 : 1; }
+
+		void transform() {
+			float* re = m_re.data();
+			float* im = m_im.data();
+			if (firstStage() == 2) {
+				for (std::size_t j = 0; j < M; j += 2) {
+					const float r = re[j + 1], i = im[j + 1];
+					re[j + 1] = re[j] - r; im[j + 1] = im[j] - i;
+					re[j] += r; im[j] += i;
+				}
+			}
+			float const* w = m_twiddles.data();
+			for (std::size_t m = firstStage(); m < M; w += 4 * m, m *= 4) {
+				if (m % fft_detail::F4::width == 0) fft_detail::radix4<fft_detail::F4>(re, im, M, m, w, w + m, w + 2 * m, w + 3 * m);
+				else fft_detail::radix4<fft_detail::F1>(re, im, M, m, w, w + m, w + 2 * m, w + 3 * m);
+			}
+		}
+
+		void unpack(std::complex<float>* out) const {
+			float const* re = m_re.data();
+			float const* im = m_im.data();
+			out[0] = { re[0] + im[0], 0.0f };
+			out[M] = { re[0] - im[0], 0.0f };
+			for (std::size_t k = 1; k < M; ++k) {
+				// Even part E = (Z[k] + conj(Z[M-k])) / 2, odd part O = (Z[k] - conj(Z[M-k])) / 2i, X[k] = E + W^k O
+				const float er = 0.5f * (re[k] + re[M - k]), ei = 0.5f * (im[k] - im[M - k]);
+				const float or_ = 0.5f * (im[k] + im[M - k]), oi = -0.5f * (re[k] - re[M - k]);
+				const float wr = m_unpackRe[k], wi = m_unpackIm[k];
+				out[k] = { er + wr * or_ - wi * oi, ei + wr * oi + wi * or_ };
+			}
+		}
+
+		std::vector<std::size_t> m_rev;
+		std::vector<float> m_twiddles;
+		std::vector<float> m_re, m_im;
+		std::vector<float> m_unpackRe, m_unpackIm;
+	};
+
 	template<unsigned P, typename T> void ifft(std::complex<T>* data) {
 		constexpr std::size_t N = 1 << P;
 		for (std::size_t i = 0; i < N; ++i) data[i] = std::conj(data[i]);  // Invert phase so that we can use FFT to do IFFT
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+* @short A map that keeps only the most recently used entries.
+*
+* The size is limited both by the number of entries and by their total cost (e.g. bytes of memory), which
+* each entry is given when inserted. Not thread safe.
+**/
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+  public:
+	LruCache(std::size_t maxEntries, std::size_t maxCost): m_maxEntries(maxEntries), m_maxCost(maxCost) {}
+	/// @return the cached value, now the most recently used, or nullptr if there is none
+	Value* find(Key const& key) {
+		auto it = m_index.find(key);
+		if (it == m_index.end()) { ++m_misses; return nullptr; }
+		++m_hits;
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return &it->second->value;
+	}
+	/// Add or replace a value. The least recently used entries are dropped to stay within the limits,
+	/// but the new entry is kept even if it alone is over them.
+	Value& insert(Key const& key, Value value, std::size_t cost = 1) {
+		erase(key);
+		m_entries.push_front(Entry{ key, std::move(value), cost });
+		m_index.emplace(key, m_entries.begin());
+		m_cost += cost;
+		while (m_entries.size() > 1 && (m_entries.size() > m_maxEntries || m_cost > m_maxCost)) erase(m_entries.back().key);
+		return m_entries.front().value;
+	}
+	/// @return true if the key was cached
+	bool erase(Key const& key) {
+		auto it = m_index.find(key);
+		if (it == m_index.end()) return false;
+		m_cost -= it->second->cost;
+		m_entries.erase(it->second);
+		m_index.erase(it);
+		return true;
+	}
+	void clear() { m_index.clear(); m_entries.clear(); m_cost = 0; }
+	std::size_t size() const { return m_entries.size(); }
+	/// The total cost of the entries
+	std::size_t cost() const { return m_cost; }
+	/// Successful and failed finds since construction
+	std::size_t hits() const { return m_hits; }
+	std::size_t misses() const { return m_misses; }
+
+  private:
+	struct Entry {
+		Key key;
+		Value value;
+		std::size_t cost;
+	};
+	std::size_t m_maxEntries;
+	std::size_t m_maxCost;
+	std::size_t m_cost = 0;
+	std::size_t m_hits = 0;
+	std::size_t m_misses = 0;
+	std::list<Entry> m_entries;  ///< Most recently used first
+	std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_index;
+};
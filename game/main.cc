@@ -5,6 +5,7 @@
 #include "database.hh"
 #include "engine.hh"
 #include "fs.hh"
+#include "framepacer.hh"
 #include "graphic/glutil.hh"
 #include "i18n.hh"
 #include "log.hh"
@@ -12,6 +13,7 @@
 #include "profiler.hh"
 #include "screen.hh"
 #include "songs.hh"
+#include "trace.hh"
 #include "graphic/window.hh"
 #include "webcam.hh"
 #include "webserver.hh"
@@ -31,6 +33,7 @@
 #include <SDL_keyboard.h>
 #include <SDL_scancode.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdint>
 #include <csignal>
@@ -45,6 +48,20 @@
 
 bool g_take_screenshot = false;
 
+/// Write the recorded trace to the first free trace_N.json in the cache folder
+static void writeTrace(Game& gm) {
+	try {
+		fs::path filename;
+		for (unsigned i = 1; fs::exists(filename = PathCache::getCacheDir() / fmt::format("trace_{}.json", i)); ++i) {}
+		auto const events = Trace::write(filename);
+		SpdLogger::notice(LogSystem::LOGGER, "Trace of {} events saved at={}", events, filename);
+		gm.flashMessage(_("Trace saved!"));
+	} catch (EXCEPTION& e) {
+		SpdLogger::error(LogSystem::LOGGER, "Saving trace failed, exception={}", e.what());
+		gm.flashMessage(_("Saving trace failed!"));
+	}
+}
+
 static void checkEvents(Game& gm, Time eventTime) {
 	Window& window = gm.window();
 	SDL_Event event;
@@ -67,6 +84,12 @@ static void checkEvents(Game& gm, Time eventTime) {
 				g_take_screenshot = true;
 				continue; // Already handled here...
 			}
+			if (key == SDL_SCANCODE_F10 && (mod & Platform::shortcutModifier())) {
+				Trace::enable(!Trace::enabled());
+				if (Trace::enabled()) gm.flashMessage(_("Tracing started"));
+				else writeTrace(gm);
+				continue; // Already handled here...
+			}
 			if (key == SDL_SCANCODE_F4 && mod & KMOD_ALT) {
 				gm.finished();
 				continue; // Already handled here...
@@ -99,7 +122,15 @@ static void checkEvents(Game& gm, Time eventTime) {
 	window.resize();
 }
 
-void mainLoop(std::string const& songlist) {
+/// Options of the frame capture mode (--capture)
+struct CaptureOptions {
+	fs::path folder;  ///< Where to save the frames (empty if not capturing)
+	unsigned every = 1;  ///< Save every Nth frame
+	unsigned frames = 0;  ///< Quit after this many frames (0 for no limit)
+	double fps = 60.0;  ///< Frame rate of the virtual time
+};
+
+void mainLoop(std::string const& songlist, CaptureOptions const& capture) {
 	Window window{};
 	SpdLogger::info(LogSystem::LOGGER, "Loading assets...");
 	TranslationEngine localization;
@@ -144,64 +175,121 @@ void mainLoop(std::string const& songlist) {
 	gm.loading(_("Entering main menu..."), 0.8f);
 	gm.updateScreen();  // exit/enter, any exception is fatal error
 	gm.loading(_("Loading complete!"), 1.0f);
+	// Capture mode renders as fast as possible, but animations advance by a fixed step per frame
+	bool const capturing = !capture.folder.empty();
+	if (capturing) {
+		fs::create_directories(capture.folder);
+		Clock::fix();
+		SpdLogger::notice(LogSystem::LOGGER, "Capturing every {} frame(s) at {} FPS virtual time to folder={}", capture.every, capture.fps, capture.folder);
+	}
+	ConfigHandle<bool> const fps("graphic/fps");
+	ConfigHandle<int> const maxFps("graphic/max_fps");
+	ConfigHandle<bool> const lowLatency("graphic/low_latency");
+	FramePacer pacer;
+	unsigned long frameNumber = 0;
 	// Main loop
-	auto time = Clock::now();
-	unsigned frames = 0;
+	auto time = Clock::Base::now();
 	SpdLogger::info(LogSystem::LOGGER, "Assets loaded, entering main loop.");
+	Trace::threadName("main");
+	// Input and textures for the next frame, done right after swapping or in low latency mode right before drawing
+	auto prepare = [&](Profiler& prof, bool benchmarking) {
+		{
+			TraceScope trace("prepare");
+			auto const uploads = updateTextures();
+			gm.prepareScreen();
+			audio.updateSettings();  // Publish possibly changed volume settings to the audio callback
+			if (uploads.overrun) prof.count("texture upload overrun ms", 1000.0 * uploads.time.count());
+			if (benchmarking) {
+				glFinish();
+				prof("textures");
+				prof.count("texture uploads", uploads.uploads);
+				prof.count("texture upload MB", static_cast<double>(uploads.bytes) / 1e6);
+				prof.count("textures waiting", static_cast<double>(uploads.waiting));
+			}
+		}
+		TraceScope trace("events");
+		auto eventTime = Clock::now();
+		gm.controllers.process(eventTime);
+		checkEvents(gm, eventTime);
+		if (benchmarking) prof("events");
+	};
 	while (!gm.isFinished()) {
+		TraceScope traceFrame("frame");
 		Profiler prof("mainloop");
-		bool benchmarking = config["graphic/fps"].b();
+		bool const benchmarking = *fps;
+		if (capturing || benchmarking) pacer.period(Seconds{});
+		else if (*maxFps > 0) pacer.period(Seconds(1.0 / *maxFps));
+		else {
+			double const refreshRate = window.refreshRate();
+			pacer.period(Seconds(1.0 / (refreshRate > 0.0 ? refreshRate : 100.0)));
+		}
+		if (!capturing) {
+			// Sleep only as long as the measured work allows for making the next deadline
+			TraceScope trace("sleep");
+			std::this_thread::sleep_until(pacer.wakeTime());
+			if (benchmarking) prof("fpsctrl");
+		}
+		pacer.workStarted(Clock::Base::now());
 		if (songs.doneLoading == true && songs.displayedAlert == false) {
 			gm.dialog(fmt::format(_("Done Loading!\n Loaded {0} songs."), songs.loadedSongs()));
 			songs.displayedAlert = true;
 		}
-		if (g_take_screenshot) {
-			try {
-				window.screenshot();
-				gm.flashMessage(_("Screenshot taken!"));
-			} catch (EXCEPTION& e) {
-				SpdLogger::error(LogSystem::IMAGE, "Screenshot failed, exception={}", e.what());
-				gm.flashMessage(_("Screenshot failed!"));
-			}
-			g_take_screenshot = false;
-		}
 		gm.updateScreen();  // exit/enter, any exception is fatal error
 		if (benchmarking) prof("misc");
 		try {
+			if (*lowLatency) prepare(prof, benchmarking);
+			Trace::begin("draw");
 			window.blank();
 			// Draw
 			window.render(gm, [&gm]{ gm.drawScreen(); });
 			if (benchmarking) { glFinish(); prof("draw"); }
+			Trace::end("draw");
+			// Only starts the readback; the image is saved in the background
+			if (g_take_screenshot) {
+				try {
+					window.screenshot();
+					gm.flashMessage(_("Screenshot taken!"));
+				} catch (EXCEPTION& e) {
+					SpdLogger::error(LogSystem::IMAGE, "Screenshot failed, exception={}", e.what());
+					gm.flashMessage(_("Screenshot failed!"));
+				}
+				g_take_screenshot = false;
+			}
+			if (capturing && frameNumber % capture.every == 0) window.screenshot(capture.folder / fmt::format("frame_{:06d}.png", frameNumber));
 			// Display (and wait until next frame)
+			pacer.swapStarted(Clock::Base::now());
+			Trace::begin("swap");
 			window.swap();
-			if (benchmarking) { glFinish(); prof("swap"); }
-			updateTextures();
-			gm.prepareScreen();
-			if (benchmarking) { glFinish(); prof("textures"); }
+			Trace::end("swap");
+			pacer.frameDone(Clock::Base::now());
+			auto const gl = glutil::GLErrorChecker::endFrame();
 			if (benchmarking) {
-				++frames;
-				if (Clock::now() - time > 1s) {
-					gm.flashMessage(fmt::format("{} FPS", frames));
-					time += 1s;
-					frames = 0;
-				}
-			} else {
-				std::this_thread::sleep_until(time + 10ms); // Max 100 FPS
-				time = Clock::now();
-				frames = 0;
+				glFinish();
+				prof("swap");
+				prof.count("gl calls", gl.calls);
+				prof.count("gl draws", gl.draws);
+				prof.count("gl errors", gl.errors);
 			}
-			if (benchmarking) prof("fpsctrl");
-			// Process events for the next frame
-			auto eventTime = Clock::now();
-			gm.controllers.process(eventTime);
-			checkEvents(gm, eventTime);
-			if (benchmarking) prof("events");
-			} catch (RUNTIME_ERROR& e) {
-				SpdLogger::error(LogSystem::LOGGER, "Caught error, exception={}", e.what());
-				gm.flashMessage(std::string("ERROR: ") + e.what());
+			if (capturing) Clock::advance(clockDur(Seconds(1.0 / capture.fps)));
+			if (benchmarking && Clock::Base::now() - time > 1s) {
+				auto const stats = pacer.interval();
+				gm.flashMessage(fmt::format("{} FPS, {:.1f} ms average, {:.1f} ms slowest", stats.frames, 1000.0 * stats.average().count(), 1000.0 * stats.worst.count()));
+				time = Clock::Base::now();
+			}
+			if (!*lowLatency) prepare(prof, benchmarking);
+		} catch (RUNTIME_ERROR& e) {
+			SpdLogger::error(LogSystem::LOGGER, "Caught error, exception={}", e.what());
+			gm.flashMessage(std::string("ERROR: ") + e.what());
 		}
+		if (capturing && ++frameNumber == capture.frames) gm.finished();
+	}
+	auto const& stats = pacer.stats();
+	if (stats.frames > 0) {
+		SpdLogger::notice(LogSystem::LOGGER, "{} frames in {:.2f} s: {:.2f} ms per frame on average, slowest {:.2f} ms, {} missed deadlines.",
+		  stats.frames, stats.total.count(), 1000.0 * stats.average().count(), 1000.0 * stats.worst.count(), stats.missed);
 	}
 
+	if (Trace::enabled()) writeTrace(gm);
 	writeConfig(gm);
 }
 
@@ -282,6 +370,8 @@ int main(int argc, char** argv) {
 	po::options_description opt1("Generic options", 160, 80);
 	std::string songlist;
 	std::string logLevel;
+	CaptureOptions capture;
+	std::string captureFolder;
 	opt1.add_options()
 	  ("help,h", "Print this message.")
 	  ("?,?", "Print this message.")
@@ -292,6 +382,12 @@ int main(int argc, char** argv) {
 	opt2.add_options()
 	  ("audio", po::value<std::vector<std::string> >(&devices)->value_name("<device>")->composing(), "Specify a string to match audio devices to use; see audiohelp for details.")
 	  ("audiohelp", "Print audio related information")
+	  ("audiobench", "Benchmark the audio mixer offline and print the worst-case block time")
+	  ("trace", "Record a performance trace from the start (Ctrl+F10 toggles tracing at runtime; the trace is saved in the cache folder)")
+	  ("capture", po::value<std::string>(&captureFolder)->value_name("<folder>"), "Render with a fixed timestep as fast as possible, saving frames as PNG in the folder, and report frame times")
+	  ("capture-every", po::value<unsigned>(&capture.every)->value_name("<n>"), "Save only every nth frame when capturing (default 1)")
+	  ("capture-frames", po::value<unsigned>(&capture.frames)->value_name("<n>"), "Quit after n frames when capturing (default: run until quit)")
+	  ("capture-fps", po::value<double>(&capture.fps)->value_name("<fps>"), "Frame rate of the fixed timestep when capturing (default 60)")
 	  ("jstest", "Utility to get joystick button mappings");
 	po::options_description opt3("Hidden options");
 	opt3.add_options()
@@ -318,6 +414,11 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 	po::notify(vm);
+	capture.folder = captureFolder;
+	if (capture.every == 0 || !(capture.fps > 0.0)) {
+		std::cerr << "Error: --capture-every and --capture-fps must be positive." << std::endl;
+		return EXIT_FAILURE;
+	}
 	auto levelString = UnicodeUtil::toUpper(logLevel);
 	auto levelEnum = spdlog::level::from_str(levelString);
 	
@@ -340,6 +441,7 @@ int main(int argc, char** argv) {
 
 		readConfig();
 		SpdLogger::toggleProfilerLogger();
+		if (vm.count("trace")) Trace::enable(true);
 
 		if (vm.count("audiohelp")) {
 			SpdLogger::notice(LogSystem::LOGGER, "Starting the audio subsystem for audiohelp (errors printed on console may be ignored).");
@@ -358,6 +460,13 @@ int main(int argc, char** argv) {
 		confOverride(songdirs, "paths/songs");
 		confOverride(devices, "audio/devices");
 		PathCache::getPaths(); // Initialize paths before other threads start
+		if (vm.count("audiobench")) {
+			std::vector<fs::path> samples;
+			for (auto const& name: { "drum_bass", "drum_snare", "drum_hi-hat", "drum_tom1", "drum_cymbal", "guitar_fail1", "guitar_fail2", "guitar_fail3" })
+				samples.push_back(findFile(fmt::format("sounds/{}.ogg", name)));
+			benchmarkMixer(samples, 256, 20000);
+			return EXIT_SUCCESS;
+		}
 		if (vm.count("jstest")) { // Joystick test program
 			SpdLogger::info(LogSystem::CONTROLLERS, 
 				"Starting jstest input test utility.\n"
@@ -369,7 +478,7 @@ int main(int argc, char** argv) {
 			return EXIT_SUCCESS;
 		}
 		// Run the game init and main loop
-		mainLoop(songlist);
+		mainLoop(songlist, capture);
 		SpdLogger::info(LogSystem::LOGGER, "Exiting normally.");
 	}
 	catch (EXCEPTION& e) {
@@ -70,6 +70,7 @@ const float baseLine = -0.2f;
 const float pixUnit = 0.2f;
 
 void NoteGraph::draw(Window& window, double time, Database const& database, Position position) {
+	static ConfigHandle<bool> const pitch("game/pitch");
 	if (time < m_time) reset();
 	m_time = time;
 	// Update m_songit (which note to start the rendering from)
@@ -115,7 +116,7 @@ void NoteGraph::draw(Window& window, double time, Database const& database, Posi
 	ColorTrans c(window, Color::alpha(m_notealpha));
 
 	drawNotes(window);
-	if (config["game/pitch"].b())
+	if (*pitch)
 		drawWaves(window, database);
 
 	// Draw a star for well sung notes
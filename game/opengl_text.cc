@@ -44,18 +44,20 @@ void loadFonts() {
 	}
 }
 
-OpenGLText::OpenGLText(std::string const& text, std::unique_ptr<Texture>& texture, float width, float height)
-: m_text(text), m_texture(std::move(texture)), m_width(width), m_height(height) {
+OpenGLText::OpenGLText(std::string const& text, std::shared_ptr<Texture> texture, float width, float height)
+: m_text(text), m_texture(std::move(texture)), m_dimensions(m_texture->dimensions), m_tex(m_texture->tex), m_width(width), m_height(height) {
 }
 
 OpenGLText::OpenGLText(OpenGLText&& other)
-: m_text(std::move(other.m_text)), m_texture(std::move(other.m_texture)), m_width(other.m_width), m_height(other.m_height) {
+: m_text(std::move(other.m_text)), m_texture(std::move(other.m_texture)), m_dimensions(other.m_dimensions), m_tex(other.m_tex), m_width(other.m_width), m_height(other.m_height) {
 	other.m_width = other.m_height = 0.f;
 }
 
 OpenGLText& OpenGLText::operator=(OpenGLText&& other) {
 	m_text = std::move(other.m_text);
 	m_texture = std::move(other.m_texture);
+	m_dimensions = other.m_dimensions;
+	m_tex = other.m_tex;
 	m_width = other.m_width;
 	m_height = other.m_height;
 
@@ -65,13 +67,14 @@ OpenGLText& OpenGLText::operator=(OpenGLText&& other) {
 }
 
 void OpenGLText::draw(Window& window) {
-	m_texture->draw(window);
+	draw(window, m_dimensions, m_tex);
 }
 
 void OpenGLText::draw(Window& window, Dimensions &_dim, TexCoords &_tex) {
-	m_texture->dimensions = _dim;
-	m_texture->tex = _tex;
-	m_texture->draw(window);
+	// The texture is shared, so it is drawn with our own dimensions instead of its own
+	if (m_texture->empty()) return;
+	glutil::DrawBatch::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);  // Rendered premultiplied
+	m_texture->draw(window, _dim, _tex);
 }
 
 namespace {
@@ -52,13 +52,13 @@ struct TextStyle {
 };
 
 /// this class will enable to create a texture from a themed text structure
-/** it will not cache any data (class using this class should)
+/** the texture may be shared with other instances of the same text and style (see TextRenderer)
  * it provides size of the texture are drawn (x,y)
  * it provides size of the texture created (x_power_of_two, y_power_of_two)
  */
 class OpenGLText {
 public:
-	OpenGLText(std::string const& text, std::unique_ptr<Texture>&, float width, float height);
+	OpenGLText(std::string const& text, std::shared_ptr<Texture> texture, float width, float height);
 	OpenGLText(OpenGLText&&);
 
 	OpenGLText& operator=(OpenGLText&&);
@@ -70,11 +70,13 @@ public:
 	float getWidth() const { return m_width; }
 	float getHeight() const { return m_height; }
 	/// @returns dimension of texture
-	Dimensions& dimensions() { return m_texture->dimensions; }
+	Dimensions& dimensions() { return m_dimensions; }
 
 private:
 	std::string m_text;
-	std::unique_ptr<Texture> m_texture;
+	std::shared_ptr<Texture> m_texture;
+	Dimensions m_dimensions;
+	TexCoords m_tex;
 	float m_width;
 	float m_height;
 };
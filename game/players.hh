@@ -62,6 +62,8 @@ class Players {
 	/// const array access
 	PlayerItem operator[](unsigned pos) const;
 	unsigned count() const { return static_cast<unsigned>(m_filtered.size()); }
+	/// Call f for every PlayerItem (not just the filtered ones)
+	template <typename F> void forEach(F&& f) const { for (auto const& p: m_players) f(p); }
 	bool isEmpty() const { return m_filtered.empty(); }
 	/// advances to next player
 	void advance(std::ptrdiff_t diff);
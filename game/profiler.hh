@@ -44,24 +44,29 @@ class Profiler {
 	typedef std::map<std::string, ProfCP> Checkpoints;
 	typedef std::pair<std::string, ProfCP> Pair;
 	Checkpoints m_checkpoints;
+	Checkpoints m_counters;
 	std::string m_name;
 	Time m_time;
 	static bool cmpFunc(Pair const& a, Pair const& b) { return a.second.total > b.second.total; }
   public:
 	/// Start a profiler with the given name
-	Profiler(std::string const& name): m_name(name), m_time(Clock::now()) {}
+	Profiler(std::string const& name): m_name(name), m_time(Clock::Base::now()) {}
 	~Profiler() { dump(); }
 	/// Profiling checkpoint: record the duration since construction or previous checkpoint.
 	/// If no tag is specified, no recording is done.
 	void operator()(std::string const& tag = std::string()) {
-		auto n = Clock::now();
+		auto n = Clock::Base::now();
 		std::swap(n, m_time);
 		double t = Seconds(m_time - n).count();
 		m_checkpoints[tag].add(t);
 	}
+	/// Record a value that is not a duration (e.g. a per-frame counter)
+	void count(std::string const& tag, double value) {
+		m_counters[tag].add(value);
+	}
 	/// Dump current stats to log and reset
 	void dump() {
-		if (m_checkpoints.empty()) return;
+		if (m_checkpoints.empty() && m_counters.empty()) return;
 		std::vector<Pair> cps(m_checkpoints.begin(), m_checkpoints.end());
 		m_checkpoints.clear();
 		std::sort(cps.begin(), cps.end(), cmpFunc);
@@ -69,6 +74,10 @@ class Profiler {
 		for (std::vector<Pair>::const_iterator it = cps.begin(); it != cps.end(); ++it) {
 			fmt::format_to(std::back_inserter(prof), "{}: ({}). ", it->first, it->second);
 		}
+		for (auto const& [tag, cp]: m_counters) {
+			fmt::format_to(std::back_inserter(prof), "{}: ({:.1f} average, {} peak). ", tag, cp.avg, cp.peak);
+		}
+		m_counters.clear();
 		
 		SpdLogger::debug(LogSystem::PROFILER, prof);
 	}
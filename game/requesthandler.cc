@@ -1,16 +1,46 @@
 #include "requesthandler.hh"
 #include "unicode.hh"
 #include "game.hh"
+#include "webreply.hh"
 
+#include <algorithm>
 #include <cstdint>
 
 #ifdef USE_WEBSERVER
+namespace {
+	std::string header(web::http::http_request const& request, utility::string_t const& name) {
+		auto const& headers = request.headers();
+		auto it = headers.find(name);
+		return it == headers.end() ? std::string() : utility::conversions::to_utf8string(it->second);
+	}
+
+	/// The parts of the request that the web server logic needs
+	WebRequest webRequest(web::http::http_request const& request) {
+		WebRequest result;
+		for (auto const& [name, value]: web::uri::split_query(request.relative_uri().query())) {
+			result.query[utility::conversions::to_utf8string(web::uri::decode(name))] = utility::conversions::to_utf8string(web::uri::decode(value));
+		}
+		result.acceptEncoding = header(request, web::http::header_names::accept_encoding);
+		result.ifNoneMatch = header(request, web::http::header_names::if_none_match);
+		return result;
+	}
+
+	void send(web::http::http_request request, WebReply const& reply) {
+		web::http::http_response response(reply.status);
+		for (auto const& [name, value]: reply.headers) {
+			response.headers().add(utility::conversions::to_string_t(name), utility::conversions::to_string_t(value));
+		}
+		if (reply.body) response.set_body(*reply.body, reply.contentType);
+		request.reply(response);
+	}
+}
+
 RequestHandler::RequestHandler(Game& game, Songs& songs)
-	: m_game(game), m_songs(songs) {
+	: m_game(game), m_library(songs) {
 }
 
 RequestHandler::RequestHandler(Game& game, std::string url, Songs& songs)
-	: m_listener(utility::conversions::to_string_t(url)), m_game(game), m_songs(songs) {
+	: m_listener(utility::conversions::to_string_t(url)), m_game(game), m_library(songs), m_assets(std::make_unique<WebAssets const>(WebAssets::webFolders(getThemePaths()))) {
 	m_listener.support(web::http::methods::GET, std::bind(&RequestHandler::Get, this, std::placeholders::_1));
 	m_listener.support(web::http::methods::PUT, std::bind(&RequestHandler::Put, this, std::placeholders::_1));
 	m_listener.support(web::http::methods::POST, std::bind(&RequestHandler::Post, this, std::placeholders::_1));
@@ -26,50 +56,8 @@ void RequestHandler::Error(pplx::task<void>& t) {
 	}
 }
 
-void RequestHandler::HandleFile(web::http::http_request request, std::string filePath) {
-	auto path = filePath != "" ? utility::conversions::to_utf8string(utility::conversions::to_string_t(filePath)) : utility::conversions::to_utf8string(request.relative_uri().path());
-	auto fileName = path.substr(path.find_last_of("/\\") + 1);
-
-	std::string fileToSend = findFile(fileName).string();
-
-	concurrency::streams::fstream::open_istream(utility::conversions::to_string_t(fileToSend), std::ios::in).then([=](concurrency::streams::istream is) {
-		std::string content_type = "";
-		if (path.find(".html") != std::string::npos) {
-			content_type = "text/html";
-		}
-		else if (path.find(".js") != std::string::npos) {
-			content_type = "text/javascript";
-		}
-		else if (path.find(".css") != std::string::npos) {
-			content_type = "text/css";
-		}
-		else if (path.find(".png") != std::string::npos) {
-			content_type = "image/png";
-		}
-		else if (path.find(".gif") != std::string::npos) {
-			content_type = "image/gif";
-		}
-		else if (path.find(".ico") != std::string::npos) {
-			content_type = "image/x-icon";
-		}
-
-		request.reply(web::http::status_codes::OK, is, utility::conversions::to_string_t(content_type)).then([](pplx::task<void> t) {
-			try {
-				t.get();
-			}
-			catch (...) {
-				//
-			}
-			});
-
-		}).then([=](pplx::task<void>t) {
-			try {
-				t.get();
-			}
-			catch (...) {
-				request.reply(web::http::status_codes::InternalError, utility::conversions::to_string_t("INTERNAL ERROR "));
-			}
-			});
+void RequestHandler::HandleFile(web::http::http_request request, std::string const& fileName) {
+	send(request, replyAsset(webRequest(request), m_assets.get(), fileName));
 }
 
 void RequestHandler::Get(web::http::http_request request)
@@ -83,44 +71,16 @@ void RequestHandler::Get(web::http::http_request request)
 	SpdLogger::debug(LogSystem::WEBSERVER, "RequestHandler GET request, path={}", utility::conversions::to_utf8string(uri));
 	auto path = utility::conversions::to_utf8string(request.relative_uri().path());
 	if (path == "/") {
-		HandleFile(request, findFile("index.html").string());
+		HandleFile(request, "index.html");
 	}
 	else if (path == "/api/getDataBase.json") { //get database
-		m_songs.setFilter("");
-		if (query == "sort=artist&order=ascending") {
-			m_songs.sortSpecificChange(2);
-		}
-		else if (query == "sort=artist&order=descending") {
-			m_songs.sortSpecificChange(2, true);
-		}
-		else if (query == "sort=title&order=ascending") {
-			m_songs.sortSpecificChange(1);
-		}
-		else if (query == "sort=title&order=descending") {
-			m_songs.sortSpecificChange(1, true);
-		}
-		else if (query == "sort=language&order=ascending") {
-			m_songs.sortSpecificChange(6);
-		}
-		else if (query == "sort=language&order=descending") {
-			m_songs.sortSpecificChange(6, true);
-		}
-		else if (query == "sort=edition&order=ascending") {
-			m_songs.sortSpecificChange(3);
-		}
-		else if (query == "sort=edition&order=descending") {
-			m_songs.sortSpecificChange(3, true);
-		}
-		else if (query == "sort=creator&order=ascending") {
-			m_songs.sortSpecificChange(10);
-		}
-		else if (query == "sort=creator&order=descending") {
-			m_songs.sortSpecificChange(10, true);
+		auto const webReq = webRequest(request);
+		auto const catalogueQuery = parseCatalogueQuery(webReq);
+		if (!catalogueQuery) {
+			send(request, WebReply::text(web::http::status_codes::BadRequest, "Offset and limit must be numbers."));
+			return;
 		}
-		// make sure to apply the filtering
-		m_songs.update();
-		web::json::value jsonRoot = SongsToJsonObject();
-		request.reply(web::http::status_codes::OK, jsonRoot);
+		send(request, replyCatalogue(webReq, m_library.snapshot()->catalogue, *catalogueQuery));
 		return;
 	}
 	else if (path == "/api/language") {
@@ -165,7 +125,8 @@ void RequestHandler::Get(web::http::http_request request)
 		return;
 	}
 	else {
-		HandleFile(request);
+		// Like findFile, files are found by their name in any of the web folders
+		HandleFile(request, path.substr(path.find_last_of("/\\") + 1));
 	}
 }
 
@@ -188,7 +149,6 @@ void RequestHandler::Post(web::http::http_request request)
 	}
 
 	if (path == "/api/add") {
-		m_songs.setFilter("");
 		std::shared_ptr<Song> songPointer = GetSongFromJSON(jsonPostBody);
 		if (!songPointer) {
 			auto artist = utility::conversions::to_utf8string(jsonPostBody[utility::conversions::to_string_t("Artist")].as_string());
@@ -264,22 +224,9 @@ void RequestHandler::Post(web::http::http_request request)
 		}
 	}
 	else if (path == "/api/search") {
-		auto query = utility::conversions::to_utf8string(jsonPostBody[utility::conversions::to_string_t("query")].as_string());
-		m_songs.setFilter(query);
-		web::json::value jsonRoot = web::json::value::array();
-		for (size_t i = 0; i < m_songs.size(); i++) {
-			web::json::value songObject = web::json::value::object();
-			songObject[utility::conversions::to_string_t("Title")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->title));
-			songObject[utility::conversions::to_string_t("Artist")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->artist));
-			songObject[utility::conversions::to_string_t("Edition")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->edition));
-			songObject[utility::conversions::to_string_t("Language")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->language));
-			songObject[utility::conversions::to_string_t("Creator")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->creator));
-			songObject[utility::conversions::to_string_t("HasError")] = web::json::value::boolean(m_songs[i]->loadStatus == Song::LoadStatus::PARSERERROR);
-			songObject[utility::conversions::to_string_t("ProvidedBy")] = web::json::value(utility::conversions::to_string_t(m_songs[i]->providedBy));
-			songObject[utility::conversions::to_string_t("Comment")] = web::json::value(utility::conversions::to_string_t(m_songs[i]->comment));
-			jsonRoot[i] = songObject;
-		}
-		request.reply(web::http::status_codes::OK, jsonRoot);
+		Catalogue::Query catalogueQuery;
+		catalogueQuery.search = utility::conversions::to_utf8string(jsonPostBody[utility::conversions::to_string_t("query")].as_string());
+		send(request, replyCatalogue(webRequest(request), m_library.snapshot()->catalogue, catalogueQuery));
 		return;
 	}
 	else {
@@ -316,41 +263,21 @@ web::json::value RequestHandler::ExtractJsonFromRequest(web::http::http_request
 }
 
 
-web::json::value RequestHandler::SongsToJsonObject() {
-	web::json::value jsonRoot = web::json::value::array();
-	for (size_t i = 0; i < m_songs.size(); i++) {
-		web::json::value songObject = web::json::value::object();
-		songObject[utility::conversions::to_string_t("Title")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->title));
-		songObject[utility::conversions::to_string_t("Artist")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->artist));
-		songObject[utility::conversions::to_string_t("Edition")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->edition));
-		songObject[utility::conversions::to_string_t("Language")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->language));
-		songObject[utility::conversions::to_string_t("Creator")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->creator));
-		songObject[utility::conversions::to_string_t("name")] = web::json::value::string(utility::conversions::to_string_t(m_songs[i]->artist + " " + m_songs[i]->title));
-		songObject[utility::conversions::to_string_t("HasError")] = web::json::value::boolean(m_songs[i]->loadStatus == Song::LoadStatus::PARSERERROR);
-		songObject[utility::conversions::to_string_t("ProvidedBy")] = web::json::value(utility::conversions::to_string_t(m_songs[i]->providedBy));
-		songObject[utility::conversions::to_string_t("Comment")] = web::json::value(utility::conversions::to_string_t(m_songs[i]->comment));
-		jsonRoot[i] = songObject;
-	}
-
-	return jsonRoot;
-}
-
 std::shared_ptr<Song> RequestHandler::GetSongFromJSON(web::json::value jsonDoc) {
-	m_songs.setFilter("");
-
-	for (size_t i = 0; i < m_songs.size(); i++) {
-		if (m_songs[i]->title == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Title")].as_string()) &&
-			m_songs[i]->artist == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Artist")].as_string()) &&
-			m_songs[i]->edition == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Edition")].as_string()) &&
-			m_songs[i]->language == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Language")].as_string()) &&
-			m_songs[i]->creator == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Creator")].as_string()) &&
-			m_songs[i]->providedBy == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("ProvidedBy")].as_string()) &&
-			m_songs[i]->comment == utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Comment")].as_string())) {
-				SpdLogger::info(LogSystem::WEBSERVER, "Found requested song, {} - {}", m_songs[i]->artist, m_songs[i]->title);
-				return m_songs[i];
-		}
+	auto field = [&](char const* name) { return utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t(name)].as_string()); };
+	Catalogue::Entry fields;
+	fields.title = field("Title");
+	fields.artist = field("Artist");
+	fields.edition = field("Edition");
+	fields.language = field("Language");
+	fields.creator = field("Creator");
+	fields.providedBy = field("ProvidedBy");
+	fields.comment = field("Comment");
+	if (auto song = m_library.snapshot()->find(fields)) {
+		SpdLogger::info(LogSystem::WEBSERVER, "Found requested song, {} - {}", song->artist, song->title);
+		return song;
 	}
-	SpdLogger::info(LogSystem::WEBSERVER, "Couldn't find requested song, {} - {}", utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Artist")].as_string()), utility::conversions::to_utf8string(jsonDoc[utility::conversions::to_string_t("Title")].as_string()));
+	SpdLogger::info(LogSystem::WEBSERVER, "Couldn't find requested song, {} - {}", fields.artist, fields.title);
 	return std::shared_ptr<Song>();
 }
 
@@ -380,6 +307,7 @@ std::vector<std::string> RequestHandler::GetTranslationKeys() {
 		translate_noop("Inverted"),
 		translate_noop("Update every 10 sec"),
 		translate_noop("Refresh database"),
+		translate_noop("Load more songs"),
 		translate_noop("Upcoming songs"),
 		translate_noop("Refresh playlist"),
 		translate_noop("Web interface by Niek Nooijens and Arjan Speiard, for full credits regarding Performous see /docs/Authors.txt"),
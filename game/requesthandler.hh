@@ -5,6 +5,10 @@
 #include <cpprest/filestream.h>
 
 #include "screen_playlist.hh"
+#include "webassets.hh"
+#include "weblibrary.hh"
+
+#include <memory>
 
 class RequestHandler
 {
@@ -25,8 +29,7 @@ class RequestHandler
 
 	web::json::value ExtractJsonFromRequest(web::http::http_request request);
 
-	void HandleFile(web::http::http_request request, std::string filePath = "");
-	web::json::value SongsToJsonObject();
+	void HandleFile(web::http::http_request request, std::string const& fileName);
 	std::map<std::string, std::string> GenerateLocaleDict();
 	std::vector<std::string> GetTranslationKeys();
 	std::shared_ptr<Song> GetSongFromJSON(web::json::value);
@@ -34,7 +37,8 @@ class RequestHandler
 	web::http::experimental::listener::http_listener m_listener;
 
 	Game& m_game;
-	Songs& m_songs;
+	WebLibrary m_library;
+	std::unique_ptr<WebAssets const> m_assets;  ///< The web frontend, loaded when the server starts
 };
 #else
 class Songs;
@@ -0,0 +1,151 @@
+#include "samplemix.hh"
+
+#include "libda/sample.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86)))
+#define SAMPLEMIX_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SAMPLEMIX_AVX2_TARGET
+#else
+#define SAMPLEMIX_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SAMPLEMIX_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace samplemix {
+	namespace {
+		constexpr float s16Scale = 1.0f / da::max_s16;
+
+		/// Level offsets (in frames) of the lanes of an eight sample block of interleaved stereo
+		alignas(32) constexpr float frameOffsets[8] = { 0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f };
+
+		/// Number of samples processed by the vector loop, the rest is left for the scalar tail
+		std::size_t blocks(std::size_t samples, std::size_t width) { return samples - samples % width; }
+
+#ifdef SAMPLEMIX_X86
+		void sse2(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain) {
+			const std::size_t n = blocks(samples, 8);
+			const __m128 scale = _mm_set1_ps(gain.scale * s16Scale);
+			const __m128 step = _mm_set1_ps(gain.step);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 offsetLo = _mm_load_ps(frameOffsets);
+			const __m128 offsetHi = _mm_load_ps(frameOffsets + 4);
+			__m128 frame = _mm_set1_ps(gain.level);
+			const __m128 frameStep = _mm_mul_ps(_mm_set1_ps(4.0f), step);
+			for (std::size_t i = 0; i < n; i += 8) {
+				__m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+				// Sign-extend to 32 bits by placing the sample in the high half and shifting down
+				__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+				__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+				__m128 levelLo = _mm_min_ps(one, _mm_max_ps(zero, _mm_add_ps(frame, _mm_mul_ps(offsetLo, step))));
+				__m128 levelHi = _mm_min_ps(one, _mm_max_ps(zero, _mm_add_ps(frame, _mm_mul_ps(offsetHi, step))));
+				_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_mul_ps(lo, scale), levelLo)));
+				_mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_mul_ps(hi, scale), levelHi)));
+				frame = _mm_add_ps(frame, frameStep);
+			}
+			scalar(dst + n, src + n, samples - n, gain.advanced(n));
+		}
+
+		SAMPLEMIX_AVX2_TARGET void avx2(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain) {
+			const std::size_t n = blocks(samples, 8);
+			const __m256 scale = _mm256_set1_ps(gain.scale * s16Scale);
+			const __m256 step = _mm256_set1_ps(gain.step);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 offset = _mm256_load_ps(frameOffsets);
+			__m256 frame = _mm256_set1_ps(gain.level);
+			const __m256 frameStep = _mm256_mul_ps(_mm256_set1_ps(4.0f), step);
+			for (std::size_t i = 0; i < n; i += 8) {
+				__m256 s = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i))));
+				__m256 level = _mm256_min_ps(one, _mm256_max_ps(zero, _mm256_add_ps(frame, _mm256_mul_ps(offset, step))));
+				_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_mul_ps(s, scale), level)));
+				frame = _mm256_add_ps(frame, frameStep);
+			}
+			scalar(dst + n, src + n, samples - n, gain.advanced(n));
+		}
+
+		bool hasAvx2() {
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return false;
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;  // OS must save the YMM registers
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+#ifdef SAMPLEMIX_NEON
+		void neon(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain) {
+			const std::size_t n = blocks(samples, 8);
+			const float32x4_t scale = vdupq_n_f32(gain.scale * s16Scale);
+			const float32x4_t step = vdupq_n_f32(gain.step);
+			const float32x4_t zero = vdupq_n_f32(0.0f);
+			const float32x4_t one = vdupq_n_f32(1.0f);
+			const float32x4_t offsetLo = vld1q_f32(frameOffsets);
+			const float32x4_t offsetHi = vld1q_f32(frameOffsets + 4);
+			float32x4_t frame = vdupq_n_f32(gain.level);
+			const float32x4_t frameStep = vmulq_n_f32(step, 4.0f);
+			for (std::size_t i = 0; i < n; i += 8) {
+				int16x8_t s = vld1q_s16(src + i);
+				float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+				float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+				float32x4_t levelLo = vminq_f32(one, vmaxq_f32(zero, vmlaq_f32(frame, offsetLo, step)));
+				float32x4_t levelHi = vminq_f32(one, vmaxq_f32(zero, vmlaq_f32(frame, offsetHi, step)));
+				vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vmulq_f32(lo, scale), levelLo));
+				vst1q_f32(dst + i + 4, vmlaq_f32(vld1q_f32(dst + i + 4), vmulq_f32(hi, scale), levelHi));
+				frame = vaddq_f32(frame, frameStep);
+			}
+			scalar(dst + n, src + n, samples - n, gain.advanced(n));
+		}
+#endif
+
+		std::vector<KernelInfo> detect() {
+			std::vector<KernelInfo> kernels{ { "scalar", &scalar } };
+#ifdef SAMPLEMIX_X86
+			kernels.push_back({ "sse2", &sse2 });
+			if (hasAvx2()) kernels.push_back({ "avx2", &avx2 });
+#endif
+#ifdef SAMPLEMIX_NEON
+			kernels.push_back({ "neon", &neon });
+#endif
+			return kernels;
+		}
+	}
+
+	void scalar(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain) {
+		const float scale = gain.scale * s16Scale;
+		if (gain.step == 0.0f) {
+			const float s = scale * std::clamp(gain.level, 0.0f, 1.0f);
+			for (std::size_t i = 0; i < samples; ++i) dst[i] += s * static_cast<float>(src[i]);
+			return;
+		}
+		for (std::size_t i = 0; i < samples; ++i) {
+			const float level = std::clamp(gain.level + gain.step * static_cast<float>(i / 2), 0.0f, 1.0f);
+			dst[i] += scale * level * static_cast<float>(src[i]);
+		}
+	}
+
+	std::vector<KernelInfo> const& supported() {
+		static const std::vector<KernelInfo> kernels = detect();
+		return kernels;
+	}
+
+	Kernel best() {
+		static const Kernel kernel = supported().back().kernel;
+		return kernel;
+	}
+}
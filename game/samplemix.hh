@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file samplemix.hh Vectorized kernels for mixing s16 audio into float buffers.
+ *
+ * All kernels compute dst[i] += src[i] / 32767 * scale * clamp(level + step * (i / 2), 0, 1)
+ * for interleaved stereo input, i.e. the fade level advances once per frame. This folds the
+ * int16 conversion, volume and fade ramp into a single pass over the data.
+ */
+
+namespace samplemix {
+	/// Gain applied while mixing
+	struct Gain {
+		float scale = 1.0f;  ///< Constant gain (volume, replay gain, track level)
+		float level = 1.0f;  ///< Fade level of the first frame
+		float step = 0.0f;  ///< Fade level increment per stereo frame (the level is clamped to [0, 1])
+		/// Gain for the same ramp continuing after the given number of samples
+		Gain advanced(std::size_t samples) const { return { scale, level + step * static_cast<float>(samples / 2), step }; }
+	};
+
+	using Kernel = void (*)(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain);
+
+	struct KernelInfo {
+		char const* name;
+		Kernel kernel;
+	};
+
+	/// Portable implementation, also used for the tails of the vectorized kernels
+	void scalar(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain);
+	/// All kernels that can run on this CPU, scalar first and fastest last
+	std::vector<KernelInfo> const& supported();
+	/// The fastest kernel for this CPU (detected once at runtime)
+	Kernel best();
+	/// Mix using the fastest kernel
+	inline void mix(float* dst, std::int16_t const* src, std::size_t samples, Gain const& gain) { best()(dst, src, samples, gain); }
+}
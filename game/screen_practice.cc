@@ -90,7 +90,7 @@ void ScreenPractice::draw_analyzers() {
 		m_vumeters[i]->draw(window, static_cast<float>(analyzer.getPeak() / 43.0 + 1.0));
 
 		if (freq != 0.0) {
-			Analyzer::tones_t tones = analyzer.getTones();
+			Analyzer::tones_t const& tones = analyzer.getTones();
 
 			for (Analyzer::tones_t::const_iterator t = tones.begin(); t != tones.end(); ++t) {
 				if (t->age < Tone::MINAGE) continue;
@@ -536,11 +536,15 @@ size_t ScreenSing::players() const {
 }
 
 void ScreenSing::draw() {
+	static ConfigHandle<float> const videoDelay("audio/video_delay");
+	static ConfigHandle<bool> const webcam("graphic/webcam");
+	static ConfigHandle<unsigned short> const karaokeMode("game/karaoke_mode");
+	static ConfigHandle<bool> const autoplay("game/autoplay");
 	auto& window = getGame().getWindow();
 	// Get the time in the song
 	double length = m_audio.getLength();
 	double time = m_audio.getPosition();
-	time -= config["audio/video_delay"].f();
+	time -= *videoDelay;
 	double songPercent = clamp(time / length);
 
 	// Rendering starts
@@ -553,7 +557,7 @@ void ScreenSing::draw() {
 		if (ar > arMax || (m_video && ar > arMin)) fillBG(window);  // Fill white background to avoid black borders
 		m_background->draw(window);
 		// Webcam
-		if (m_cam && config["graphic/webcam"].b())
+		if (m_cam && *webcam)
 			m_cam->render();
 		// Video
 		if (m_video) {
@@ -601,8 +605,8 @@ void ScreenSing::draw() {
 			if (status == Song::Status::INSTRUMENTAL_BREAK) {
 				statustxt += _("   ENTER to skip instrumental break");
 			}
-			if (status == Song::Status::FINISHED && !config["game/karaoke_mode"].ui()) {
-				if(config["game/autoplay"].b()) {
+			if (status == Song::Status::FINISHED && !*karaokeMode) {
+				if(*autoplay) {
 					if(m_displayAutoPlay) {
 						statustxt += _("   Autoplay enabled");
 					} else {
@@ -624,7 +628,7 @@ void ScreenSing::draw() {
 						statustxt += _("   Choose your next song!");
 					}
 				}
-			} else if(status == Song::Status::FINISHED && config["game/autoplay"].b()) {
+			} else if(status == Song::Status::FINISHED && *autoplay) {
 				statustxt += _("   Autoplay enabled");
 			}
 		}
@@ -632,7 +636,7 @@ void ScreenSing::draw() {
 		theme->timer.draw(window, statustxt);
 	}
 
-	if (config["game/karaoke_mode"].ui() && !m_song->hasControllers()) { //guitar track? display the score window anyway!
+	if (*karaokeMode && !m_song->hasControllers()) { //guitar track? display the score window anyway!
 		if (!m_audio.isPlaying()) {
 			getGame().activateScreen("Playlist");
 			return;
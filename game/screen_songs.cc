@@ -23,6 +23,13 @@
 
 static const double IDLE_TIMEOUT = 35.0; // seconds
 
+namespace {
+	float videoDelay() {
+		static ConfigHandle<float> const delay("audio/video_delay");
+		return *delay;
+	}
+}
+
 ScreenSongs::ScreenSongs(Game &game, std::string const& name, Audio& audio, Songs& songs, Database& database):
   Screen(game, name), m_audio(audio), m_songs(songs), m_database(database)
 {
@@ -33,6 +40,7 @@ ScreenSongs::ScreenSongs(Game &game, std::string const& name, Audio& audio, Song
 }
 
 void ScreenSongs::enter() {
+	m_covers = std::make_unique<CoverCache>(std::size_t{ config["graphic/cover_cache"].ui() } << 20);
 	m_menu.close();
 	m_songs.setFilter(m_search.text);
 	m_audio.fadeout(getGame());
@@ -55,7 +63,7 @@ void ScreenSongs::reloadGL() {
 }
 
 void ScreenSongs::exit() {
-	m_covers.clear();
+	m_covers.reset();
 	m_menu.clear();
 	m_menuTheme.reset();
 	m_singCover.reset();
@@ -149,7 +157,7 @@ void ScreenSongs::manageEvent(SDL_Event event) {
 	// Handle less common, keyboard only keys
 	if (event.type == SDL_TEXTINPUT) {
 		m_search += event.text.text;
-		m_songs.setFilter(m_search.text);
+		m_songs.setFilterAsync(m_search.text);
 	}
 	else if (event.type == SDL_KEYDOWN) {
 		SDL_Keysym keysym = event.key.keysym;
@@ -158,7 +166,7 @@ void ScreenSongs::manageEvent(SDL_Event event) {
 		if (key == SDL_SCANCODE_F4) m_jukebox = !m_jukebox;
 		else if (key == SDL_SCANCODE_BACKSPACE) {
 			m_search.backspace();
-			m_songs.setFilter(m_search.text);
+			m_songs.setFilterAsync(m_search.text);
 		}
 		else if (!m_jukebox) {
 			if (key == SDL_SCANCODE_R && mod & Platform::shortcutModifier()) {
@@ -178,8 +186,8 @@ void ScreenSongs::manageEvent(SDL_Event event) {
 
 void ScreenSongs::update() {
 	getGame().showLogo(!m_jukebox);
+	m_songs.update(); // Poll for new songs and search results
 	if (m_idleTimer.get() < 0.3) return;  // Only update when the user gives us a break
-	m_songs.update(); // Poll for new songs
 	bool songChange = false;  // Do we need to switch songs?
 	// Automatic song browsing
 	if (!m_audio.isPaused() && m_idleTimer.get() > 1.0) {
@@ -239,7 +247,7 @@ void ScreenSongs::sing() {
 }
 
 void ScreenSongs::prepare() {
-	double time = m_audio.getPosition() - config["audio/video_delay"].f();
+	double time = m_audio.getPosition() - videoDelay();
 	if (m_video) m_video->prepare(time);
 }
 
@@ -254,7 +262,7 @@ void ScreenSongs::drawJukebox() {
 		Song& song = m_songs.current();
 		// Draw the cover
 		Texture* cover = nullptr;
-		if (!song.cover.empty()) cover = loadTextureFromMap(song.cover);
+		if (!song.cover.empty()) cover = &m_covers->get(song.cover, CoverCache::Size::FULL);
 		if (cover && !cover->empty()) {
 			Texture& s = *cover;
 			s.dimensions.left(theme->song.dimensions.x1()).top(theme->song.dimensions.y2() + 0.05f).fitInside(0.15f, 0.15f);
@@ -270,7 +278,7 @@ void ScreenSongs::drawMultimedia() {
 	if (!m_songs.empty()) {
 		Transform ft(window, farTransform());  // 3D effect
 		double length = m_audio.getLength();
-		double time = clamp(m_audio.getPosition() - config["audio/video_delay"].f(), 0.0, length);
+		double time = clamp(m_audio.getPosition() - videoDelay(), 0.0, length);
 		m_songbg_default->draw(window);   // Default bg
 		if (m_songbg.get() && !m_video.get()) {
 			if (m_songbg->width() > 512 && m_songbg->dimensions.ar() > 1.1f) {
@@ -402,7 +410,7 @@ void ScreenSongs::drawCovers() {
 		// Use actual song BPM. FIXME: Should only do this if currentId is also playing.
 		if (m_songs.currentPtr() && m_songs.currentPtr()->music == m_playing) {
 				if (m_songs.currentPtr()->hasControllers() || !m_songs.currentPtr()->beats.empty()) {
-				double t = m_audio.getPosition() - config["audio/video_delay"].f();
+				double t = m_audio.getPosition() - videoDelay();
 				Song::Beats const& beats = m_songs.current().beats;
 				auto it = std::lower_bound(m_songs.currentPtr()->hasControllers() ? beats.begin() : (beats.begin() + 1), beats.end(), t);
 				if (it != beats.begin() && it != beats.end()) {
@@ -421,12 +429,21 @@ void ScreenSongs::drawCovers() {
 		}
 	}
 	beat = 1.0 + std::pow(std::abs(std::cos(0.5 * TAU * beat)), 10.0);  // Overdrive pulse
-	// Draw covers and reflections
 	int idx = static_cast<int>(baseidx);
+	// Start loading the covers that scroll in next (the nearest last, as the newest requests load first)
+	double const velocity = m_songs.currentVelocity();
+	int const dir = velocity > 0.1 ? 1 : velocity < -0.1 ? -1 : 0;
+	for (int n = (dir == 0 ? 2 : 8); n > 0; --n) {
+		if (dir >= 0) prefetchCover(idx + 5 + n);
+		if (dir <= 0) prefetchCover(idx - 2 - n);
+	}
+	// Draw covers and reflections
 	for (int i = -2; i < 6; ++i) {
 		if (idx + i < 0 || idx + i >= ss) continue;
 		Song& song = *m_songs[static_cast<unsigned>(idx + i)];
-		Texture& s = getCover(song);
+		// Full resolution only for the selected cover, and not while flying past it
+		bool const selected = idx + i == currentId && std::abs(velocity) < 2.0;
+		Texture& s = getCover(song, selected ? CoverCache::Size::FULL : CoverCache::Size::THUMBNAIL);
 		// Calculate dimensions for cover and instrument markers
 		float pos = static_cast<float>(static_cast<double>(i) - shift);
 		// Function for highlight effect (offset = 0 for current cover), returns 0..1 highlight level
@@ -469,22 +486,19 @@ void ScreenSongs::drawCovers() {
 	}
 }
 
-Texture* ScreenSongs::loadTextureFromMap(fs::path path) {
-	if(m_covers.find(path) == m_covers.end()) {
-		m_covers.insert({ path, std::make_unique<Texture>(path) });
-	}
-	try {
-		return m_covers.at(path).get();
-	} catch (std::exception const&) {}
-	return nullptr;
+void ScreenSongs::prefetchCover(std::ptrdiff_t index) {
+	if (index < 0 || index >= static_cast<std::ptrdiff_t>(m_songs.size())) return;
+	Song const& song = *m_songs[static_cast<std::size_t>(index)];
+	if (!song.cover.empty()) m_covers->prefetch(song.cover, CoverCache::Size::THUMBNAIL);
+	else if (!song.background.empty()) m_covers->prefetch(song.background, CoverCache::Size::THUMBNAIL);
 }
 
-Texture& ScreenSongs::getCover(Song const& song) {
+Texture& ScreenSongs::getCover(Song const& song, CoverCache::Size size) {
 	Texture* cover = nullptr;
 	// Fetch cover image from cache or try loading it
-	if (!song.cover.empty()) cover = loadTextureFromMap(song.cover);
+	if (!song.cover.empty()) cover = &m_covers->get(song.cover, size);
 	// Fallback to background image as cover if needed
-	if (!cover && !song.background.empty()) cover = loadTextureFromMap(song.background);
+	if (!cover && !song.background.empty()) cover = &m_covers->get(song.background, size);
 	// Use empty cover
 	if (!cover) {
 		if(song.hasDance()) {
@@ -2,6 +2,7 @@
 
 #include "animvalue.hh"
 #include "controllers.hh"
+#include "covercache.hh"
 #include "screen.hh"
 #include "theme.hh"
 #include "song.hh" // for MusicFiles class
@@ -37,7 +38,7 @@ public:
 	void prepare();
 	void draw();
 	void drawCovers(); ///< draw the cover browser
-	Texture& getCover(Song const& song); ///< get appropriate cover image for the song (incl. no cover)
+	Texture& getCover(Song const& song, CoverCache::Size size = CoverCache::Size::THUMBNAIL); ///< get appropriate cover image for the song (incl. no cover)
 	void drawJukebox(); ///< draw the songbrowser in jukebox mode (fullscreen, full previews, ...)
 	static std::unique_ptr<fvec_t, void(*)(fvec_t*)> previewBeatsBuffer;
 private:
@@ -49,7 +50,7 @@ private:
 	bool addSong(); ///< Add current song to playlist. Returns true if the playlist was empty.
 	void sing(); ///< Enter singing screen with current playlist.
 	void createPlaylistMenu();
-	Texture* loadTextureFromMap(fs::path path);
+	void prefetchCover(std::ptrdiff_t index); ///< start loading the cover of the song at index (if there is one)
 	std::string getHighScoreText() const;
 
 	Audio& m_audio;
@@ -68,7 +69,7 @@ private:
 	std::unique_ptr<Texture> m_danceCover;
 	std::unique_ptr<Texture> m_instrumentList;
 	std::unique_ptr<ThemeInstrumentMenu> m_menuTheme;
-	std::unordered_map<fs::path, std::unique_ptr<Texture>, FsPathHash> m_covers;
+	std::unique_ptr<CoverCache> m_covers;
 	unsigned m_menuPos;
 	int m_infoPos;
 	bool m_jukebox;
@@ -1,6 +1,7 @@
 #include "song.hh"
 
 #include "config.hh"
+#include "configuration.hh"
 #include "ffmpeg.hh"
 #include "log.hh"
 #include "screen_sing.hh"
@@ -130,6 +131,7 @@ void Song::collateUpdate() {
 
 	collateByArtist = collateInfo["artist"] + "__" + collateInfo["title"] + "__" + filename.string();
 	collateByArtistOnly = collateInfo["artist"];
+	updateSortKeys(config["game/case-sorting"].b());
 }
 
 Song::Status Song::status(double time, ScreenSing* song) {
@@ -239,6 +241,19 @@ double Song::getPreviewStart() {
 	return preview_start;
 }
 
+void Song::updateSortKeys(bool caseSensitive) {
+	unsigned const generation = UnicodeUtil::collatorGeneration();
+	if (sortKeys.generation == generation && sortKeys.caseSensitive == caseSensitive) return;
+	sortKeys.byTitle = UnicodeUtil::sortKey(collateByTitle, caseSensitive);
+	sortKeys.byArtist = UnicodeUtil::sortKey(collateByArtist, caseSensitive);
+	sortKeys.edition = UnicodeUtil::sortKey(edition, caseSensitive);
+	sortKeys.genre = UnicodeUtil::sortKey(genre, caseSensitive);
+	sortKeys.language = UnicodeUtil::sortKey(language, caseSensitive);
+	sortKeys.creator = UnicodeUtil::sortKey(creator, caseSensitive);
+	sortKeys.caseSensitive = caseSensitive;
+	sortKeys.generation = generation;
+}
+
 std::string Song::str() const { return title + "  by  " + artist; }
 
 std::string Song::strFull() const {
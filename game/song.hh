@@ -81,6 +81,12 @@ public:
 	std::string collateByTitleOnly;  ///< String for sorting by title only
 	std::string collateByArtist;  ///< String for sorting by artist, title
 	std::string collateByArtistOnly;  ///< String for sorting by artist only
+	/// Collation sort keys of the fields used for sorting (compare bytewise), see updateSortKeys
+	struct SortKeys {
+		std::string byTitle, byArtist, edition, genre, language, creator;
+		bool caseSensitive = false;
+		unsigned generation = 0;  ///< UnicodeUtil::collatorGeneration() of the keys, 0 if not computed
+	} sortKeys;
 	double videoGap = 0.0; ///< gap with video
 	double start = 0.0; ///< start of song
 	double end = 0.0; ///< end of song
@@ -111,6 +117,8 @@ public:
 	void eraseVocalTrack(std::string vocalTrack = TrackName::VOCAL_LEAD);
 	std::string str() const;  ///< Return "title by artist" string for UI
 	std::string strFull() const;  ///< Return multi-line full song info (used for searching)
+	/// Recompute sortKeys unless they are current for the collator and case sensitivity
+	void updateSortKeys(bool caseSensitive);
 	/** Get the song status at a given timestamp **/
 	Status status(double time, ScreenSing* song);
 	// Get a selected track, or VOCAL_LEAD if not found or the first one if not found
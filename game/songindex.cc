@@ -0,0 +1,83 @@
+#include "songindex.hh"
+
+#include <unicode/errorcode.h>
+#include <unicode/normalizer2.h>
+#include <unicode/uchar.h>
+#include <unicode/unistr.h>
+
+#include <algorithm>
+#include <iterator>
+
+std::string SongIndex::normalize(std::string_view utf8) {
+	icu::ErrorCode error;
+	icu::Normalizer2 const* nfkd = icu::Normalizer2::getNFKDInstance(error);
+	icu::UnicodeString text = icu::UnicodeString::fromUTF8(icu::StringPiece(utf8.data(), static_cast<std::int32_t>(utf8.size())));
+	text.foldCase();
+	if (nfkd && error.isSuccess()) text = nfkd->normalize(text, error);
+	icu::UnicodeString stripped;
+	for (std::int32_t i = 0; i < text.length(); i = text.moveIndex32(i, 1)) {
+		UChar32 c = text.char32At(i);
+		if (u_charType(c) != U_NON_SPACING_MARK) stripped.append(c);
+	}
+	std::string result;
+	stripped.toUTF8String(result);
+	return result;
+}
+
+std::uint32_t SongIndex::trigram(char const* p) {
+	auto byte = [](char c) { return static_cast<std::uint32_t>(static_cast<unsigned char>(c)); };
+	return byte(p[0]) << 16 | byte(p[1]) << 8 | byte(p[2]);
+}
+
+SongIndex::Id SongIndex::add(std::string_view text) {
+	Id id = static_cast<Id>(m_texts.size());
+	std::string const& normalized = m_texts.emplace_back(normalize(text));
+	for (std::size_t i = 0; i + 3 <= normalized.size(); ++i) {
+		Ids& ids = m_postings[trigram(normalized.data() + i)];
+		if (ids.empty() || ids.back() != id) ids.push_back(id);  // Repeated trigrams within a text are listed once
+	}
+	return id;
+}
+
+void SongIndex::clear() {
+	m_texts.clear();
+	m_postings.clear();
+}
+
+bool SongIndex::contains(Id id, std::string const& normalizedQuery) const {
+	return m_texts[id].find(normalizedQuery) != std::string::npos;
+}
+
+SongIndex::Ids SongIndex::search(std::string_view query) const {
+	std::string const q = normalize(query);
+	Ids result;
+	if (q.size() < 3) {
+		for (Id id = 0; id < m_texts.size(); ++id) if (contains(id, q)) result.push_back(id);
+		return result;
+	}
+	// Collect the posting lists of the query, shortest first to keep the intersection small
+	std::vector<Ids const*> lists;
+	for (std::size_t i = 0; i + 3 <= q.size(); ++i) {
+		auto it = m_postings.find(trigram(q.data() + i));
+		if (it == m_postings.end()) return result;  // Some trigram does not occur anywhere
+		lists.push_back(&it->second);
+	}
+	std::sort(lists.begin(), lists.end(), [](Ids const* a, Ids const* b) { return a->size() < b->size(); });
+	result = *lists.front();
+	Ids tmp;
+	for (auto it = lists.begin() + 1; it != lists.end() && !result.empty(); ++it) {
+		tmp.clear();
+		std::set_intersection(result.begin(), result.end(), (*it)->begin(), (*it)->end(), std::back_inserter(tmp));
+		result.swap(tmp);
+	}
+	// The trigrams may occur in a different order or apart, so verify
+	result.erase(std::remove_if(result.begin(), result.end(), [&](Id id) { return !contains(id, q); }), result.end());
+	return result;
+}
+
+SongIndex::Ids SongIndex::refine(std::string_view query, Ids const& candidates) const {
+	std::string const q = normalize(query);
+	Ids result;
+	for (Id id: candidates) if (id < m_texts.size() && contains(id, q)) result.push_back(id);
+	return result;
+}
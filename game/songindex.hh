@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Inverted trigram index for substring search over song texts.
+ *
+ * Texts are normalized (case folded, accents removed) when added. A query is looked up by
+ * intersecting the posting lists of its trigrams, and the remaining candidates are verified
+ * with a plain substring search. Queries shorter than a trigram scan all texts.
+ * Not thread-safe: lock externally when adding and searching from different threads.
+ */
+class SongIndex {
+  public:
+	using Id = std::uint32_t;
+	using Ids = std::vector<Id>;
+
+	/// Fold case and remove accents (combining marks after compatibility decomposition), UTF-8 in and out
+	static std::string normalize(std::string_view utf8);
+
+	/// Add a text, returning its id (ids are consecutive, starting from 0)
+	Id add(std::string_view text);
+	void clear();
+	std::size_t size() const { return m_texts.size(); }
+	/// Ids of all texts containing query, in ascending order
+	Ids search(std::string_view query) const;
+	/// The candidates that contain query (for refining a previous result when the query grows)
+	Ids refine(std::string_view query, Ids const& candidates) const;
+
+  private:
+	static std::uint32_t trigram(char const* p);
+	bool contains(Id id, std::string const& normalizedQuery) const;
+
+	std::vector<std::string> m_texts;  ///< Normalized texts by id
+	std::unordered_map<std::uint32_t, Ids> m_postings;  ///< Ids of the texts containing each trigram (ascending)
+};
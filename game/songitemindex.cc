@@ -0,0 +1,57 @@
+#include "songitemindex.hh"
+
+#include <unicode/unistr.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+	void appendFolded(std::string& out, std::string_view utf8) {
+		icu::UnicodeString text = icu::UnicodeString::fromUTF8(icu::StringPiece(utf8.data(), static_cast<std::int32_t>(utf8.size())));
+		text.foldCase();
+		text.toUTF8String(out);
+	}
+}
+
+std::string SongItemIndex::key(std::string_view artist, std::string_view title) {
+	std::string result;
+	result.reserve(artist.size() + title.size() + 1);
+	appendFolded(result, artist);
+	result += '\0';  // Cannot appear in either part
+	appendFolded(result, title);
+	return result;
+}
+
+SongId SongItemIndex::add(SongItem item, std::optional<SongId> id) {
+	item.id = id && !m_items.count(*id) ? *id : m_nextId;
+	m_nextId = std::max(m_nextId, item.id + 1);
+	auto [it, inserted] = m_ids.try_emplace(key(item.artist, item.title), item.id);
+	if (!inserted) it->second = std::min(it->second, item.id);
+	SongId const result = item.id;
+	m_items.emplace(result, std::move(item));
+	return result;
+}
+
+SongItem* SongItemIndex::find(SongId id) {
+	auto it = m_items.find(id);
+	return it == m_items.end() ? nullptr : &it->second;
+}
+
+SongItem const* SongItemIndex::find(SongId id) const {
+	auto it = m_items.find(id);
+	return it == m_items.end() ? nullptr : &it->second;
+}
+
+std::optional<SongId> SongItemIndex::find(std::string_view artist, std::string_view title) const {
+	auto it = m_ids.find(key(artist, title));
+	if (it == m_ids.end()) return std::nullopt;
+	return it->second;
+}
+
+std::vector<SongId> SongItemIndex::ids() const {
+	std::vector<SongId> result;
+	result.reserve(m_items.size());
+	for (auto const& [id, item]: m_items) result.push_back(id);
+	std::sort(result.begin(), result.end());
+	return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Song;
+
+using SongId = unsigned;
+
+struct SongItem
+{
+	SongId id = 0; ///< The unique id for every song
+
+	/** This data is stored separate because it is read in before
+	  the song is added.
+	  A short, but relatively non-ambiguous collate form is used.
+	  */
+	std::string artist;
+	std::string title;
+
+	std::shared_ptr<Song> getSong() const;
+	void setSong(std::shared_ptr<Song>);
+
+	bool isBroken() const;
+	void setBroken(bool broken = true);
+
+	bool operator< (SongItem const& other) const
+	{
+		return id < other.id;
+	}
+
+private:
+	bool m_broken = false;
+	std::shared_ptr<Song> m_song;
+};
+
+/**
+ * Song items hashed by id and by identity (case-folded artist and title).
+ *
+ * All lookups are O(1) and new ids come from a counter that is kept above every id in use,
+ * so loading a large database and adding all songs is linear in the number of songs.
+ */
+class SongItemIndex {
+  public:
+	/// Identity of a song: artist and title (UTF-8) with case folded, so that lookups are case insensitive
+	static std::string key(std::string_view artist, std::string_view title);
+
+	/**Adds an item with the given id, or with a new one if the id is missing or already taken.
+	  @return the id of the item.*/
+	SongId add(SongItem item, std::optional<SongId> id = std::nullopt);
+	SongItem* find(SongId id);
+	SongItem const* find(SongId id) const;
+	/// The lowest id of the items with this artist and title (case insensitive)
+	std::optional<SongId> find(std::string_view artist, std::string_view title) const;
+	/// All ids in ascending order
+	std::vector<SongId> ids() const;
+	/// Call f for every item (in no particular order)
+	template <typename F> void forEach(F&& f) const { for (auto const& [id, item]: m_items) f(item); }
+	std::size_t size() const { return m_items.size(); }
+
+  private:
+	std::unordered_map<SongId, SongItem> m_items;
+	std::unordered_map<std::string, SongId> m_ids;  ///< By key
+	SongId m_nextId = 0;  ///< Above all ids in use
+};
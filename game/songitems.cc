@@ -3,7 +3,6 @@
 #include "unicode.hh"
 #include "libxml++.hh"
 
-#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -32,7 +31,8 @@ void SongItems::load(xmlpp::NodeSet const& n) {
 }
 
 void SongItems::save(xmlpp::Element* songs) {
-    for (auto const& song : m_songs) {
+    for (SongId id : m_index.ids()) {
+        SongItem const& song = *m_index.find(id);
         xmlpp::Element* element = xmlpp::add_child_element(songs, "song");
         element->set_attribute("id", std::to_string(song.id));
         element->set_attribute("artist", song.artist);
@@ -43,90 +43,73 @@ void SongItems::save(xmlpp::Element* songs) {
 
 SongId SongItems::addSongItem(std::string const& artist, std::string const& title, bool broken, std::optional<SongId> _id) {
     SongItem si;
-    si.id = _id.value_or(assign_id_internal());
     songMetadata collateInfo{ {"artist", artist}, {"title", title} };
     UnicodeUtil::collate(collateInfo);
     si.artist = collateInfo["artist"];
     si.title = collateInfo["title"];
     si.setBroken(broken);
-    std::pair<songs_t::iterator, bool> ret = m_songs.insert(si);
-    if (!ret.second)
-    {
-        si.id = assign_id_internal();
-        m_songs.insert(si); // now do the insert with the fresh id
-    }
-    return si.id;
+    return m_index.add(std::move(si), _id);  // A fresh id is assigned if _id is missing or taken
 }
 
-void SongItems::addSong(SongPtr song) {
+SongId SongItems::restoreSongItem(std::string const& artist, std::string const& title, bool broken, SongId id) {
     SongItem si;
+    si.artist = artist;
+    si.title = title;
+    si.setBroken(broken);
+    return m_index.add(std::move(si), id);
+}
+
+void SongItems::addSong(SongPtr song) {
     // Do NOT use .value_or() here; it gets evaluated and addSongItem() runs regardless of whether we have a value, which results in duplicate entries in the database.
     auto val = lookup(song);
-    si.id = val ? val.value() : (addSongItem(song->artist, song->title));;
-    auto it = m_songs.find(si);
-    if (it == m_songs.end())
+    SongId const id = val ? val.value() : (addSongItem(song->artist, song->title));
+    SongItem* item = m_index.find(id);
+    if (!item)
         throw SongItemsException("Cant find song which was added just before");
-    // it->song.reset(song); // does not work, it is a read only structure...
 
-    // fill up the rest of the information
-    si.artist = it->artist;
-    si.title = it->title;
-    si.setBroken(it->isBroken());
-    si.setSong(song);
-
-    m_songs.erase(it);
-    m_songs.insert(si);
+    if (auto const previous = item->getSong()) m_bySong.erase(previous.get());
+    item->setSong(song);
+    m_bySong[song.get()] = id;
 }
 
 std::optional<SongId> SongItems::lookup(Song const& song) const {
-    auto const si = std::find_if(m_songs.begin(), m_songs.end(), [&song](SongItem const& si) {
-
-        // This is not always really correct but in most cases these inputs should have been normalized into unicode at one point during their life time.
-        if (song.collateByArtistOnly.length() != si.artist.length() ||
-            song.collateByTitleOnly.length() != si.title.length()) return false;
-
-        return UnicodeUtil::caseEqual(song.collateByArtistOnly, si.artist, true) && UnicodeUtil::caseEqual(song.collateByTitleOnly, si.title, true);
-        });
-    if (si != m_songs.end()) return si->id;
-    return std::nullopt;
+    // This is not always really correct but in most cases these inputs should have been normalized into unicode at one point during their life time.
+    return m_index.find(song.collateByArtistOnly, song.collateByTitleOnly);
 }
 
 SongId SongItems::getSongId(SongPtr const& song) const {
-    auto const it = std::find_if(m_songs.begin(), m_songs.end(), [song](auto const& item) { return item.getSong() == song; });
+    auto const id = findSongId(song);
 
-    if (it == m_songs.end())
+    if (!id)
         throw std::logic_error("SongItems::getSongId: Did not find an item matching to song!");
 
-    return it->id;
+    return *id;
+}
+
+std::optional<SongId> SongItems::findSongId(SongPtr const& song) const {
+    auto const it = m_bySong.find(song.get());
+    if (it == m_bySong.end())
+        return std::nullopt;
+    return it->second;
 }
 
 SongPtr SongItems::getSong(SongId id) const
 {
-	auto const it = std::find_if(m_songs.begin(), m_songs.end(), [id](auto const& item) { return item.id == id; });
+	SongItem const* item = m_index.find(id);
 
-	if (it == m_songs.end())
+	if (!item)
 		return {};
 		
-	return it->getSong();
+	return item->getSong();
 }
 
 std::optional<std::string> SongItems::lookup(const SongId& id) const {
-    SongItem si;
-    si.id = id;
-    auto it = m_songs.find(si);
-    if (it == m_songs.end())
+    SongItem const* item = m_index.find(id);
+    if (!item)
         return std::nullopt;
-    if (!it->getSong())
-        return it->artist + " - " + it->title;
-    return it->getSong()->artist + " - " + it->getSong()->title;
-}
-
-SongId SongItems::assign_id_internal() const {
-    // use the last one with highest id
-    auto it = std::max_element(m_songs.begin(), m_songs.end());
-    if (it != m_songs.end())
-        return it->id + 1;
-    return 0; // empty set
+    if (!item->getSong())
+        return item->artist + " - " + item->title;
+    return item->getSong()->artist + " - " + item->getSong()->title;
 }
 
 
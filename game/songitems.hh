@@ -1,11 +1,12 @@
 #pragma once
 
 #include "song.hh"
+#include "songitemindex.hh"
 
 #include "libxml++.hh"
 
 #include <memory>
-#include <set>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -19,47 +20,14 @@ struct SongItemsException: public std::runtime_error {
 	{}
 };
 
-using SongId = unsigned;
-
-struct SongItem
-{
-	SongId id = 0; ///< The unique id for every song
-
-	/** This data is stored separate because it is read in before
-	  the song is added.
-	  A short, but relatively non-ambiguous collate form is used.
-	  */
-	std::string artist;
-	std::string title;
-
-	std::shared_ptr<Song> getSong() const;
-	void setSong(std::shared_ptr<Song>);
-
-	bool isBroken() const;
-	void setBroken(bool broken = true);
-
-	bool operator< (SongItem const& other) const
-	{
-		return id < other.id;
-	}
-
-private:
-	bool m_broken = false;
-	std::shared_ptr<Song> m_song;
-};
-
 /**A list of songs for the database.
 
   Every song has a unique id managed by that database.
   This class was introduced to hide the implementation
   detail which data structure is used for the list away.
 
-  Currently a std::set is used, which makes both addSongItem()
-  and addSong() slow. The only advantage is that the id is
-  unique and it is cheap to get a new unique id.
-
-  When one of the methods is to slow, it can be optimized
-  easily. */
+  The items are hashed by id, by artist and title and by song,
+  so all lookups take constant time. */
 class SongItems {
 public:
 	void load(xmlpp::NodeSet const& n);
@@ -71,6 +39,8 @@ public:
 	  need that you want addSong().
 	 */
 	SongId addSongItem(std::string const& artist, std::string const& title, bool broken = false, std::optional<SongId> id = std::nullopt);
+	/**Like addSongItem, but artist and title are already in the collated form (as returned in SongItem).*/
+	SongId restoreSongItem(std::string const& artist, std::string const& title, bool broken, SongId id);
 	/**Adds or Links an already existing song with an songitem.
 
 	  The id will be assigned and artist and title will be filled in.
@@ -90,18 +60,22 @@ public:
 	std::optional<SongId> lookup(Song const& song) const;
 
 	SongId getSongId(SongPtr const&) const;
+	/// Like getSongId but without throwing if the song was not added
+	std::optional<SongId> findSongId(SongPtr const&) const;
 	SongPtr getSong(SongId) const;
+	/// @return nullptr if there is no item with that id
+	SongItem const* getItem(SongId id) const { return m_index.find(id); }
 
 	/**Lookup the artist + title for a specific song.
 	  @return "Unknown Song" if nothing is found.
 	  */
 	std::optional<std::string> lookup (const SongId& id) const;
 
-	std::size_t size() const { return m_songs.size(); }
+	std::size_t size() const { return m_index.size(); }
+	/// Call f for every SongItem (in no particular order)
+	template <typename F> void forEach(F&& f) const { m_index.forEach(f); }
 
 private:
-	SongId assign_id_internal() const;
-
-	using songs_t = std::set<SongItem>;
-	songs_t m_songs;
+	SongItemIndex m_index;
+	std::unordered_map<Song const*, SongId> m_bySong;  ///< Ids of the songs linked with addSong()
 };
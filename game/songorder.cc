@@ -0,0 +1,8 @@
+#include "songorder.hh"
+
+#include "configuration.hh"
+
+void SongOrder::updateSortKeys(SongCollection const& songs) {
+	bool const caseSensitive = config["game/case-sorting"].b();
+	for (auto const& song: songs) song->updateSortKeys(caseSensitive);
+}
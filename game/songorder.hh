@@ -14,6 +14,10 @@ struct SongOrder {
 	virtual void prepare(SongCollection const&, Database const&) {}
 
 	virtual bool operator()(Song const& a, Song const& b) const = 0;
+
+  protected:
+	/// Make sure Song::sortKeys are current for the collator and the case-sorting setting
+	static void updateSortKeys(SongCollection const&);
 };
 
 using SongOrderPtr = std::shared_ptr<SongOrder>;
@@ -7,17 +7,11 @@ std::string MostSungSongOrder::getDescription() const {
 }
 
 void MostSungSongOrder::prepare(SongCollection const& songs, Database const& database) {
-	auto begin = songs.begin();
-	auto end = songs.end();
-
-	std::for_each(begin, end, [&](SongPtr const& song) {
-		try {
-			m_rateMap[song.get()] = database.getHiscores(song).size();
-		}
-		catch(std::exception const&) {
-			m_rateMap[song.get()] = 0;
-		}
-	});
+	// One bulk query instead of searching the hiscores song by song
+	auto const stats = database.getHiscoreStats(songs);
+	m_rateMap.clear();
+	m_rateMap.reserve(songs.size());
+	for (std::size_t i = 0; i < songs.size(); ++i) m_rateMap[songs[i].get()] = stats[i].count;
 }
 
 bool MostSungSongOrder::operator()(const Song& a, const Song& b) const {
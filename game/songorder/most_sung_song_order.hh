@@ -2,6 +2,8 @@
 
 #include "songorder.hh"
 
+#include <unordered_map>
+
 struct MostSungSongOrder : public SongOrder {
 	std::string getDescription() const override;
 
@@ -10,6 +12,6 @@ struct MostSungSongOrder : public SongOrder {
 	bool operator()(Song const& a, Song const& b) const override;
 
   private:
-	std::map<Song const*, size_t> m_rateMap;
+	std::unordered_map<Song const*, size_t> m_rateMap;
 };
 
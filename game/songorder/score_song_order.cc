@@ -7,17 +7,11 @@ std::string ScoreSongOrder::getDescription() const {
 }
 
 void ScoreSongOrder::prepare(SongCollection const& songs, Database const& database) {
-	auto begin = songs.begin();
-	auto end = songs.end();
-
-	std::for_each(begin, end, [&](SongPtr const& song) {
-		try {
-			m_scoreMap[song.get()] = database.getHiscore(song);
-		}
-		catch(std::exception const&) {
-			m_scoreMap[song.get()] = 0;
-		}
-	});
+	// One bulk query instead of searching the hiscores song by song
+	auto const stats = database.getHiscoreStats(songs);
+	m_scoreMap.clear();
+	m_scoreMap.reserve(songs.size());
+	for (std::size_t i = 0; i < songs.size(); ++i) m_scoreMap[songs[i].get()] = stats[i].best;
 }
 
 bool ScoreSongOrder::operator()(Song const& a, Song const& b) const {
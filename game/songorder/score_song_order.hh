@@ -2,6 +2,8 @@
 
 #include "songorder.hh"
 
+#include <unordered_map>
+
 struct ScoreSongOrder : public SongOrder {
 	std::string getDescription() const override;
 
@@ -10,6 +12,6 @@ struct ScoreSongOrder : public SongOrder {
 	bool operator()(Song const& a, Song const& b) const override ;
 
   private:
-	std::map<Song const*, unsigned> m_scoreMap;
+	std::unordered_map<Song const*, unsigned> m_scoreMap;
 };
 
@@ -23,11 +23,12 @@
 #include "songorder/score_song_order.hh"
 
 #include <fmt/format.h>
-#include <unicode/stsearch.h>
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdlib>
+#include <deque>
 #include <iostream>
 #include <fstream>
 #include <regex>
@@ -47,11 +48,70 @@ namespace {
 		songs.addSongOrder(std::make_shared<FileTimeSongOrder>());
 		songs.addSongOrder(std::make_shared<CreatorSongOrder>());
 	}
+
+	const std::regex songFileExpression(R"((\.txt|^song\.ini|^notes\.xml|\.sm)$)", std::regex_constants::icase);
+	const std::regex ignoredFileExpression("^(\\._.*|\\.\\#.*)$");  // skip MacOS meta, common backup files
+
+	std::optional<Songs::FileStamp> getFileStamp(fs::directory_entry const& entry) {
+		std::error_code ec;
+		auto const time = entry.last_write_time(ec);
+		if (ec) return {};
+		auto const size = entry.file_size(ec);
+		if (ec) return {};
+		return Songs::FileStamp{ static_cast<std::int64_t>(time.time_since_epoch().count()), size };
+	}
+
+	std::optional<std::int64_t> getDirStamp(fs::path const& dir) {
+		std::error_code ec;
+		auto const time = fs::last_write_time(dir, ec);
+		if (ec) return {};
+		return static_cast<std::int64_t>(time.time_since_epoch().count());
+	}
+
+	/// Song files waiting to be parsed, handed from the directory scan to the parser threads
+	class ParseQueue {
+	  public:
+		struct Item {
+			fs::path file;
+			std::optional<Songs::FileStamp> stamp;
+		};
+		explicit ParseQueue(std::size_t capacity): m_capacity(capacity) {}
+		/// Add a file, waiting while the queue is full
+		void push(Item item) {
+			std::unique_lock<std::mutex> l(m_mutex);
+			m_notFull.wait(l, [this] { return m_items.size() < m_capacity; });
+			m_items.push_back(std::move(item));
+			m_notEmpty.notify_one();
+		}
+		/// Take the next file, waiting while the queue is empty. Returns false once closed and drained.
+		bool pop(Item& item) {
+			std::unique_lock<std::mutex> l(m_mutex);
+			m_notEmpty.wait(l, [this] { return !m_items.empty() || m_closed; });
+			if (m_items.empty()) return false;
+			item = std::move(m_items.front());
+			m_items.pop_front();
+			m_notFull.notify_one();
+			return true;
+		}
+		/// No more files will be pushed
+		void close() {
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_closed = true;
+			m_notEmpty.notify_all();
+		}
+	  private:
+		std::mutex m_mutex;
+		std::condition_variable m_notEmpty, m_notFull;
+		std::deque<Item> m_items;
+		std::size_t m_capacity;
+		bool m_closed = false;
+	};
 }
 
 Songs::Songs(Database & database, std::string const& songlist)
  : m_songlist(songlist),  m_database(database) {
 	m_updateTimer.setTarget(getInf()); // Using this as a simple timer counting seconds
+	m_filterThread = std::thread([this] { filterThread(); });
 
 	initializeSongOrders(*this);
 
@@ -63,6 +123,12 @@ Songs::Songs(Database & database, std::string const& songlist)
 Songs::~Songs() {
 	m_loading = false; // Terminate song loading if currently in progress
 	m_thread->join();
+	{
+		std::lock_guard<std::mutex> l(m_filterMutex);
+		m_filterQuit = true;
+	}
+	m_filterCond.notify_one();
+	m_filterThread.join();
 }
 
 void Songs::reload() {
@@ -77,12 +143,18 @@ void Songs::reload() {
 	m_thread = std::make_unique<std::thread>([this]{ reload_internal(); });
 }
 
-const std::string SONGS_CACHE_JSON_FILE = "songs.json";
+const std::string SONGS_CACHE_JSON_FILE = "songs.json";  // Older cache format, only read if there is no index yet
+const std::string SONGS_CACHE_INDEX_FILE = "songs.idx";
+const unsigned SONGS_CACHE_INDEX_VERSION = 1;
 
 void Songs::reload_internal() {
 	{
 		std::unique_lock<std::shared_mutex> l(m_mutex);
 		m_songs.clear();
+		m_fileStamps.clear();
+		m_dirStamps.clear();
+		m_index.clear();
+		++m_indexVersion;
 		m_dirty = true;
 	}
 	SpdLogger::notice(LogSystem::CACHE, "Reading song cache file...");
@@ -127,20 +199,42 @@ void Songs::reload_internal() {
 }
 
 Songs::Cache Songs::loadCache() {
+	Cache cache;
+	const fs::path indexFile = PathCache::getCacheDir() / SONGS_CACHE_INDEX_FILE;
+	if (fs::exists(indexFile)) {
+		try {
+			fs::ifstream file(indexFile, std::ios::binary);
+			auto const index = nlohmann::json::from_cbor(file);
+			if (index.at("version").get<unsigned>() != SONGS_CACHE_INDEX_VERSION) throw std::runtime_error("unsupported version");
+			// Each record is [filename, mtime, size, song]
+			for (auto const& record: index.at("songs")) {
+				CacheEntry entry{ std::make_shared<Song>(record.at(3)), FileStamp{ record.at(1).get<std::int64_t>(), record.at(2).get<std::uintmax_t>() } };
+				cache.songs.emplace(record.at(0).get<std::string>(), std::move(entry));
+			}
+			auto const dirs = index.find("dirs");
+			if (dirs != index.end()) cache.dirs = dirs->get<std::unordered_map<std::string, std::int64_t>>();
+			return cache;
+		} catch (std::exception const& e) {
+			SpdLogger::warn(LogSystem::CACHE, "Ignoring song index file={}, exception={}", indexFile, e.what());
+			cache = Cache();
+		}
+	}
 	const fs::path songsMetaFile = PathCache::getCacheDir() / SONGS_CACHE_JSON_FILE;
 	auto jsonRoot = readJSON(songsMetaFile);
-	Cache cache;
 	for (auto const& songData : jsonRoot) {
 		auto song = std::make_shared<Song> (songData);
-		cache[song->filename.string()] = std::move(song);
+		auto filename = song->filename.string();
+		cache.songs[filename] = CacheEntry{ std::move(song), std::nullopt };
 	}
 	return cache;
 }
 
 void Songs::CacheSonglist() {
-	auto jsonRoot = nlohmann::json::array();
+	auto records = nlohmann::json::array();
 	std::shared_lock<std::shared_mutex> l(m_mutex);
 	for (auto const& song : m_songs) {
+		auto stamp = m_fileStamps.find(song->filename.string());
+		if (stamp == m_fileStamps.end()) continue;  // Not stamped, parse it again next time
 		auto songObject = nlohmann::json::object();
 		if(!song->path.string().empty()) {
 			songObject["txtFileFolder"] = song->path.string();
@@ -271,62 +365,117 @@ void Songs::CacheSonglist() {
 		songObject["collateByArtist"] = song->collateByArtist;
 		songObject["collateByArtistOnly"] = song->collateByArtistOnly;
 
-		if(songObject != nlohmann::json::object()) {
-			jsonRoot.emplace_back(std::move(songObject));
-		}
+		records.push_back(nlohmann::json::array({ song->filename.string(), stamp->second.mtime, stamp->second.size, std::move(songObject) }));
 	}
+	nlohmann::json dirs = m_dirStamps;
+	l.unlock();
 
-	fs::path cacheDir = PathCache::getCacheDir() / SONGS_CACHE_JSON_FILE;
-	writeJSON(jsonRoot, cacheDir);
+	nlohmann::json index = { { "version", SONGS_CACHE_INDEX_VERSION }, { "songs", std::move(records) }, { "dirs", std::move(dirs) } };
+	const fs::path indexFile = PathCache::getCacheDir() / SONGS_CACHE_INDEX_FILE;
+	const fs::path tmpFile = fs::path(indexFile).concat(".tmp");
+	try {
+		{
+			fs::ofstream file(tmpFile, std::ios::binary | std::ios::trunc);
+			if (!file) throw std::runtime_error("cannot open for writing");
+			nlohmann::json::to_cbor(index, file);
+			if (!file.flush()) throw std::runtime_error("write failed");
+		}
+		fs::rename(tmpFile, indexFile);  // Replace the old index only once the new one is complete
+		SpdLogger::info(LogSystem::CACHE, "Saved {} songs to index file={}", index["songs"].size(), indexFile);
+	} catch (std::exception const& e) {
+		SpdLogger::error(LogSystem::CACHE, "Cannot save song index file={}, exception={}", indexFile, e.what());
 	}
+}
+
+void Songs::addSong_internal(std::shared_ptr<Song> const& song, std::optional<FileStamp> stamp) {
+	std::unique_lock<std::shared_mutex> l(m_mutex);
+	m_songs.emplace_back(song); //put it in the database, if found twice will appear in double
+	m_index.add(song->strFull());
+	++m_indexVersion;
+	m_database.addSong(song);
+	if (stamp) m_fileStamps[song->filename.string()] = *stamp;
+	m_dirty = true;
+}
 
-void Songs::reload_internal(fs::path const& parent, Cache cache) {
+void Songs::reload_internal(fs::path const& parent, Cache const& cache) {
+	// Songs that are not in the cache (or have changed) are parsed in parallel while the scan continues
+	ParseQueue queue(256);
+	std::vector<std::thread> parsers;  // Only started once there is something to parse
+	auto parse = [this, &queue] {
+		ParseQueue::Item item;
+		while (queue.pop(item)) {
+			if (!m_loading) continue;  // Drain quickly when loading was cancelled
+			try {
+				addSong_internal(std::make_shared<Song>(item.file), item.stamp);
+			} catch (SongParserException const& e) {
+				SpdLogger::warn(LogSystem::SONGS, "{}", e);
+			} catch (std::exception const& e) {
+				SpdLogger::error(LogSystem::SONGS, "Error loading song={}. Exception={}", item.file, e.what());
+			}
+		}
+	};
+	auto const push = [&](ParseQueue::Item item) {
+		if (parsers.empty()) {
+			auto const threads = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned i = 0; i < threads; ++i) parsers.emplace_back(parse);
+		}
+		queue.push(std::move(item));
+	};
+	// Cached songs are only stat'd if their directory has been modified since the last scan, so that an unchanged
+	// library costs one stat per directory. (Files edited in place without touching the directory are not noticed.)
+	std::unordered_map<std::string, std::int64_t> dirStamps;
+	if (auto stamp = getDirStamp(parent)) dirStamps[parent.string()] = *stamp;
+	auto const dirUnchanged = [&](fs::path const& dir) {
+		auto scanned = dirStamps.find(dir.string());
+		auto cached = cache.dirs.find(dir.string());
+		return scanned != dirStamps.end() && cached != cache.dirs.end() && scanned->second == cached->second;
+	};
 	try {
-		std::regex expression(R"((\.txt|^song\.ini|^notes\.xml|\.sm)$)", std::regex_constants::icase);
 		if (fs::is_empty(parent)) {
 			SpdLogger::notice(LogSystem::SONGS, "Empty directory={}, skipping from song search.", parent);
-			return;
-		}
-		auto iterator = fs::recursive_directory_iterator(parent, fs::directory_options::follow_directory_symlink);
-		auto maxDepth = iterator.depth() + 10;
-		for (const auto &dir : iterator) { //loop through files
-			if (!m_loading) return; // early return in case scanning is long and user wants to exit quickly
-			if (dir.is_directory()) {
-				continue;
-			}
-			if (iterator.depth() > maxDepth) {
-				SpdLogger::info(LogSystem::SONGS, ">>> Not scanning for songs on {}, maximum depth reached (possibly due to cyclic symlinks.)", parent);
-				continue;
-			}
-			fs::path p = dir.path();
-			if (!regex_search(p.filename().string(), expression)) {
-				continue; //if the folder does not contain any of the requested files, ignore it
-			}
-			std::regex ignoredFiles("^(\\._.*|\\.\\#.*)$");  // skip MacOS meta, common backup files
-			if ( regex_search(p.filename().string(), ignoredFiles)) {
-				SpdLogger::debug(LogSystem::SONGS, "Ignoring metadata/backup file {}", p.filename().string());
-				continue; // skip trying to load these files (which causes an exception log)
-			}
-			try { //found song file, make a new song with it.
-				auto song = std::shared_ptr<Song>{};
-				auto match = cache.find(p.string());
-				if ( match != cache.end()) {
-					song = match->second;
-				} else {
-					SpdLogger::info(LogSystem::SONGS, "Found song={}, which was not present in the cache.", p);
-					song = std::make_shared<Song> (p);
+		} else {
+			auto iterator = fs::recursive_directory_iterator(parent, fs::directory_options::follow_directory_symlink);
+			auto maxDepth = iterator.depth() + 10;
+			for (const auto &dir : iterator) { //loop through files
+				if (!m_loading) break; // stop early in case scanning is long and user wants to exit quickly
+				if (dir.is_directory()) {
+					if (auto stamp = getDirStamp(dir.path())) dirStamps[dir.path().string()] = *stamp;
+					continue;
 				}
-				std::unique_lock<std::shared_mutex> l(m_mutex);
-				m_songs.emplace_back(song); //put it in the database, if found twice will appear in double
-				m_database.addSong(song);
-				m_dirty = true;
-			} catch (SongParserException const& e) {
-				SpdLogger::warn(LogSystem::SONGS, "{}", e);
+				if (iterator.depth() > maxDepth) {
+					SpdLogger::info(LogSystem::SONGS, ">>> Not scanning for songs on {}, maximum depth reached (possibly due to cyclic symlinks.)", parent);
+					continue;
+				}
+				fs::path const& p = dir.path();
+				std::string const name = p.filename().string();
+				if (!regex_search(name, songFileExpression)) {
+					continue; //if the folder does not contain any of the requested files, ignore it
+				}
+				if (regex_search(name, ignoredFileExpression)) {
+					SpdLogger::debug(LogSystem::SONGS, "Ignoring metadata/backup file {}", name);
+					continue; // skip trying to load these files (which causes an exception log)
+				}
+				auto match = cache.songs.find(p.string());
+				bool const known = match != cache.songs.end() && match->second.stamp && dirUnchanged(p.parent_path());
+				auto stamp = known ? match->second.stamp : getFileStamp(dir);
+				if (match != cache.songs.end() && (!match->second.stamp || match->second.stamp == stamp)) {
+					addSong_internal(match->second.song, stamp);
+					continue;
+				}
+				if (match == cache.songs.end()) SpdLogger::info(LogSystem::SONGS, "Found song={}, which was not present in the cache.", p);
+				else SpdLogger::info(LogSystem::SONGS, "Song={} has changed since it was cached.", p);
+				push({ p, stamp });
 			}
 		}
 	} catch (std::exception const& e) {
 		SpdLogger::error(LogSystem::SONGS, "Error accessing {}. Exception={}", parent, e.what());
 	}
+	{
+		std::unique_lock<std::shared_mutex> l(m_mutex);
+		m_dirStamps.insert(dirStamps.begin(), dirStamps.end());
+	}
+	queue.close();
+	for (auto& t: parsers) t.join();
 }
 
 /// Store currently selected song on construction and restore the selection on destruction
@@ -350,7 +499,24 @@ class Songs::RestoreSel {
 };
 
 void Songs::update() {
-	if (m_dirty && m_updateTimer.get() > 0.5) filter_internal(); // Update with newly loaded songs
+	// Apply the result of background filtering, unless a newer change has been made since
+	std::optional<std::pair<std::uint64_t, SongCollection>> result;
+	bool current = false;
+	{
+		std::lock_guard<std::mutex> l(m_filterMutex);
+		result.swap(m_filterResult);
+		current = result && result->first == m_filterId;
+		if (current) m_filterApplied = m_filterId;
+	}
+	if (current) {
+		RestoreSel restore(*this);
+		m_filtered.swap(result->second);
+	}
+	if (m_dirty && m_updateTimer.get() > 0.5) { // Update with newly loaded songs
+		m_updateTimer.setValue(0.0);
+		m_dirty = false;
+		requestFilter();
+	}
 	// A hack to move to the first song when the song screen is entered the first time
 	static bool first = true;
 	if (first) { first = false; math_cover.reset(); math_cover.setTarget(0, static_cast<std::ptrdiff_t>(size())); }
@@ -362,97 +528,99 @@ void Songs::setFilter(std::string const& val) {
 	filter_internal();
 }
 
+void Songs::setFilterAsync(std::string const& val) {
+	if (m_filter == val) return;
+	m_filter = val;
+	requestFilter();
+}
+
+void Songs::requestFilter() {
+	std::lock_guard<std::mutex> l(m_filterMutex);
+	m_filterRequest = FilterRequest{ m_filter, m_type, m_order, m_descending, ++m_filterId };
+	m_filterCond.notify_one();
+}
+
+void Songs::filterThread() {
+	std::unique_lock<std::mutex> l(m_filterMutex);
+	while (true) {
+		m_filterCond.wait(l, [this] { return m_filterQuit || m_filterRequest; });
+		if (m_filterQuit) return;
+		FilterRequest request = std::move(*m_filterRequest);
+		m_filterRequest.reset();
+		l.unlock();
+		SongCollection filtered;
+		try {
+			filtered = filterAndSort(request.filter, request.type, request.order, request.descending);
+		} catch (std::exception const& e) {
+			SpdLogger::error(LogSystem::SONGS, "Filtering songs failed. Exception={}", e.what());
+		}
+		l.lock();
+		m_filterResult.emplace(request.id, std::move(filtered));
+	}
+}
+
 void Songs::filter_internal() {
 	m_updateTimer.setValue(0.0);
 	m_dirty = false;
-	RestoreSel restore(*this);
-	try {
-		auto filtered = SongCollection();
-		// if filter text is blank and no type filter is set, just display all songs.
-		if (m_filter == std::string() && m_type == 0) {
-			std::shared_lock<std::shared_mutex> l(m_mutex);
-			filtered = m_songs;
-		} else {
-			auto filter = icu::UnicodeString::fromUTF8(
-				UnicodeUtil::convertToUTF8(m_filter)
-			);
-			icu::ErrorCode icuError;
-
-			std::shared_lock<std::shared_mutex> l(m_mutex);
-			std::copy_if (m_songs.begin(), m_songs.end(), std::back_inserter(filtered), [&](std::shared_ptr<Song> it){
-			// Filter by type first.
-				if (m_type == 1 && !(*it).hasDance()) return false;
-				if (m_type == 2 && !(*it).hasVocals()) return false;
-				if (m_type == 3 && !(*it).hasDuet()) return false;
-				if (m_type == 4 && !(*it).hasGuitars()) return false;
-				if (m_type == 5 && !(*it).hasDrums() && !(*it).hasKeyboard()) return false;
-				if (m_type == 6 && (!(*it).hasVocals() || !(*it).hasGuitars() || (!(*it).hasDrums() && !(*it).hasKeyboard()))) return false;
-
-		  // If search is not empty, filter by search term.
-				if (!m_filter.empty()) {
-					icu::StringSearch search = icu::StringSearch(filter, icu::UnicodeString::fromUTF8((*it).strFull()), UnicodeUtil::m_searchCollator.get(), nullptr, icuError);
-					return (search.first(icuError) != USEARCH_DONE);
-					}
-
-		// If we still haven't returned, it must be a type match with an empty search string.
-				return true;
-			});
-		}
-		m_filtered.swap(filtered);
-	} catch (...) {
-		std::shared_lock<std::shared_mutex> l(m_mutex);
-		SongCollection(m_songs.begin(), m_songs.end()).swap(m_filtered);  // Invalid regex => copy everything
+	{
+		// Supersede anything still being filtered in the background
+		std::lock_guard<std::mutex> l(m_filterMutex);
+		m_filterApplied = ++m_filterId;
+		m_filterRequest.reset();
 	}
-	sort_internal();
+	RestoreSel restore(*this);
+	m_filtered = filterAndSort(m_filter, m_type, m_order, m_descending);
 }
 
 namespace {
-
-	/// A functor that compares songs based on a selected member field of them.
-	template<typename Field> class CmpByField {
-		Field Song::* m_field;
-		bool m_ascending;
-	  public:
-		/** @param field a pointer to the field to use (pointer to member) **/
-		CmpByField(Field Song::* field, bool ascending): m_field(field), m_ascending(ascending) {}
-		/// Compare left < right
-		bool operator()(Song const& left , Song const& right) {
-			return left.*m_field < right.*m_field;
+	bool matchesType(Song const& song, unsigned short type) {
+		switch (type) {
+			case 1: return song.hasDance();
+			case 2: return song.hasVocals();
+			case 3: return song.hasDuet();
+			case 4: return song.hasGuitars();
+			case 5: return song.hasDrums() || song.hasKeyboard();
+			case 6: return song.hasVocals() && song.hasGuitars() && (song.hasDrums() || song.hasKeyboard());
+			default: return true;
 		}
-		/// Compare *left < *right
-		bool operator()(std::shared_ptr<Song> const& left, std::shared_ptr<Song> const& right) {
-			return operator()(*left, *right);
-		}
-	};
+	}
+}
 
-	template<> class CmpByField<std::string> {
-		std::string Song::* m_field;
-		bool m_ascending;
-	  public:
-		/** @param field a pointer to the field to use (pointer to member) **/
-		CmpByField(std::string Song::* field, bool ascending): m_field(field), m_ascending(ascending) {}
-		/// Compare left < right
-		bool operator()(Song const& left , Song const& right) {
-			icu::UnicodeString leftVal = icu::UnicodeString::fromUTF8(left.*m_field);
-			icu::UnicodeString rightVal = icu::UnicodeString::fromUTF8(right.*m_field);
-			icu::ErrorCode sortError;
-			UCollationResult result = UnicodeUtil::m_sortCollator->compare(leftVal, rightVal, sortError);
-			if (sortError.isSuccess()) {
-				return result == UCOL_LESS ? m_ascending : !m_ascending;
-			}
-			else {
-				throw std::runtime_error("unicode/error: Sorting comparison error in CmpByField<std::string> ");
-			}
-		}
-		/// Compare *left < *right
-		bool operator()(std::shared_ptr<Song> const& left, std::shared_ptr<Song> const& right) {
-			return operator()(*left, *right);
+SongCollection Songs::filterAndSort(std::string const& filter, unsigned short type, unsigned short order, bool descending) {
+	if (order >= m_songOrders.size()) {
+		throw std::logic_error("Internal error: unknown sort order in Songs::filterAndSort");
+	}
+	std::lock_guard<std::mutex> sortLock(m_sortMutex);
+	SongCollection filtered;
+	{
+		std::shared_lock<std::shared_mutex> l(m_mutex);
+		if (filter.empty()) {
+			filtered = m_songs;
+		} else {
+			// Typing more text only narrows down the previous result
+			bool const refine = !m_lastSearch.filter.empty() && m_lastSearch.indexVersion == m_indexVersion
+			  && filter.find(m_lastSearch.filter) != std::string::npos;
+			auto ids = refine ? m_index.refine(filter, m_lastSearch.ids) : m_index.search(filter);
+			filtered.reserve(ids.size());
+			for (auto id: ids) filtered.push_back(m_songs[id]);
+			m_lastSearch = LastSearch{ filter, m_indexVersion, std::move(ids) };
 		}
-	};
-
-	/// A helper for easily constructing CmpByField objects
-	template <typename T> CmpByField<T> customComparator(T Song::*field, bool ascending) { return CmpByField<T>(field, ascending); }
+	}
+	if (type != 0) {
+		filtered.erase(std::remove_if(filtered.begin(), filtered.end(), [type](SongPtr const& song) { return !matchesType(*song, type); }), filtered.end());
+	}
+	auto& songOrder = *m_songOrders[order];
+	// May run on the filter thread while songs are added to the database, which locks itself
+	songOrder.prepare(filtered, m_database);
+	std::stable_sort(filtered.begin(), filtered.end(),
+		[&](SongPtr const& a, SongPtr const& b) { return songOrder(*a, *b); });
+	if (descending) {
+		std::reverse(filtered.begin(), filtered.end());
+	}
+	return filtered;
+}
 
+namespace {
 	static const unsigned short types = 7;
 }
 
@@ -533,7 +701,16 @@ void Songs::sort_internal(bool descending) {
 	if(m_order >= m_songOrders.size()) {
 		throw std::logic_error("Internal error: unknown sort order in Songs::sortChange");
 	}
+	m_descending = descending;
+	bool outstanding = false;
+	{
+		std::lock_guard<std::mutex> l(m_filterMutex);
+		outstanding = m_filterApplied != m_filterId;
+	}
+	// A filter still running in the background uses the old order, so start it over
+	if (outstanding) requestFilter();
 
+	std::lock_guard<std::mutex> sortLock(m_sortMutex);
 	auto& order = *m_songOrders[m_order];
 
 	order.prepare(m_filtered, m_database);
@@ -596,12 +773,21 @@ namespace {
 void Songs::dumpSongs_internal() const {
 	if (m_songlist.empty()) return;
 	SongCollection svec = [&] { std::shared_lock<std::shared_mutex> l(m_mutex); return m_songs; }();
-	std::sort(svec.begin(), svec.end(), customComparator(&Song::collateByArtist, true));
+	{
+		std::lock_guard<std::mutex> sortLock(m_sortMutex);
+		std::sort(svec.begin(), svec.end(), [](SongPtr const& a, SongPtr const& b) { return a->sortKeys.byArtist < b->sortKeys.byArtist; });
+	}
 	fs::path coverpath = fs::path(m_songlist) / "covers";
 	fs::create_directories(coverpath);
 	dumpXML(svec, m_songlist + "/songlist.xml");
 }
 
+SongCollection Songs::snapshot(std::uint64_t& version) const {
+	std::shared_lock<std::shared_mutex> l(m_mutex);
+	version = m_indexVersion;
+	return m_songs;
+}
+
 void Songs::addSongOrder(SongOrderPtr order) {
 	m_songOrders.emplace_back(order);
 }
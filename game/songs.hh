@@ -3,17 +3,21 @@
 #include "animvalue.hh"
 #include "fs.hh"
 #include "screen.hh"
+#include "songindex.hh"
 #include "songorder.hh"
 #include "utils/cycle.hh"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 #include <shared_mutex>
 
@@ -24,7 +28,20 @@ class Database;
 /// songs class for songs screen
 class Songs {
   public:
-	using Cache = std::unordered_map<std::string, std::shared_ptr<Song>>;
+	/// Identity of a song file on disk; the song is parsed again when it changes
+	struct FileStamp {
+		std::int64_t mtime = 0;  ///< Last write time (ticks of fs::file_time_type since its epoch)
+		std::uintmax_t size = 0;
+		bool operator==(FileStamp const& other) const { return mtime == other.mtime && size == other.size; }
+	};
+	struct CacheEntry {
+		std::shared_ptr<Song> song;
+		std::optional<FileStamp> stamp;  ///< Unknown for entries imported from the old songs.json (always trusted)
+	};
+	struct Cache {
+		std::unordered_map<std::string, CacheEntry> songs;  ///< By filename
+		std::unordered_map<std::string, std::int64_t> dirs;  ///< Last write times of the song directories when they were scanned
+	};
 	Songs(const Songs&) = delete;
 	const Songs& operator=(const Songs&) = delete;
 	/// constructor
@@ -58,8 +75,10 @@ class Songs {
 	Song& current();
 	/// @return current Song
 	Song const& current() const;
-	/// filters songlist by regular expression
+	/// filters songlist by search text (case and accent insensitive)
 	void setFilter(std::string const& regex);
+	/// like setFilter, but filtering and sorting run in the background and update() applies the result
+	void setFilterAsync(std::string const& regex);
 	/// Get the current song type filter number
 	unsigned short typeNum() const { return m_type; }
 	/// Description of the current song type filter
@@ -80,6 +99,10 @@ class Songs {
 	std::atomic<bool> doneLoading{ false };
 	std::atomic<bool> displayedAlert{ false };
 	size_t loadedSongs() const { std::shared_lock<std::shared_mutex> l(m_mutex); return m_songs.size(); }
+	/// Changes whenever songs are loaded or the library is reloaded
+	std::uint64_t version() const { std::shared_lock<std::shared_mutex> l(m_mutex); return m_indexVersion; }
+	/// All loaded songs (unfiltered, in load order) and their version, for use outside of the UI thread
+	SongCollection snapshot(std::uint64_t& version) const;
 	void addSongOrder(SongOrderPtr);
 
   private:
@@ -88,10 +111,14 @@ class Songs {
 
 	void dumpSongs_internal() const;
 	void reload_internal();
-	void reload_internal(fs::path const& p, Cache cache);
+	void reload_internal(fs::path const& p, Cache const& cache);
+	void addSong_internal(std::shared_ptr<Song> const& song, std::optional<FileStamp> stamp);
 	void randomize_internal();
 	void filter_internal();
 	void sort_internal(bool descending = false);
+	SongCollection filterAndSort(std::string const& filter, unsigned short type, unsigned short order, bool descending);
+	void requestFilter();
+	void filterThread();
 
 	class RestoreSel;
 	std::string m_songlist;
@@ -110,4 +137,34 @@ class Songs {
 	std::unique_ptr<std::thread> m_thread;
 	mutable std::shared_mutex m_mutex;
 	std::vector<SongOrderPtr> m_songOrders;
+	std::unordered_map<std::string, FileStamp> m_fileStamps;  ///< Stamps of the loaded songs by filename (locked with m_mutex)
+	std::unordered_map<std::string, std::int64_t> m_dirStamps;  ///< Last write times of the scanned directories (locked with m_mutex)
+	SongIndex m_index;  ///< Search index with the same ids as the positions in m_songs (locked with m_mutex)
+	std::uint64_t m_indexVersion = 0;  ///< Changes whenever m_index does (locked with m_mutex)
+	bool m_descending = false;
+
+	// Filtering and sorting; the song orders and sort keys are not thread-safe, so this is all done under m_sortMutex
+	mutable std::mutex m_sortMutex;
+	struct LastSearch {
+		std::string filter;
+		std::uint64_t indexVersion = 0;
+		SongIndex::Ids ids;
+	} m_lastSearch;  ///< Previous search, refined when more text is typed
+
+	// Background filtering (locked with m_filterMutex)
+	struct FilterRequest {
+		std::string filter;
+		unsigned short type;
+		unsigned short order;
+		bool descending;
+		std::uint64_t id;
+	};
+	std::mutex m_filterMutex;
+	std::condition_variable m_filterCond;
+	std::uint64_t m_filterId = 0;  ///< Id of the latest filter change; older results are discarded
+	std::uint64_t m_filterApplied = 0;  ///< Id of the filter change that m_filtered reflects
+	std::optional<FilterRequest> m_filterRequest;
+	std::optional<std::pair<std::uint64_t, SongCollection>> m_filterResult;
+	bool m_filterQuit = false;
+	std::thread m_filterThread;
 };
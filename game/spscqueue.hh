@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+* Lock-free single-producer single-consumer FIFO of fixed capacity (no allocations after construction).
+* Popped elements are not destroyed by the consumer; they are overwritten (and thus released) by a later push,
+* which keeps memory deallocation out of a real-time consumer such as the audio callback.
+**/
+template <typename T, std::size_t SIZE> class SpscQueue {
+  public:
+	constexpr static std::size_t capacity = SIZE;
+
+	/// Append an element (producer only). Returns false if the queue is full.
+	bool push(T&& value);
+	bool push(T const& value) { T copy(value); return push(std::move(copy)); }
+	/// Access the oldest element (consumer only), or nullptr if the queue is empty. Does not move read pointer.
+	T* front();
+	/// Discard the element returned by front() (consumer only).
+	void pop();
+	bool empty() const { return m_read.load(std::memory_order_acquire) == m_write.load(std::memory_order_acquire); }
+
+  private:
+	static std::size_t next(std::size_t idx) { return (idx + 1) % buffersize; }
+
+	constexpr static std::size_t buffersize = SIZE + 1;
+	std::array<T, buffersize> m_buf{};
+	// The indices of the next read/write operations. read == write implies that queue is empty.
+	std::atomic<std::size_t> m_read{ 0 };
+	std::atomic<std::size_t> m_write{ 0 };
+};
+
+template <typename T, std::size_t SIZE>
+bool SpscQueue<T, SIZE>::push(T&& value) {
+	std::size_t w = m_write.load(std::memory_order_relaxed);
+	std::size_t n = next(w);
+	if (n == m_read.load(std::memory_order_acquire)) return false;  // Full
+	m_buf[w] = std::move(value);
+	m_write.store(n, std::memory_order_release);
+	return true;
+}
+
+template <typename T, std::size_t SIZE>
+T* SpscQueue<T, SIZE>::front() {
+	std::size_t r = m_read.load(std::memory_order_relaxed);
+	if (r == m_write.load(std::memory_order_acquire)) return nullptr;
+	return &m_buf[r];
+}
+
+template <typename T, std::size_t SIZE>
+void SpscQueue<T, SIZE>::pop() {
+	std::size_t r = m_read.load(std::memory_order_relaxed);
+	if (r == m_write.load(std::memory_order_acquire)) return;
+	m_read.store(next(r), std::memory_order_release);
+}
@@ -1,19 +1,28 @@
 #include "texture.hh"
 
+#include "chrono.hh"
 #include "configuration.hh"
 #include "game.hh"
 #include "graphic/video_driver.hh"
 #include "log.hh"
 #include "screen.hh"
 #include "svg.hh"
+#include "trace.hh"
 #include "util.hh"
 
-#include <atomic>
+#include <algorithm>
 #include <cctype>
 #include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <sstream>
 #include <thread>
+#include <utility>
 #include <vector>
 
 Shader& getShader(Window& window, std::string const& name) {
@@ -29,16 +38,50 @@ float Dimensions::screenY() const {
 	throw std::logic_error("Dimensions::screenY(): unknown m_screenAnchor value");
 }
 
-struct Job {
-	fs::path name;
-	typedef std::function<void (Bitmap& bitmap)> ApplyFunc;
-	ApplyFunc apply;
-	Bitmap bitmap;
-	Job() {}
-	Job(fs::path const& n, ApplyFunc const& a): name(n), apply(a) {}
+/// Uploads loaded images through pixel buffer objects, reusing the texture objects of destroyed textures
+/// of the same size (main thread only)
+class TextureUploader {
+  public:
+	TextureUploader() = default;
+	~TextureUploader();
+	TextureUploader(TextureUploader const&) = delete;
+	TextureUploader& operator=(TextureUploader const&) = delete;
+	/// Upload the image as the base level of the texture. @return bytes uploaded
+	std::size_t upload(Texture& texture, Bitmap const& bitmap);
+	/// Complete an uploaded texture by generating its mipmaps
+	static void mipmaps(Texture& texture);
+	/// Keep the storage of a texture that is being destroyed for reuse
+	void recycle(Texture& texture);
+
+  private:
+	struct Storage {
+		unsigned width;
+		unsigned height;
+		GLenum format;
+		GLuint id;
+	};
+	static constexpr std::size_t poolSize = 32;  ///< Texture objects kept for reuse
+	std::deque<Storage> m_pool;  ///< Oldest first
+	std::array<GLuint, 2> m_pbos{};  ///< Upload buffers, used alternately so that filling one never waits for the other
+	std::size_t m_pbo = 0;  ///< Next PBO to use
 };
 
 class TextureLoader::Impl {
+	/// Loading of one file, shared by all textures of that file
+	struct Load {
+		fs::path name;
+		unsigned maxSize = 0;  ///< Shrink larger images to this (0 for no limit)
+		std::vector<Texture const*> targets;  ///< Textures waiting for this file
+		std::uint64_t priority = 0;  ///< Key in m_queue or m_loaded, larger goes first
+		bool queued = true;  ///< Not yet taken by a loader thread
+		bool loaded = false;  ///< In m_loaded
+		Bitmap bitmap;
+	};
+	typedef std::shared_ptr<Load> LoadPtr;
+	struct Job {
+		Texture* texture;
+		LoadPtr load;
+	};
 	/// Load a file from disk into a buffer
 	static void load(Bitmap& bitmap, fs::path const& name) {
 		try {
@@ -64,68 +107,167 @@ class TextureLoader::Impl {
 			SpdLogger::error(LogSystem::IMAGE, "Error loading texture, exception={}", e.what());
 		}
 	}
-	std::atomic<bool> m_quit{ false };
+	/// Decoding threads: one less than the cores, as the main thread is busy rendering
+	static unsigned threadCount() {
+		unsigned const cores = std::thread::hardware_concurrency();
+		return std::min(cores > 2 ? cores - 1 : 1u, 8u);
+	}
+	/// Time per frame for uploads and mipmaps (at least one texture is uploaded anyway)
+	static constexpr Seconds uploadBudget{ 0.002 };
 	std::mutex m_mutex;
 	std::condition_variable m_condition;
-	typedef std::map<void const*, Job> Jobs;
-	Jobs m_jobs;
-	std::thread m_thread;
+	bool m_quit = false;
+	std::uint64_t m_priority = 0;  ///< The priority of the most recent request
+	std::map<Texture const*, Job> m_jobs;  ///< Textures waiting for loading or uploading
+	std::map<std::pair<fs::path, unsigned>, LoadPtr> m_loads;  ///< Files queued or being loaded by name and maxSize, for sharing them
+	std::map<std::uint64_t, LoadPtr, std::greater<>> m_queue;  ///< Files not yet being loaded, most urgent first
+	std::map<std::uint64_t, LoadPtr, std::greater<>> m_loaded;  ///< Loaded files waiting for upload, most urgent first
+	// Only used by the main thread
+	std::deque<Texture*> m_mipmaps;  ///< Uploaded textures still without mipmaps
+	TextureUploader m_uploader;
+	std::vector<std::thread> m_threads;
+
 public:
-	Impl(): m_quit(), m_thread(&Impl::run, this) {}
-	~Impl() { m_quit = true; m_condition.notify_one(); m_thread.join(); }
-	/// The loader main loop: poll for image load jobs and load into RAM
+	Impl() {
+		unsigned const threads = threadCount();
+		for (unsigned i = 0; i < threads; ++i) m_threads.emplace_back(&Impl::run, this);
+	}
+	~Impl() {
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_quit = true;
+		}
+		m_condition.notify_all();
+		for (auto& thread: m_threads) thread.join();
+	}
+	/// The loader main loop: take the most urgent file and load it into RAM
 	void run() {
-		while (!m_quit) {
-			void const* target = nullptr;
-			fs::path name;
-			{
-				// Poll for jobs to be done
-				std::unique_lock<std::mutex> l(m_mutex);
-				for (auto& job: m_jobs) {
-					if (job.second.name.empty()) continue;  // Job already done
-					name = job.second.name;
-					target = job.first;
-					break;
-				}
-				// If not found, wait for one
-				if (!target) {
-					m_condition.wait(l);
-					continue;
-				}
-			}
+		Trace::threadName("texture loader");
+		std::unique_lock<std::mutex> l(m_mutex);
+		while (true) {
+			m_condition.wait(l, [this] { return m_quit || !m_queue.empty(); });
+			if (m_quit) return;
+			LoadPtr job = m_queue.begin()->second;
+			m_queue.erase(m_queue.begin());
+			job->queued = false;
+			l.unlock();
 			// Load image file into buffer
 			Bitmap bitmap;
-			load(bitmap, name);
-			// Store the result
-			std::lock_guard<std::mutex> l(m_mutex);
-			auto it = m_jobs.find(target);
-			if (it == m_jobs.end()) continue;  // The job has been removed already
-			it->second.name.clear();  // Mark the job completed
-			it->second.bitmap.swap(bitmap);  // Store the bitmap (if we got any)
+			{
+				TraceScope trace("load image");
+				load(bitmap, job->name);
+				bitmap.shrink(job->maxSize);
+			}
+			// Store the result (if the textures have been removed meanwhile, the bitmap is just dropped)
+			l.lock();
+			m_loads.erase({ job->name, job->maxSize });
+			if (job->targets.empty()) continue;
+			job->bitmap.swap(bitmap);
+			job->loaded = true;
+			m_loaded.emplace(job->priority, std::move(job));
 		}
 	}
-	/// Add a new job, using calling Texture's address as unique ID.
-	void push(void const* t, Job const& job) {
+	/// Add a new job for the texture. The newest requests are loaded first.
+	void push(Texture* t, fs::path const& name, unsigned maxSize) {
 		std::lock_guard<std::mutex> l(m_mutex);
-		m_jobs[t] = job;
+		remove(t, l);
+		LoadPtr& load = m_loads[{ name, maxSize }];
+		if (!load) {
+			load = std::make_shared<Load>();
+			load->name = name;
+			load->maxSize = maxSize;
+			load->priority = ++m_priority;
+			m_queue.emplace(load->priority, load);
+		} else {
+			requeue(load);  // Another texture already waits for the same file, only move it ahead
+		}
+		load->targets.push_back(t);
+		m_jobs[t] = Job{ t, load };
 		m_condition.notify_one();
 	}
-	/// Cancel a job in progress (no effect if the job has already completed)
-	void remove(void const* t) {
+	/// Load and upload the texture before all others that are currently waiting
+	void prioritize(Texture const* t) {
 		std::lock_guard<std::mutex> l(m_mutex);
-		m_jobs.erase(t);
+		auto it = m_jobs.find(t);
+		if (it != m_jobs.end()) requeue(it->second.load);
 	}
-	/// Upload all completed jobs to OpenGL (must be called from a valid OpenGL context)
-	void apply() {
-		std::lock_guard<std::mutex> l(m_mutex);
-		for (auto it = m_jobs.begin(); it != m_jobs.end();) {
-			{
-				Job& j = it->second;
-				if (!j.name.empty()) { ++it; continue; }  // Job incomplete, skip it
-				j.apply(j.bitmap);  // Upload to OpenGL
+	/// Forget a texture that is being destroyed (its file is not loaded at all if no other texture needs it)
+	void remove(Texture& t) {
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			remove(&t, l);
+		}
+		m_mipmaps.erase(std::remove(m_mipmaps.begin(), m_mipmaps.end(), &t), m_mipmaps.end());
+		m_uploader.recycle(t);
+	}
+	/// Upload completed jobs to OpenGL within the time budget (must be called from a valid OpenGL context)
+	TextureUploadStats apply() {
+		TraceScope trace("upload textures");
+		TextureUploadStats stats;
+		auto const start = Clock::Base::now();
+		auto const inBudget = [&] { return Clock::Base::now() - start < clockDur(uploadBudget); };
+		std::unique_lock<std::mutex> l(m_mutex);
+		// The most urgent first, and always at least one so that everything gets uploaded eventually
+		while (!m_loaded.empty() && (stats.uploads == 0 || inBudget())) {
+			LoadPtr load = m_loaded.begin()->second;
+			Texture const* t = load->targets.back();
+			load->targets.pop_back();
+			if (load->targets.empty()) {
+				m_loaded.erase(m_loaded.begin());
+				load->loaded = false;
 			}
-			m_jobs.erase(it++);
+			auto job = m_jobs.find(t);
+			Texture& texture = *job->second.texture;
+			m_jobs.erase(job);
+			// Upload to OpenGL without blocking the loader threads
+			UnlockGuard<decltype(l)> unlocked(l);
+			TraceScope traceUpload("upload texture");
+			std::size_t const bytes = m_uploader.upload(texture, load->bitmap);
+			if (bytes > 0) m_mipmaps.push_back(&texture);
+			stats.bytes += bytes;
+			++stats.uploads;
+		}
+		for (auto const& loaded: m_loaded) stats.waiting += loaded.second->targets.size();
+		l.unlock();
+		// Mipmaps with the time left, or one if there was nothing to upload
+		while (!m_mipmaps.empty() && (stats.uploads + stats.mipmaps == 0 || inBudget())) {
+			TraceScope traceMipmaps("mipmaps");
+			TextureUploader::mipmaps(*m_mipmaps.front());
+			m_mipmaps.pop_front();
+			++stats.mipmaps;
 		}
+		stats.waiting += m_mipmaps.size();
+		stats.time = Clock::Base::now() - start;
+		stats.overrun = stats.time > uploadBudget;
+		return stats;
+	}
+
+private:
+	void remove(Texture const* t, std::lock_guard<std::mutex> const&) {
+		auto it = m_jobs.find(t);
+		if (it == m_jobs.end()) return;
+		LoadPtr load = std::move(it->second.load);
+		m_jobs.erase(it);
+		auto target = std::find(load->targets.begin(), load->targets.end(), t);
+		if (target != load->targets.end()) load->targets.erase(target);
+		if (!load->targets.empty()) return;
+		// Drop the file if no other texture needs it and it is not being loaded
+		if (load->loaded) {
+			m_loaded.erase(load->priority);
+			load->loaded = false;
+		}
+		if (!load->queued) return;
+		m_queue.erase(load->priority);
+		m_loads.erase({ load->name, load->maxSize });
+	}
+	/// Move a load ahead of all others, in the queue or for uploading once loaded
+	void requeue(LoadPtr const& load) {
+		if (load->priority == m_priority) return;
+		auto& queue = load->loaded ? m_loaded : m_queue;
+		bool const waiting = load->queued || load->loaded;
+		if (waiting) queue.erase(load->priority);
+		load->priority = ++m_priority;
+		if (waiting) queue.emplace(load->priority, load);
 	}
 };
 
@@ -138,20 +280,23 @@ TextureLoader::TextureLoader() {
 
 TextureLoader::~TextureLoader() { ldr.reset(); }
 
-void updateTextures() { ldr->apply(); }
+TextureUploadStats updateTextures() { return ldr->apply(); }
 
-template <typename T> void loader(T* target, fs::path const& name) {
+template <typename T> void loader(T* target, fs::path const& name, unsigned maxSize) {
 	// Temporarily add 1x1 pixel black texture
 	Bitmap bitmap;
 	bitmap.fmt = pix::Format::RGB;
 	bitmap.resize(1, 1);
 	target->load(bitmap);
 	// Ask the loader to retrieve the image
-	ldr->push(target, Job(name, [target](Bitmap& bitmap){ target->load(bitmap); }));
+	ldr->push(target, name, maxSize);
 }
 
-Texture::Texture(fs::path const& filename) { loader(this, filename); }
-Texture::~Texture() { ldr->remove(this); }
+Texture::Texture(fs::path const& filename, unsigned maxSize) {
+	loader(this, filename, maxSize);
+	m_loading = true;
+}
+Texture::~Texture() { if (ldr && (m_loading || m_storage)) ldr->remove(*this); }
 
 // Stuff for converting pix::Format into OpenGL enum values & other flags
 namespace {
@@ -183,16 +328,121 @@ namespace {
 	}
 }
 
+namespace {
+	/// Sized internal formats, as needed for immutable storage
+	GLenum sizedFormat(bool linear) { return linear ? GL_RGBA8 : GL_SRGB8_ALPHA8; }
+	/// Levels up to GL_TEXTURE_MAX_LEVEL 4
+	GLsizei mipLevels(unsigned width, unsigned height) {
+		GLsizei levels = 1;
+		for (unsigned size = std::max(width, height); size > 1 && levels < 5; size /= 2) ++levels;
+		return levels;
+	}
+	bool hasTexStorage() {
+		static bool const supported = epoxy_gl_version() >= 42 || epoxy_has_gl_extension("GL_ARB_texture_storage");
+		return supported;
+	}
+}
+
+TextureUploader::~TextureUploader() {
+	for (auto const& storage: m_pool) glDeleteTextures(1, &storage.id);
+	if (m_pbos[0]) glDeleteBuffers(static_cast<GLsizei>(m_pbos.size()), m_pbos.data());
+}
+
+std::size_t TextureUploader::upload(Texture& texture, Bitmap const& bitmap) {
+	if (bitmap.width == 0 || bitmap.height == 0) {
+		texture.load(bitmap);  // Loading failed, just make the texture empty
+		return 0;
+	}
+	glutil::GLErrorChecker glerror("TextureUploader::upload");
+	glutil::DrawBatch::flush();
+	PixFmt const& f = getPixFmt(bitmap.fmt);
+	GLenum const format = sizedFormat(bitmap.linearPremul);
+	auto const w = static_cast<GLsizei>(bitmap.width);
+	auto const h = static_cast<GLsizei>(bitmap.height);
+	// Take a texture object of the same size, or else allocate storage for the placeholder texture object
+	auto it = std::find_if(m_pool.begin(), m_pool.end(), [&](Storage const& s) {
+		return s.width == bitmap.width && s.height == bitmap.height && s.format == format;
+	});
+	bool const reuse = it != m_pool.end();
+	if (reuse) {
+		texture.adopt(it->id);
+		m_pool.erase(it);
+	}
+	glutil::DrawBatch::bindTexture(texture.type(), texture.id());
+	if (!reuse) {
+		if (hasTexStorage()) glTexStorage2D(texture.type(), mipLevels(bitmap.width, bitmap.height), format, w, h);
+		else glTexImage2D(texture.type(), 0, static_cast<GLint>(format), w, h, 0, f.format, f.type, nullptr);
+		glerror.check("storage");
+	}
+	glTexParameteri(texture.type(), GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	glTexParameteri(texture.type(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(texture.type(), GL_TEXTURE_MAX_LEVEL, 0);  // Until the mipmaps are generated
+	if (epoxy_has_gl_extension("GL_EXT_texture_filter_anisotropic")) glTexParameterf(texture.type(), GL_TEXTURE_MAX_ANISOTROPY_EXT, 16.0f);
+	// Copy the pixels into a PBO; the GPU then reads them from there asynchronously
+	std::size_t const bytes = std::size_t{ bitmap.width } * bitmap.height * (f.format == GL_RGB || f.format == GL_BGR ? 3 : 4);
+	if (!m_pbos[0]) glGenBuffers(static_cast<GLsizei>(m_pbos.size()), m_pbos.data());
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbos[m_pbo]);
+	m_pbo = (m_pbo + 1) % m_pbos.size();
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);  // Orphan the previous contents
+	bool const mapped = [&] {
+		void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!ptr) return false;
+		std::memcpy(ptr, bitmap.data(), bytes);
+		return glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	}();
+	if (!mapped) glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), bitmap.data());
+	glerror.check("PBO");
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Bitmap rows have no padding
+	glPixelStorei(GL_UNPACK_SWAP_BYTES, f.swap);
+	glTexSubImage2D(texture.type(), 0, 0, 0, w, h, f.format, f.type, nullptr);
+	glPixelStorei(GL_UNPACK_SWAP_BYTES, GL_FALSE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glutil::GLErrorChecker::countCalls(reuse ? 13 : 14);
+	texture.m_width = static_cast<float>(bitmap.width);
+	texture.m_height = static_cast<float>(bitmap.height);
+	texture.dimensions = Dimensions(bitmap.ar).fixedWidth(1.0f);
+	texture.m_premultiplied = bitmap.linearPremul;
+	texture.m_loading = false;
+	texture.m_storage = format;
+	return bytes;
+}
+
+void TextureUploader::mipmaps(Texture& texture) {
+	glutil::GLErrorChecker glerror("TextureUploader::mipmaps");
+	glutil::DrawBatch::bindTexture(texture.type(), texture.id());
+	glGenerateMipmap(texture.type());
+	glTexParameteri(texture.type(), GL_TEXTURE_MAX_LEVEL, 4);
+	glutil::GLErrorChecker::countCalls(2);
+}
+
+void TextureUploader::recycle(Texture& texture) {
+	if (!texture.m_storage) return;
+	m_pool.push_back({ static_cast<unsigned>(texture.m_width), static_cast<unsigned>(texture.m_height), texture.m_storage, texture.release() });
+	texture.m_storage = 0;
+	if (m_pool.size() <= poolSize) return;
+	glDeleteTextures(1, &m_pool.front().id);
+	m_pool.pop_front();
+}
+
 void Texture::load(Bitmap const& bitmap, bool isText) {
 	glutil::GLErrorChecker glerror("Texture::load");
+	m_loading = false;
+	if (m_storage) {
+		// Immutable storage cannot be resized, so start over with a new texture object
+		GLuint id = 0;
+		glGenTextures(1, &id);
+		adopt(id);
+		m_storage = 0;
+	}
 	// Initialize dimensions
 	m_width = static_cast<float>(bitmap.width);
 	m_height = static_cast<float>(bitmap.height);
 	dimensions = Dimensions(bitmap.ar).fixedWidth(1.0f);
 	m_premultiplied = bitmap.linearPremul;
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(type(), id());
+	glutil::DrawBatch::flush();  // Queued draws may use the old contents
+	glutil::DrawBatch::bindTexture(type(), id());
 
 	// When texture area is small, bilinear filter the closest mipmap
 	glTexParameterf(type(), GL_TEXTURE_MIN_FILTER, isText ? GL_LINEAR : GL_LINEAR_MIPMAP_NEAREST);
@@ -209,23 +459,27 @@ void Texture::load(Bitmap const& bitmap, bool isText) {
 
 	// Load the data into texture
 	PixFmt const& f = getPixFmt(bitmap.fmt);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Bitmap rows have no padding
 	glPixelStorei(GL_UNPACK_SWAP_BYTES, f.swap);
 	glTexImage2D(type(), 0, internalFormat(bitmap.linearPremul), bitmap.width, bitmap.height, 0, f.format, f.type, bitmap.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	if (!isText) glGenerateMipmap(type());
 }
 
 void Texture::draw(Window& window) const {
+	if (m_loading) ldr->prioritize(this);  // Visible textures are loaded first
 	if (empty()) return;
 	// FIXME: This gets image alpha handling right but our ColorMatrix system always assumes premultiplied alpha
 	// (will produce incorrect results for fade effects)
-	glBlendFunc(m_premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glutil::DrawBatch::blendFunc(m_premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	draw(window, dimensions, TexCoords(tex.x1, tex.y1, tex.x2, tex.y2));
 }
 
 void Texture::draw(Window& window, glmath::mat3 const& matrix) const {
+	if (m_loading) ldr->prioritize(this);
 	if (empty()) return;
 	// FIXME: This gets image alpha handling right but our ColorMatrix system always assumes premultiplied alpha
 	// (will produce incorrect results for fade effects)
-	glBlendFunc(m_premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glutil::DrawBatch::blendFunc(m_premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	draw(window, dimensions, TexCoords(tex.x1, tex.y1, tex.x2, tex.y2), matrix);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "chrono.hh"
+#include "graphic/draw_batch.hh"
 #include "graphic/glutil.hh"
 #include "image.hh"
 #include "graphic/window.hh"
@@ -7,9 +9,11 @@
 #include <cairo.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 /// class for geometry stuff
@@ -119,7 +123,7 @@ template <GLenum Type> class OpenGLTexture {
 	static GLenum type() { return Type; };
 	static Shader& shader(Window& window) { return getShader(window, "texture"); }
 	OpenGLTexture(): m_id() { glGenTextures(1, &m_id); }
-	~OpenGLTexture() { glDeleteTextures(1, &m_id); }
+	~OpenGLTexture() { glutil::DrawBatch::textureDeleted(m_id); glDeleteTextures(1, &m_id); }
 	/// returns id
 	GLuint id() const { return m_id; };
 	/// draw in given dimensions, with given texture coordinates
@@ -127,6 +131,11 @@ template <GLenum Type> class OpenGLTexture {
 	void draw(Window&, Dimensions const& dim, TexCoords const& tex, glmath::mat3 const& matrix) const;
 	/// draw a subsection of the orig dimensions, cropping by tex
 	void drawCropped(Window&, Dimensions const& orig, TexCoords const& tex) const;
+  protected:
+	/// Take ownership of another texture object, deleting the current one
+	void adopt(GLuint id) { glutil::DrawBatch::textureDeleted(m_id); glDeleteTextures(1, &m_id); m_id = id; }
+	/// Give up the ownership of the texture object
+	GLuint release() { glutil::DrawBatch::textureDeleted(m_id); return std::exchange(m_id, 0u); }
   private:
 	GLuint m_id;
 };
@@ -140,8 +149,8 @@ class UseTexture {
 	template <GLenum Type> UseTexture(Window& window, OpenGLTexture<Type> const& tex):
 	  m_shader(
 		  /* hack of the year */
-		  (glutil::GLErrorChecker("UseTexture"), glActiveTexture(GL_TEXTURE0),
-		  glBindTexture(Type, tex.id()), tex.shader(window))) {
+		  (glutil::GLErrorChecker("UseTexture"), glutil::DrawBatch::bindTexture(Type, tex.id()),
+		  tex.shader(window))) {
 	  }
 
   private:
@@ -156,10 +165,7 @@ template <GLenum Type> void OpenGLTexture<Type>::draw(Window& window, Dimensions
 	glerror.check("texture");
 
 	// The texture wraps over at the edges (repeat)
-	const bool repeating = tex.outOfBounds();
-	glTexParameterf(type(), GL_TEXTURE_WRAP_S, repeating ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-	glTexParameterf(type(), GL_TEXTURE_WRAP_T, repeating ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-	glerror.check("repeat mode");
+	glutil::DrawBatch::textureWrap(type(), tex.outOfBounds());
 
 	va.texCoord(tex.x1, tex.y1).vertex(dim.x1(), dim.y1());
 	va.texCoord(tex.x2, tex.y1).vertex(dim.x2(), dim.y1());
@@ -177,10 +183,7 @@ template <GLenum Type> void OpenGLTexture<Type>::draw(Window& window, Dimensions
 	glerror.check("texture");
 
 	// The texture wraps over at the edges (repeat)
-	const bool repeating = tex.outOfBounds();
-	glTexParameterf(type(), GL_TEXTURE_WRAP_S, repeating ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-	glTexParameterf(type(), GL_TEXTURE_WRAP_T, repeating ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-	glerror.check("repeat mode");
+	glutil::DrawBatch::textureWrap(type(), tex.outOfBounds());
 
 	auto const v0 = matrix * glmath::vec3(dim.x1(), dim.y1(), 1);
 	auto const v1 = matrix * glmath::vec3(dim.x2(), dim.y1(), 1);
@@ -205,7 +208,18 @@ template <GLenum Type> void OpenGLTexture<Type>::drawCropped(Window& window, Dim
 	draw(window, dim, tex);
 }
 
-void updateTextures();
+/// What one call of updateTextures did
+struct TextureUploadStats {
+	unsigned uploads = 0;
+	unsigned mipmaps = 0;  ///< Textures whose mipmaps were generated
+	std::size_t bytes = 0;  ///< Uploaded pixel data
+	std::size_t waiting = 0;  ///< Uploads and mipmaps left for the following frames
+	Seconds time{};
+	bool overrun = false;  ///< Took longer than the per frame budget (a single large image may do that)
+};
+
+/// Upload loaded images to textures, as many as fit in the per frame time budget (call once per frame)
+TextureUploadStats updateTextures();
 
 /**
 * @short High level texture/image wrapper on top of OpenGLTexture
@@ -218,10 +232,11 @@ public:
 	/// texture coordinates
 	TexCoords tex;
 	Texture() = default;
-	/// creates texture from file
-	Texture(fs::path const& filename);
+	/// creates texture from file, shrinking images larger than maxSize (0 for no limit) while loading
+	Texture(fs::path const& filename, unsigned maxSize = 0);
 	~Texture();
 	bool empty() const { return m_width * m_height == 0.f; } ///< Test if the loading has failed
+	bool loading() const { return m_loading; } ///< Still waiting for the image (shown as a black pixel)
 	/// draws texture
 	void draw(Window&) const;
 	void draw(Window&, glmath::mat3 const&) const;
@@ -235,10 +250,13 @@ private:
 	float m_width = 0.f;
 	float m_height = 0.f;
 	bool m_premultiplied = true;
+	bool m_loading = false;  ///< Waiting for TextureLoader
+	GLenum m_storage = 0;  ///< Internal format of the immutable storage given by TextureUploader (0 if none)
+	friend class TextureUploader;
 	OpenGLTexture<GL_TEXTURE_2D> m_texture;
 };
 
-/// A RAII wrapper for texture loading worker thread. There must be exactly one (global) instance whenever any Textures exist.
+/// A RAII wrapper for the texture loading worker threads. There must be exactly one (global) instance whenever any Textures exist.
 class TextureLoader {
 public:
 	TextureLoader();
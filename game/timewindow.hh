@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+/**
+* @short A pair of cursors over time sorted items (e.g. chords or beats) marking those that are on screen.
+*
+* The items must be sorted by their begin time. first() is the earliest item that may still end inside the
+* window and last() is one past the final item that begins before the window ends. While the time advances
+* the cursors only move forward, so a frame costs time proportional to the visible items. Seeking backwards
+* rebuilds them with a binary search, using the longest item to find those that still reach the window.
+**/
+class TimeWindow {
+  public:
+	/// Forget the position and measure the items, must be called whenever the items change
+	template <typename Items, typename Begin, typename End> void reset(Items const& items, Begin begin, End end) {
+		m_first = m_last = 0;
+		m_from = -std::numeric_limits<double>::infinity();
+		m_longest = 0.0;
+		for (auto const& item: items) m_longest = std::max(m_longest, end(item) - begin(item));
+	}
+	/// Move the window to [from, to], calling passed(item) for each item that the window leaves behind
+	template <typename Items, typename Begin, typename End, typename Passed>
+	void update(Items& items, double from, double to, Begin begin, End end, Passed passed) {
+		std::size_t const size = items.size();
+		if (from < m_from || m_last > size) seek(items, from, begin);
+		m_from = from;
+		for (; m_first < size && end(items[m_first]) < from; ++m_first) passed(items[m_first]);
+		m_last = std::max(m_last, m_first);
+		while (m_last < size && begin(items[m_last]) <= to) ++m_last;
+	}
+	template <typename Items, typename Begin, typename End>
+	void update(Items const& items, double from, double to, Begin begin, End end) {
+		update(items, from, to, begin, end, [](auto const&) {});
+	}
+	/// The first item that may be visible
+	std::size_t first() const { return m_first; }
+	/// One past the last item that may be visible
+	std::size_t last() const { return m_last; }
+
+  private:
+	template <typename Items, typename Begin> void seek(Items const& items, double from, Begin begin) {
+		double const earliest = from - m_longest;
+		auto it = std::partition_point(items.begin(), items.end(), [&](auto const& item) { return begin(item) < earliest; });
+		m_first = m_last = static_cast<std::size_t>(it - items.begin());
+	}
+	std::size_t m_first = 0;
+	std::size_t m_last = 0;
+	double m_from = -std::numeric_limits<double>::infinity();  ///< The window start of the previous update
+	double m_longest = 0.0;  ///< The longest item duration
+};
@@ -0,0 +1,177 @@
+#include "trace.hh"
+
+#include "chrono.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::atomic<bool> Trace::s_enabled{ false };
+
+namespace {
+	constexpr std::size_t threadSlots = 32;  ///< Threads that can be traced at the same time
+	constexpr std::uint64_t capacity = 1 << 15;  ///< Events kept per thread (older ones are overwritten)
+	constexpr std::size_t maxRetired = 1024;  ///< Names of exited threads kept
+
+	/// The fields are atomics because the owner thread may be overwriting them while they are written out
+	struct Event {
+		std::atomic<char const*> name;
+		std::atomic<std::int64_t> time;  ///< Nanoseconds of the steady clock
+		std::atomic<std::uint32_t> thread;
+		std::atomic<char> phase;
+	};
+
+	/// The ring buffer of one thread. The two counters work as a seqlock: an event is only valid for the
+	/// reader if the owner had not reserved its position for a newer event by the time it was read.
+	struct Slot {
+		std::atomic<bool> used;
+		std::atomic<std::uint32_t> thread;  ///< Serial number of the owner thread
+		std::atomic<char const*> name;  ///< Name of the owner thread
+		std::atomic<std::uint64_t> reserved;  ///< Events started
+		std::atomic<std::uint64_t> committed;  ///< Events completely written
+		std::array<Event, capacity> events;
+	};
+
+	// Static zero-initialized storage, so memory is only touched by threads that actually record
+	std::array<Slot, threadSlots> slots;
+	std::atomic<std::uint32_t> threadSerial;
+	std::atomic<std::int64_t> since;  ///< Events before this belong to an earlier recording
+	std::mutex retiredMutex;
+	std::deque<std::pair<std::uint32_t, char const*>> retired;  ///< Names of exited threads, by serial
+
+	std::int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::Base::now().time_since_epoch()).count();  // Real time, even when capturing frames
+	}
+
+	/// The slot of the calling thread, given back when the thread exits
+	struct ThreadSlot {
+		Slot* slot = nullptr;
+		~ThreadSlot() {
+			if (!slot) return;
+			if (char const* name = slot->name.load(std::memory_order_relaxed)) {
+				std::lock_guard<std::mutex> l(retiredMutex);
+				retired.emplace_back(slot->thread.load(std::memory_order_relaxed), name);
+				if (retired.size() > maxRetired) retired.pop_front();
+			}
+			slot->used.store(false, std::memory_order_release);
+		}
+	};
+	thread_local ThreadSlot threadSlot;
+	thread_local char const* currentName = nullptr;  ///< Set by Trace::threadName
+
+	/// Find a slot for the calling thread without locking. @return nullptr if all are in use
+	Slot* acquire() {
+		if (threadSlot.slot) return threadSlot.slot;
+		for (auto& slot: slots) {
+			if (slot.used.load(std::memory_order_relaxed) || slot.used.exchange(true, std::memory_order_acquire)) continue;
+			slot.thread.store(++threadSerial, std::memory_order_relaxed);
+			slot.name.store(currentName, std::memory_order_relaxed);
+			return threadSlot.slot = &slot;
+		}
+		return nullptr;
+	}
+
+	std::string escape(char const* str) {
+		std::string ret;
+		for (; *str; ++str) {
+			if (*str == '"' || *str == '\\') ret += '\\';
+			ret += *str;
+		}
+		return ret;
+	}
+}
+
+void Trace::enable(bool on) {
+	if (on && !enabled()) since = now();
+	s_enabled.store(on, std::memory_order_relaxed);
+}
+
+void Trace::record(char const* name, char phase) {
+	Slot* slot = acquire();
+	if (!slot) return;
+	auto const index = slot->reserved.load(std::memory_order_relaxed);
+	slot->reserved.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Event& event = slot->events[index % capacity];
+	event.name.store(name, std::memory_order_relaxed);
+	event.time.store(now(), std::memory_order_relaxed);
+	event.thread.store(slot->thread.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	event.phase.store(phase, std::memory_order_relaxed);
+	slot->committed.store(index + 1, std::memory_order_release);
+}
+
+void Trace::threadName(char const* name) {
+	currentName = name;
+	if (threadSlot.slot) threadSlot.slot->name.store(name, std::memory_order_relaxed);
+}
+
+std::size_t Trace::write(fs::path const& filename) {
+	struct Row {
+		std::int64_t time;
+		std::uint32_t thread;
+		char phase;
+		char const* name;
+	};
+	std::vector<Row> rows;
+	std::map<std::uint32_t, char const*> names;
+	{
+		std::lock_guard<std::mutex> l(retiredMutex);
+		for (auto const& [thread, name]: retired) names[thread] = name;
+	}
+	for (auto& slot: slots) {
+		auto const end = slot.committed.load(std::memory_order_acquire);
+		if (end == 0) continue;
+		auto const begin = end > capacity ? end - capacity : 0;
+		std::size_t const first = rows.size();
+		for (auto i = begin; i < end; ++i) {
+			Event const& e = slot.events[i % capacity];
+			rows.push_back({ e.time.load(std::memory_order_relaxed), e.thread.load(std::memory_order_relaxed), e.phase.load(std::memory_order_relaxed), e.name.load(std::memory_order_relaxed) });
+		}
+		// Drop the events that the owner has meanwhile started to overwrite
+		std::atomic_thread_fence(std::memory_order_acquire);
+		auto const reserved = slot.reserved.load(std::memory_order_relaxed);
+		auto const valid = reserved > capacity ? reserved - capacity : 0;
+		if (valid > begin) {
+			auto const overwritten = static_cast<std::ptrdiff_t>(std::min(valid, end) - begin);
+			rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(first), rows.begin() + static_cast<std::ptrdiff_t>(first) + overwritten);
+		}
+		char const* name = slot.name.load(std::memory_order_relaxed);
+		if (slot.used.load(std::memory_order_acquire) && name) names[slot.thread.load(std::memory_order_relaxed)] = name;
+	}
+	// Keep only this recording, and only ends whose begin is still there (each thread's events are in order)
+	std::int64_t const start = since.load();
+	std::map<std::uint32_t, unsigned> depth;
+	rows.erase(std::remove_if(rows.begin(), rows.end(), [&](Row const& row) {
+		if (row.time < start) return true;
+		unsigned& d = depth[row.thread];
+		if (row.phase == 'B') { ++d; return false; }
+		if (d == 0) return true;
+		--d;
+		return false;
+	}), rows.end());
+
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Performous\"}}";
+	for (auto const& [thread, name]: names) {
+		if (depth.find(thread) == depth.end()) continue;  // No events from this thread
+		fmt::format_to(std::back_inserter(out), ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", thread, escape(name));
+	}
+	for (auto const& row: rows) {
+		fmt::format_to(std::back_inserter(out), ",\n{{\"name\":\"{}\",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":1,\"tid\":{}}}", escape(row.name), row.phase, static_cast<double>(row.time - start) / 1000.0, row.thread);
+	}
+	out += "\n]}\n";
+	std::ofstream file(filename, std::ios::binary);
+	file << out;
+	if (!file) throw std::runtime_error("Could not write trace file " + filename.string());
+	return rows.size();
+}
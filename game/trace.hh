@@ -0,0 +1,51 @@
+#pragma once
+
+#include "fs.hh"
+
+#include <atomic>
+#include <cstddef>
+
+/**
+* @short Low-overhead event tracing, for finding the cause of stutter.
+*
+* Every thread records begin/end events of named spans into its own preallocated ring buffer,
+* without locking or allocating, so this may also be used in the audio callback. Only the name
+* pointers are stored, so names must be string literals. When tracing is disabled, recording
+* costs a single relaxed atomic load.
+*
+* The most recent events of all threads can be written as a Chrome trace (JSON) and opened in
+* chrome://tracing or https://ui.perfetto.dev.
+**/
+class Trace {
+  public:
+	static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+	/// Start or stop recording; starting discards the events of any earlier recording
+	static void enable(bool on);
+	/// Begin a span (prefer TraceScope)
+	static void begin(char const* name) { if (enabled()) record(name, 'B'); }
+	/// End the innermost span of this thread
+	static void end(char const* name) { if (enabled()) record(name, 'E'); }
+	/// Name the calling thread in the trace (cheap, so it may be repeated e.g. in a callback)
+	static void threadName(char const* name);
+	/// Write the recorded events as Chrome trace JSON. @return the number of events written
+	static std::size_t write(fs::path const& filename);
+
+  private:
+	friend class TraceScope;
+	static void record(char const* name, char phase);
+	static std::atomic<bool> s_enabled;
+};
+
+/// A span from construction to destruction (nothing is recorded if tracing was disabled at construction)
+class TraceScope {
+  public:
+	explicit TraceScope(char const* name): m_name(Trace::enabled() ? name : nullptr) {
+		if (m_name) Trace::record(m_name, 'B');
+	}
+	~TraceScope() { if (m_name) Trace::record(m_name, 'E'); }
+	TraceScope(TraceScope const&) = delete;
+	TraceScope& operator=(TraceScope const&) = delete;
+
+  private:
+	char const* m_name;
+};
@@ -4,6 +4,7 @@
 #include "game.hh"
 #include "log.hh"
 
+#include <algorithm>
 #include <regex>
 #include <stdexcept>
 #include <unicode/unistr.h>
@@ -16,6 +17,7 @@ std::unique_ptr<icu::RuleBasedCollator> UnicodeUtil::m_sortCollator;
 
 std::map<std::string, Converter> UnicodeUtil::m_converters{};
 std::mutex UnicodeUtil::m_convertersMutex;
+std::atomic<unsigned> UnicodeUtil::m_collatorGeneration{ 1 };
 
 Converter::Converter(std::string const& codepage): m_codepage(codepage), m_converter(nullptr, &ucnv_close) {
 	m_converter = std::unique_ptr<UConverter, decltype(&ucnv_close)>(ucnv_open(m_codepage.c_str(), m_error), &ucnv_close);
@@ -179,6 +181,35 @@ std::string UnicodeUtil::toTitle (std::string_view str) {
 	return convertToUTF8 (str, "", CaseMapping::TITLE);
 }
 
+std::string UnicodeUtil::sortKey(std::string_view str, bool caseSensitive) {
+	// Each thread uses its own copies of the sort collator, so that keys can be computed by the
+	// song loader threads while the shared collator stays untouched
+	struct Collators {
+		unsigned generation = 0;
+		std::unique_ptr<icu::Collator> secondary, tertiary;
+	};
+	thread_local Collators local;
+	unsigned const generation = m_collatorGeneration;
+	if (local.generation != generation) {
+		if (!m_sortCollator) return std::string(str);
+		local.secondary.reset(m_sortCollator->clone());
+		local.tertiary.reset(m_sortCollator->clone());
+		local.secondary->setStrength(icu::Collator::SECONDARY);
+		local.tertiary->setStrength(icu::Collator::TERTIARY);
+		local.generation = generation;
+	}
+	icu::Collator const& collator = caseSensitive ? *local.tertiary : *local.secondary;
+	icu::UnicodeString ustring = icu::UnicodeString::fromUTF8(icu::StringPiece(str.data(), static_cast<std::int32_t>(str.size())));
+	std::string key(2 * str.size() + 16, '\0');
+	auto length = collator.getSortKey(ustring, reinterpret_cast<std::uint8_t*>(key.data()), static_cast<std::int32_t>(key.size()));
+	if (static_cast<std::size_t>(length) > key.size()) {
+		key.resize(static_cast<std::size_t>(length));
+		length = collator.getSortKey(ustring, reinterpret_cast<std::uint8_t*>(key.data()), length);
+	}
+	key.resize(static_cast<std::size_t>(std::max(length - 1, 0)));  // Drop the terminating zero byte
+	return key;
+}
+
 void UnicodeUtil::collate (songMetadata& stringmap) {
 	for (auto const& [key, value]: stringmap) { 
 		ConfigItem::StringList termsToCollate = config["game/sorting_ignore"].sl();
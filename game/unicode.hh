@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -51,8 +52,16 @@ class UnicodeUtil {
 	static std::string toLower (std::string_view str);
 	static std::string toUpper (std::string_view str);
 	static std::string toTitle (std::string_view str);
+	/// Collation sort key of a UTF-8 string with the sort collator; keys compare bytewise (std::string operator<)
+	static std::string sortKey(std::string_view str, bool caseSensitive);
+	/// Changes whenever the collators are replaced (e.g. language change), invalidating sort keys
+	static unsigned collatorGeneration() { return m_collatorGeneration; }
+	static void collatorsChanged() { ++m_collatorGeneration; }
 
 	static std::unique_ptr<icu::RuleBasedCollator> m_searchCollator;
 	static std::unique_ptr<icu::RuleBasedCollator> m_sortCollator;
 	static std::mutex m_convertersMutex;
+
+	private:
+	static std::atomic<unsigned> m_collatorGeneration;
 };
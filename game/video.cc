@@ -2,12 +2,33 @@
 
 #include "ffmpeg.hh"
 #include "log.hh"
+#include "trace.hh"
 #include "util.hh"
 #include "graphic/color_trans.hh"
 
 #include <cmath>
+#include <cstring>
+
+namespace {
+	/// Conversion from the sampled (y, u, v) to non-linear RGB
+	glmath::mat4 yuvMatrix(bool fullRange, bool bt709) {
+		float const kr = bt709 ? 0.2126f : 0.299f;
+		float const kb = bt709 ? 0.0722f : 0.114f;
+		float const kg = 1.0f - kr - kb;
+		// Columns are the contributions of Y, U and V
+		glmath::mat4 const rgb(glmath::mat3(
+		  1.0f, 1.0f, 1.0f,
+		  0.0f, -2.0f * (1.0f - kb) * kb / kg, 2.0f * (1.0f - kb),
+		  2.0f * (1.0f - kr), -2.0f * (1.0f - kr) * kr / kg, 0.0f));
+		float const y0 = fullRange ? 0.0f : 16.0f / 255.0f;
+		float const c0 = 128.0f / 255.0f;
+		float const ys = fullRange ? 1.0f : 255.0f / 219.0f;
+		float const cs = fullRange ? 1.0f : 255.0f / 224.0f;
+		return rgb * glmath::scale(glmath::vec3(ys, cs, cs)) * glmath::translate(glmath::vec3(-y0, -c0, -c0));
+	}
+}
 
-bool Video::tryPop(Bitmap& f, double timestamp) {
+bool Video::tryPop(VideoFrame& f, double timestamp) {
 	std::unique_lock<std::mutex> l(m_mutex);
 
 	// if timestamp is out of the queue's range, ask a seek
@@ -24,7 +45,10 @@ bool Video::tryPop(Bitmap& f, double timestamp) {
 	if (m_seek_asked) return false;
 
 	// discard outdated frames retaining only the most recent frame that is _before_ timestamp
-	while (!m_queue.empty() && std::next(m_queue.begin()) != m_queue.end() && std::next(m_queue.begin())->timestamp < timestamp) m_queue.pop_front();
+	while (!m_queue.empty() && std::next(m_queue.begin()) != m_queue.end() && std::next(m_queue.begin())->timestamp < timestamp) {
+		recycle(std::move(m_queue.front()));
+		m_queue.pop_front();
+	}
 
 	if (m_queue.empty() || m_queue.front().timestamp > timestamp) return false; // Nothing to deliver
 
@@ -33,13 +57,26 @@ bool Video::tryPop(Bitmap& f, double timestamp) {
 	return true;
 }
 
-void Video::push(Bitmap&& f) {
+void Video::push(VideoFrame&& f) {
 	std::unique_lock<std::mutex> l(m_mutex);
 	m_cond.wait(l, [this]{ return m_quit || m_seek_asked || m_queue.size() < m_max; });
-	if (m_quit || m_seek_asked) return; // Drop frame when seek/quit asked
+	if (m_quit || m_seek_asked) return recycle(std::move(f)); // Drop frame when seek/quit asked
 	m_queue.emplace_back(std::move(f));
 }
 
+VideoFrame Video::takeFrame() {
+	std::lock_guard<std::mutex> l(m_mutex);
+	if (m_pool.empty()) return VideoFrame();
+	VideoFrame f = std::move(m_pool.back());
+	m_pool.pop_back();
+	return f;
+}
+
+void Video::recycle(VideoFrame&& f) {
+	if (f.buf.empty() || m_pool.size() > m_max) return;
+	m_pool.emplace_back(std::move(f));
+}
+
 Video::~Video() {
 	{
 		std::lock_guard<std::mutex> l(m_mutex);
@@ -47,12 +84,14 @@ Video::~Video() {
 	}
 	m_cond.notify_all();
 	m_grabber.get();
+	glDeleteBuffers(static_cast<GLsizei>(m_pbos.size()), m_pbos.data());
 }
 
 Video::Video(fs::path const& _videoFile, double videoGap): m_videoGap(videoGap), m_textureTime(), m_alpha(-0.5f, 1.5f) {
 	m_grabber = std::async(std::launch::async, [this, file = _videoFile] {
+		Trace::threadName("video decoder");
 		try {
-			auto ffmpeg = std::make_unique<VideoFFmpeg>(file, [this](auto f) { this->push(std::move(f)); });
+			auto ffmpeg = std::make_unique<VideoFFmpeg>(file, [this](VideoFrame&& f) { push(std::move(f)); }, [this] { return takeFrame(); });
 			int errors = 0;
 			std::unique_lock<std::mutex> l(m_mutex);
 			while (!m_quit) {
@@ -61,6 +100,7 @@ Video::Video(fs::path const& _videoFile, double videoGap): m_videoGap(videoGap),
 
 					auto seek_pos = m_readPosition;
 					// discard all outdated frame. To avoid races between clean and push, clean and push are done in this thread.
+					for (auto& f: m_queue) recycle(std::move(f));
 					m_queue.clear();
 
 					UnlockGuard<decltype(l)> unlocked(l);  // release lock during seek
@@ -75,7 +115,7 @@ Video::Video(fs::path const& _videoFile, double videoGap): m_videoGap(videoGap),
 				} catch (FFmpeg::Eof&) {
 					{
 						UnlockGuard<decltype(l)> unlocked(l);  // release lock for possibly blocking calls
-						push(Bitmap());						   // EOF marker
+						push(VideoFrame());					   // EOF marker
 						SpdLogger::debug(LogSystem::FFMPEG, "File={}, done loading.", file);
 					}
 					m_cond.wait(l, [this] { return m_quit || m_seek_asked; });
@@ -100,11 +140,59 @@ void Video::prepare(double time) {
 	// shift video timestamp if gap is declared in song config
 	time += m_videoGap;
 
-	Bitmap videoFrame;
+	VideoFrame videoFrame;
 	if (tryPop(videoFrame, time) && !videoFrame.buf.empty()) {
-		m_texture.load(videoFrame);
+		upload(videoFrame);
 		m_textureTime = videoFrame.timestamp;
+		std::lock_guard<std::mutex> l(m_mutex);
+		recycle(std::move(videoFrame));
+	}
+}
+
+void Video::upload(VideoFrame const& f) {
+	glutil::GLErrorChecker glerror("Video::upload");
+	glutil::DrawBatch::flush();
+	if (!m_pbos[0]) glGenBuffers(static_cast<GLsizei>(m_pbos.size()), m_pbos.data());
+	// Copy the planes into a PBO; the GPU then reads them from there asynchronously
+	GLsizeiptr const bytes = static_cast<GLsizeiptr>(f.buf.size());
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbos[m_pbo]);
+	m_pbo = (m_pbo + 1) % m_pbos.size();
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);  // Orphan the previous contents
+	bool const mapped = [&] {
+		void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!ptr) return false;
+		std::memcpy(ptr, f.buf.data(), f.buf.size());
+		return glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	}();
+	if (!mapped) glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, bytes, f.buf.data());
+	glerror.check("PBO");
+	// Texture storage is only (re)allocated when the frame layout changes
+	bool const realloc = f.width != m_width || f.height != m_height || f.nv12 != m_nv12;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned i = 0; i < f.planes(); ++i) {
+		bool const interleaved = f.nv12 && i == 1;
+		GLenum const format = interleaved ? GL_RG : GL_RED;
+		auto const w = static_cast<GLsizei>(i == 0 ? f.width : f.chromaWidth());
+		auto const h = static_cast<GLsizei>(f.planeHeight(i));
+		glutil::DrawBatch::bindTexture(GL_TEXTURE_2D, m_planes[i].id());
+		if (realloc) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, interleaved ? GL_RG8 : GL_R8, w, h, 0, format, GL_UNSIGNED_BYTE, nullptr);
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, format, GL_UNSIGNED_BYTE, reinterpret_cast<void const*>(f.planeOffset(i)));
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glutil::GLErrorChecker::countCalls(6 + 2 * f.planes());
+	m_width = f.width;
+	m_height = f.height;
+	m_nv12 = f.nv12;
+	m_fullRange = f.fullRange;
+	m_bt709 = f.bt709;
+	m_dimensions.ar(static_cast<float>(f.width) / static_cast<float>(f.height)).fixedWidth(1.0f);
 }
 
 void Video::render(Window& window, double time) {
@@ -112,7 +200,20 @@ void Video::render(Window& window, double time) {
 	double tdist = std::abs(m_textureTime - time);
 	m_alpha.setTarget(tdist < 0.4 ? 1.2f : -0.5f);
 	float alpha = static_cast<float>(clamp(m_alpha.get()));
-	if (alpha == 0.0f) return;
+	if (alpha == 0.0f || m_width == 0) return;
 	ColorTrans c(window, Color::alpha(alpha));
-	m_texture.draw(window);
+	Shader& shader = window.shader("video");
+	shader["nv12"].set(m_nv12 ? 1 : 0);
+	shader["yuvMatrix"].setMat4(yuvMatrix(m_fullRange, m_bt709));
+	UseShader use(shader);
+	for (unsigned i = 0; i < m_planes.size(); ++i) glutil::DrawBatch::bindTexture(GL_TEXTURE_2D, m_planes[i].id(), i);
+	// Same blending as the RGB video textures had (not premultiplied)
+	glutil::DrawBatch::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	Dimensions const& dim = m_dimensions;
+	glutil::VertexArray va;
+	va.texCoord(0.0f, 0.0f).vertex(dim.x1(), dim.y1());
+	va.texCoord(1.0f, 0.0f).vertex(dim.x2(), dim.y1());
+	va.texCoord(0.0f, 1.0f).vertex(dim.x1(), dim.y2());
+	va.texCoord(1.0f, 1.0f).vertex(dim.x2(), dim.y2());
+	va.draw();
 }
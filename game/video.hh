@@ -1,10 +1,14 @@
 #pragma once
 
 #include "animvalue.hh"
+#include "ffmpeg.hh"
 #include "texture.hh"
+#include <array>
+#include <cstddef>
 #include <deque>
 #include <future>
 #include <string>
+#include <vector>
 
 /// class for playing videos
 class Video {
@@ -15,11 +19,10 @@ class Video {
 	void prepare(double time);  ///< Load the current video frame into a texture
 	void render(Window&, double time);  ///< Render the prepared video frame
 	/// returns Dimensions of video clip
-	Dimensions const& dimensions() const { return m_texture.dimensions; }
+	Dimensions const& dimensions() const { return m_dimensions; }
 
   private:
 	const double m_videoGap;
-	Texture m_texture;
 	double m_textureTime;
 	double m_readPosition = 0.0;
 	AnimValue m_alpha;
@@ -27,20 +30,35 @@ class Video {
 	std::future<void> m_grabber;
 
 	/// trys to pop a video frame from queue
-	bool tryPop(Bitmap& f, double timestamp);
+	bool tryPop(VideoFrame& f, double timestamp);
 	/// Add frame to queue
-	void push(Bitmap&& f);
-	/// Clear and unlock the queue
-	void reset();
+	void push(VideoFrame&& f);
+	/// Get a frame buffer to decode into, reusing a recycled one if available
+	VideoFrame takeFrame();
+	/// Return a frame buffer for reuse (must be called holding the mutex)
+	void recycle(VideoFrame&& f);
+	/// Upload the planes of a frame into the textures
+	void upload(VideoFrame const& f);
 	/// return timestamp of next frame to read
 	double headPosition() const { return m_queue.front().timestamp; }
 	/// return timestamp of next frame to read
 	double backPosition() const { return m_queue.back().timestamp; }
 
-	std::deque<Bitmap> m_queue;
+	std::deque<VideoFrame> m_queue;
+	std::vector<VideoFrame> m_pool;  ///< Frame buffers for reuse, so that decoding does not allocate
 	mutable std::mutex m_mutex;
 	std::condition_variable m_cond;
 	static const unsigned m_max = 20;
 	bool m_seek_asked{false};
+
+	// Render thread only
+	std::array<OpenGLTexture<GL_TEXTURE_2D>, 3> m_planes;  ///< Y, U and V (or interleaved UV in the second one for NV12)
+	std::array<GLuint, 2> m_pbos{};  ///< Upload buffers, used alternately so that filling one never waits for the other
+	std::size_t m_pbo = 0;  ///< Next PBO to use
+	unsigned m_width = 0, m_height = 0;  ///< Size of the texture storage
+	bool m_nv12 = false;
+	bool m_fullRange = false;
+	bool m_bt709 = false;
+	Dimensions m_dimensions;
 };
 
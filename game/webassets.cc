@@ -0,0 +1,84 @@
+#include "webassets.hh"
+
+#include "gzip.hh"
+#include "log.hh"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+	/// FNV-1a, only used to tell versions of a file apart
+	std::uint64_t contentHash(std::string const& data) {
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c: data) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+std::string WebAssets::contentType(fs::path const& file) {
+	static std::unordered_map<std::string, std::string> const types = {
+		{ ".html", "text/html; charset=utf-8" },
+		{ ".js", "text/javascript; charset=utf-8" },
+		{ ".css", "text/css; charset=utf-8" },
+		{ ".json", "application/json" },
+		{ ".map", "application/json" },
+		{ ".png", "image/png" },
+		{ ".gif", "image/gif" },
+		{ ".ico", "image/x-icon" },
+		{ ".svg", "image/svg+xml" },
+		{ ".eot", "application/vnd.ms-fontobject" },
+		{ ".ttf", "font/ttf" },
+		{ ".woff", "font/woff" },
+		{ ".woff2", "font/woff2" },
+	};
+	auto it = types.find(file.extension().string());
+	return it == types.end() ? "application/octet-stream" : it->second;
+}
+
+Paths WebAssets::webFolders(Paths const& themePaths) {
+	Paths folders;
+	for (auto const& path: themePaths) {
+		std::error_code ec;
+		if (std::find(path.begin(), path.end(), fs::path("www")) != path.end() && fs::is_directory(path, ec)) folders.push_back(path);
+	}
+	return folders;
+}
+
+WebAssets::WebAssets(Paths const& dirs) {
+	for (auto const& dir: dirs) {
+		std::error_code ec;
+		for (auto const& item: fs::directory_iterator(dir, ec)) {
+			if (!item.is_regular_file()) continue;
+			fs::path const& path = item.path();
+			std::string const name = path.filename().string();
+			if (m_assets.count(name)) continue;  // Hidden by an earlier directory, e.g. of the selected theme
+			BinaryBuffer data;
+			try {
+				data = readFile(path);
+			} catch (std::exception const& e) {
+				SpdLogger::warn(LogSystem::WEBSERVER, "Cannot load web file={}, error={}", path, e.what());
+				continue;
+			}
+			auto body = std::make_shared<std::string const>(data.begin(), data.end());
+			Asset& asset = m_assets[name];
+			asset.contentType = contentType(path);
+			asset.etag = fmt::format("\"{:016x}\"", contentHash(*body));
+			// Images and fonts are mostly compressed already; keep a gzip variant only if it saves a tenth
+			if (body->size() >= 1024) {
+				auto gzipped = std::make_shared<std::string const>(gzip(*body));
+				if (gzipped->size() * 10 < body->size() * 9) asset.gzipped = std::move(gzipped);
+			}
+			m_bytes += body->size() + (asset.gzipped ? asset.gzipped->size() : 0);
+			asset.body = std::move(body);
+		}
+	}
+	SpdLogger::info(LogSystem::WEBSERVER, "Loaded {} web files, {} KiB.", m_assets.size(), m_bytes / 1024);
+}
+
+WebAssets::Asset const* WebAssets::find(std::string const& name) const {
+	auto it = m_assets.find(name);
+	return it == m_assets.end() ? nullptr : &it->second;
+}
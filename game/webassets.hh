@@ -0,0 +1,42 @@
+#pragma once
+
+#include "fs.hh"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+* @short The static files of the web frontend, loaded into memory when the web server starts.
+*
+* Files are looked up by their name only, like findFile() does, the first directory containing a name wins.
+* Each asset has its content type, a strong ETag derived from its content and, if that pays off, a gzip
+* compressed variant, so serving one never touches the filesystem.
+**/
+class WebAssets {
+  public:
+	struct Asset {
+		std::string contentType;
+		std::shared_ptr<std::string const> body;
+		std::shared_ptr<std::string const> gzipped;  ///< Null if compressing does not make it much smaller
+		std::string etag;  ///< Quoted; the gzip variant has "-gz" appended inside the quotes
+		std::string gzipEtag() const { return etag.substr(0, etag.size() - 1) + "-gz\""; }
+	};
+
+	/// Load the files (not subdirectories) of dirs
+	explicit WebAssets(Paths const& dirs);
+	/// The asset with this file name, nullptr if there is none
+	Asset const* find(std::string const& name) const;
+	std::size_t size() const { return m_assets.size(); }
+	/// Total bytes held, counting both variants
+	std::size_t bytes() const { return m_bytes; }
+	/// MIME type by file extension
+	static std::string contentType(fs::path const& file);
+	/// The existing directories of themePaths (see getThemePaths) that are or are inside a www folder, in order
+	static Paths webFolders(Paths const& themePaths);
+
+  private:
+	std::unordered_map<std::string, Asset> m_assets;
+	std::size_t m_bytes = 0;
+};
@@ -0,0 +1,55 @@
+#include "weblibrary.hh"
+
+#include "log.hh"
+#include "songs.hh"
+#include "unicode.hh"
+
+namespace {
+	std::vector<Catalogue::Entry> entries(SongCollection const& songs) {
+		std::vector<Catalogue::Entry> result;
+		result.reserve(songs.size());
+		for (auto const& song: songs) {
+			Catalogue::Entry& entry = result.emplace_back();
+			entry.title = song->title;
+			entry.artist = song->artist;
+			entry.edition = song->edition;
+			entry.language = song->language;
+			entry.creator = song->creator;
+			entry.providedBy = song->providedBy;
+			entry.comment = song->comment;
+			entry.hasError = song->loadStatus == Song::LoadStatus::PARSERERROR;
+			entry.search = song->strFull();
+			// Song::sortKeys belong to the UI thread, so the web server makes its own
+			auto key = [&](Catalogue::Sort sort) -> std::string& { return entry.keys[static_cast<std::size_t>(sort)]; };
+			key(Catalogue::Sort::TITLE) = UnicodeUtil::sortKey(song->collateByTitle, false);
+			key(Catalogue::Sort::ARTIST) = UnicodeUtil::sortKey(song->collateByArtist, false);
+			key(Catalogue::Sort::EDITION) = UnicodeUtil::sortKey(song->edition, false);
+			key(Catalogue::Sort::LANGUAGE) = UnicodeUtil::sortKey(song->language, false);
+			key(Catalogue::Sort::CREATOR) = UnicodeUtil::sortKey(song->creator, false);
+		}
+		return result;
+	}
+}
+
+WebLibrary::Snapshot::Snapshot(std::uint64_t version, SongCollection songs)
+  : catalogue(version, entries(songs)), songs(std::move(songs)) {}
+
+SongPtr WebLibrary::Snapshot::find(Catalogue::Entry const& fields) const {
+	auto const i = catalogue.find(fields);
+	return i ? songs[*i] : SongPtr();
+}
+
+std::shared_ptr<WebLibrary::Snapshot const> WebLibrary::snapshot() {
+	std::lock_guard<std::mutex> l(m_mutex);
+	auto const now = std::chrono::steady_clock::now();
+	if (m_snapshot) {
+		if (m_snapshot->catalogue.version() == m_songs.version()) return m_snapshot;
+		if (!m_songs.doneLoading && now - m_time < std::chrono::seconds(1)) return m_snapshot;
+	}
+	std::uint64_t version = 0;
+	SongCollection songs = m_songs.snapshot(version);
+	m_snapshot = std::make_shared<Snapshot const>(version, std::move(songs));
+	m_time = now;
+	SpdLogger::debug(LogSystem::WEBSERVER, "Published song catalogue version {} with {} songs.", version, m_snapshot->songs.size());
+	return m_snapshot;
+}
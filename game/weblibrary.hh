@@ -0,0 +1,39 @@
+#pragma once
+
+#include "catalogue.hh"
+#include "song.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+class Songs;
+
+/**
+* @short The song library as the web server sees it, as immutable catalogue snapshots of Songs.
+*
+* While the songs are loading, the library version changes with every song, so a new snapshot is made at most
+* once per second and requests settle for a slightly older list in between.
+**/
+class WebLibrary {
+  public:
+	/// The library as of one version, with the songs in the same order as the catalogue entries
+	struct Snapshot {
+		Snapshot(std::uint64_t version, SongCollection songs);
+		/// The song whose text fields equal those of fields, null if there is none
+		SongPtr find(Catalogue::Entry const& fields) const;
+		Catalogue catalogue;
+		SongCollection songs;
+	};
+
+	explicit WebLibrary(Songs& songs): m_songs(songs) {}
+	/// The latest snapshot (thread safe)
+	std::shared_ptr<Snapshot const> snapshot();
+
+  private:
+	Songs& m_songs;
+	std::mutex m_mutex;
+	std::shared_ptr<Snapshot const> m_snapshot;  ///< Shared with the requests still using it (locked with m_mutex)
+	std::chrono::steady_clock::time_point m_time;  ///< When m_snapshot was made
+};
@@ -0,0 +1,82 @@
+#include "webreply.hh"
+
+#include <charconv>
+
+namespace {
+	/// A response that clients may keep, but must revalidate with its ETag before using it again
+	WebReply revalidated(std::uint16_t status, std::string const& etag, bool gzipped) {
+		WebReply reply;
+		reply.status = status;
+		reply.headers = {
+			{ "ETag", etag },
+			{ "Cache-Control", "no-cache" },
+			{ "Vary", "Accept-Encoding" },
+		};
+		if (gzipped) reply.headers.emplace_back("Content-Encoding", "gzip");
+		return reply;
+	}
+
+	/// Parse a non-negative decimal number, the whole string must be used
+	bool parseSize(std::string const& str, std::size_t& value) {
+		auto const end = str.data() + str.size();
+		auto const [ptr, ec] = std::from_chars(str.data(), end, value);
+		return ec == std::errc() && ptr == end;
+	}
+}
+
+std::string WebRequest::param(std::string const& name) const {
+	auto it = query.find(name);
+	return it == query.end() ? std::string() : it->second;
+}
+
+bool WebRequest::acceptsGzip() const {
+	return acceptEncoding.find("gzip") != std::string::npos;
+}
+
+bool WebRequest::notModified(std::string const& etag) const {
+	return ifNoneMatch.find(etag) != std::string::npos;
+}
+
+WebReply WebReply::text(std::uint16_t status, std::string message) {
+	WebReply reply;
+	reply.status = status;
+	reply.body = std::make_shared<std::string const>(std::move(message));
+	reply.contentType = "text/plain; charset=utf-8";
+	return reply;
+}
+
+std::optional<Catalogue::Query> parseCatalogueQuery(WebRequest const& request) {
+	Catalogue::Query query;
+	if (auto sort = Catalogue::parseSort(request.param("sort"))) query.sort = *sort;
+	query.descending = request.param("order") == "descending";
+	query.search = request.param("q");
+	if (auto offset = request.param("offset"); !offset.empty() && !parseSize(offset, query.offset)) return std::nullopt;
+	if (auto limit = request.param("limit"); !limit.empty() && !parseSize(limit, query.limit)) return std::nullopt;
+	return query;
+}
+
+WebReply replyCatalogue(WebRequest const& request, Catalogue const& catalogue, Catalogue::Query const& query) {
+	bool const gzip = request.acceptsGzip();
+	// Clients polling an unchanged library are answered without building the list
+	for (auto const& etag: { catalogue.etag(query, gzip), catalogue.etag(query, false) }) {
+		if (request.notModified(etag)) return revalidated(304, etag, false);
+	}
+	auto const result = catalogue.get(query, gzip);
+	WebReply reply = revalidated(200, result.etag, result.gzipped);
+	reply.headers.emplace_back("X-Total-Count", std::to_string(result.total));
+	reply.body = result.body;
+	reply.contentType = "application/json";
+	return reply;
+}
+
+WebReply replyAsset(WebRequest const& request, WebAssets const* assets, std::string const& name) {
+	WebAssets::Asset const* asset = assets ? assets->find(name) : nullptr;
+	if (!asset) return WebReply::text(404, "The file \"" + name + "\" was not found.");
+	bool const gzip = asset->gzipped && request.acceptsGzip();
+	std::string const etag = gzip ? asset->gzipEtag() : asset->etag;
+	if (request.notModified(etag)) return revalidated(304, etag, false);
+	WebReply reply = revalidated(200, etag, gzip);
+	reply.body = gzip ? asset->gzipped : asset->body;
+	reply.contentType = asset->contentType;
+	return reply;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "catalogue.hh"
+#include "webassets.hh"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// What the web server needs of a request, independent of the HTTP library
+struct WebRequest {
+	std::map<std::string, std::string> query;  ///< Decoded query parameters
+	std::string acceptEncoding;  ///< The Accept-Encoding header
+	std::string ifNoneMatch;  ///< The If-None-Match header
+	/// A query parameter, empty if not given
+	std::string param(std::string const& name) const;
+	bool acceptsGzip() const;
+	/// True if the client sent If-None-Match with this ETag, i.e. it already has the response
+	bool notModified(std::string const& etag) const;
+};
+
+/// A response of the web server, which RequestHandler turns into an HTTP response
+struct WebReply {
+	std::uint16_t status = 200;
+	std::vector<std::pair<std::string, std::string>> headers;
+	std::shared_ptr<std::string const> body;  ///< Null for no body
+	std::string contentType;
+	/// A plain text reply, e.g. an error message
+	static WebReply text(std::uint16_t status, std::string message);
+};
+
+/// The query of api/getDataBase.json: sort=artist|title|language|edition|creator, order=ascending|descending,
+/// q=search, offset and limit. Null if offset or limit is not a number.
+std::optional<Catalogue::Query> parseCatalogueQuery(WebRequest const& request);
+/// The songs of the catalogue matching the query, or 304 Not Modified if the client already has them
+WebReply replyCatalogue(WebRequest const& request, Catalogue const& catalogue, Catalogue::Query const& query);
+/// The file of the web frontend with this name, gzipped if the client accepts it, 304 if it has it or 404
+WebReply replyAsset(WebRequest const& request, WebAssets const* assets, std::string const& name);
@@ -0,0 +1,61 @@
+#include "workerpool.hh"
+
+#include <utility>
+
+WorkerPool::WorkerPool(unsigned threads) {
+	m_threads.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i) m_threads.emplace_back(&WorkerPool::worker, this);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (auto& t: m_threads) t.join();
+}
+
+void WorkerPool::run(std::size_t count, Job const& job) {
+	if (count == 0) return;
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_job = &job;
+		m_count = count;
+		m_next = 0;
+		m_busy = threads();
+		m_error = nullptr;
+		++m_batch;
+	}
+	m_wake.notify_all();
+	drain();
+	std::unique_lock<std::mutex> l(m_mutex);
+	m_done.wait(l, [this] { return m_busy == 0; });
+	m_job = nullptr;
+	if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+void WorkerPool::drain() {
+	for (std::size_t i; (i = m_next++) < m_count; ) {
+		try {
+			(*m_job)(i);
+		} catch (...) {
+			std::lock_guard<std::mutex> l(m_mutex);
+			if (!m_error) m_error = std::current_exception();
+		}
+	}
+}
+
+void WorkerPool::worker() {
+	std::uint64_t batch = 0;
+	std::unique_lock<std::mutex> l(m_mutex);
+	while (true) {
+		m_wake.wait(l, [&] { return m_quit || m_batch != batch; });
+		if (m_quit) return;
+		batch = m_batch;
+		l.unlock();
+		drain();
+		l.lock();
+		if (--m_busy == 0) m_done.notify_one();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of threads for running short parallel batches (e.g. one job per analyzer per engine tick).
+ * The calling thread takes part in the batch, so a pool with zero threads simply runs everything inline.
+ */
+class WorkerPool {
+  public:
+	using Job = std::function<void(std::size_t)>;
+	/// Start the given number of worker threads
+	explicit WorkerPool(unsigned threads);
+	~WorkerPool();
+	WorkerPool(WorkerPool const&) = delete;
+	WorkerPool& operator=(WorkerPool const&) = delete;
+	/**
+	* Call job(i) for every i in [0, count) and return once all calls have finished.
+	* Each index is processed exactly once by one thread; the first exception thrown by a job is rethrown here.
+	* Not reentrant: only one thread may call run at a time.
+	*/
+	void run(std::size_t count, Job const& job);
+	/// Number of worker threads (excluding the caller of run)
+	unsigned threads() const { return static_cast<unsigned>(m_threads.size()); }
+
+  private:
+	void worker();
+	void drain();
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	Job const* m_job = nullptr;
+	std::size_t m_count = 0;
+	std::atomic<std::size_t> m_next{ 0 };
+	unsigned m_busy = 0;  ///< Workers that have not yet finished the current batch
+	std::uint64_t m_batch = 0;
+	std::exception_ptr m_error;
+	bool m_quit = false;
+	std::vector<std::thread> m_threads;
+};
@@ -2,6 +2,10 @@
 #include "printer.hh"
 
 #include "game/analyzer.hh"
+#include "game/libda/fft.hpp"
+
+#include <chrono>
+#include <random>
 
 struct UnitTest_Analyzer : public testing::Test {
 	float makeWave(float n, float frequency) {
@@ -203,3 +207,118 @@ TEST_F(UnitTest_Analyzer, findTone_1760_A) {
 
 	EXPECT_THAT(result, IsNull()); // 1760 is outside used ranged
 }
+
+TEST_F(UnitTest_Analyzer, getTones_sorted) {
+	fill({110.0, 220.0, 330.0, 440.0});
+
+	analyzer.process();
+
+	auto const& result = analyzer.getTones();
+
+	EXPECT_FALSE(result.empty());
+	EXPECT_TRUE(std::is_sorted(result.begin(), result.end(), [](Tone const& l, Tone const& r) { return l.freq < r.freq; }));
+}
+
+TEST_F(UnitTest_Analyzer, DISABLED_benchmark_tones_per_second) {
+	// A chord with a vibrato, in chunks of 10 ms like the engine processes it
+	constexpr auto seconds = 20;
+	constexpr auto chunk = 480;
+	auto data = std::vector<float>(chunk);
+	auto tones = std::size_t{};
+	auto elapsed = std::chrono::duration<double>{};
+
+	for (auto pos = 0; pos < seconds * 48000; pos += chunk) {
+		for (auto n = 0; n < chunk; ++n) {
+			auto const t = static_cast<float>(pos + n) / 48000.f;
+			auto const vibrato = 1.f + 0.01f * std::sin(pi2 * 5.f * t);
+			data[n] = 0.2f * (std::sin(pi2 * 220.f * vibrato * t) + std::sin(pi2 * 277.f * vibrato * t) + std::sin(pi2 * 330.f * vibrato * t));
+		}
+		analyzer.input(data.begin(), data.end());
+		auto const begin = std::chrono::steady_clock::now();
+		analyzer.process();
+		elapsed += std::chrono::steady_clock::now() - begin;
+		tones += analyzer.getTones().size();
+	}
+
+	auto const tonesPerSecond = static_cast<double>(tones) / elapsed.count();
+	RecordProperty("tones_per_second", std::to_string(tonesPerSecond));
+	RecordProperty("realtime_factor", std::to_string(seconds / elapsed.count()));
+	EXPECT_GT(tones, 0u);
+}
+
+namespace {
+	std::vector<float> makeNoise(std::size_t count) {
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		auto data = std::vector<float>(count);
+		for (auto& s : data) s = dist(rng);
+		return data;
+	}
+}
+
+TEST(UnitTest_RealFFT, matches_complex_fft) {
+	auto const input = makeNoise(FFT_N);
+	auto const window = std::vector<float>(FFT_N, 1.f);
+	auto const expected = da::fft<FFT_P>(input.begin(), window);
+	auto plan = da::RealFFT<FFT_P>();
+	auto result = std::vector<std::complex<float>>(plan.BINS);
+
+	plan(input.data(), window.data(), result.data());
+
+	for (auto k = 0u; k < plan.BINS; ++k) {
+		// Tolerance relative to the spectrum scale (sqrt(N) for white noise)
+		EXPECT_NEAR(expected[k].real(), result[k].real(), 1e-3) << "bin " << k;
+		EXPECT_NEAR(expected[k].imag(), result[k].imag(), 1e-3) << "bin " << k;
+	}
+}
+
+TEST(UnitTest_RealFFT, small_sizes) {
+	auto const input = makeNoise(32);
+	auto const window = std::vector<float>(32, 1.f);
+
+	auto const expected4 = da::fft<2>(input.begin(), window);
+	auto plan4 = da::RealFFT<2>();
+	auto result4 = std::vector<std::complex<float>>(plan4.BINS);
+	plan4(input.data(), result4.data());
+	for (auto k = 0u; k < plan4.BINS; ++k) EXPECT_NEAR(0.f, std::abs(expected4[k] - result4[k]), 1e-5) << "bin " << k;
+
+	auto const expected32 = da::fft<5>(input.begin(), window);
+	auto plan32 = da::RealFFT<5>();
+	auto result32 = std::vector<std::complex<float>>(plan32.BINS);
+	plan32(input.data(), result32.data());
+	for (auto k = 0u; k < plan32.BINS; ++k) EXPECT_NEAR(0.f, std::abs(expected32[k] - result32[k]), 1e-5) << "bin " << k;
+}
+
+TEST(UnitTest_RealFFT, sine_peak) {
+	auto input = std::vector<float>(FFT_N);
+	for (auto n = 0u; n < FFT_N; ++n) input[n] = std::cos(pi2 * 20.f * static_cast<float>(n) / FFT_N);
+	auto plan = da::RealFFT<FFT_P>();
+	auto result = std::vector<std::complex<float>>(plan.BINS);
+
+	plan(input.data(), result.data());
+
+	EXPECT_NEAR(FFT_N / 2, std::abs(result[20]), 1e-2);
+	EXPECT_NEAR(0.f, std::abs(result[19]), 1e-2);
+	EXPECT_NEAR(0.f, std::abs(result[21]), 1e-2);
+}
+
+TEST(UnitTest_RealFFT, DISABLED_benchmark) {
+	auto const input = makeNoise(FFT_N);
+	auto const window = std::vector<float>(FFT_N, 1.f);
+	auto plan = da::RealFFT<FFT_P>();
+	auto result = std::vector<std::complex<float>>(plan.BINS);
+	constexpr auto runs = 2000;
+	auto sink = 0.f;
+
+	auto time = [&](auto&& transform) {
+		auto const begin = std::chrono::steady_clock::now();
+		for (auto i = 0; i < runs; ++i) sink += transform();
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / runs;
+	};
+	auto const complexTime = time([&] { return da::fft<FFT_P>(input.begin(), window)[1].real(); });
+	auto const realTime = time([&] { plan(input.data(), window.data(), result.data()); return result[1].real(); });
+
+	RecordProperty("us_per_fft_complex", std::to_string(complexTime));
+	RecordProperty("us_per_fft_real", std::to_string(realTime));
+	EXPECT_TRUE(std::isfinite(sink));
+}
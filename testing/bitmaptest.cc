@@ -0,0 +1,115 @@
+#include "game/image.hh"
+
+#include "common.hh"
+
+#include <cstdio>
+#include <jpeglib.h>
+
+namespace {
+	Bitmap gradient(unsigned width, unsigned height, pix::Format fmt) {
+		Bitmap bitmap;
+		bitmap.fmt = fmt;
+		bitmap.resize(width, height);
+		unsigned const bpp = fmt == pix::Format::RGB ? 3 : 4;
+		bitmap.buf.resize(std::size_t{ width } * height * bpp);
+		for (unsigned y = 0; y < height; ++y) {
+			for (unsigned x = 0; x < width; ++x) {
+				for (unsigned c = 0; c < bpp; ++c) bitmap.buf[(y * width + x) * bpp + c] = static_cast<unsigned char>(x * 10 + c);
+			}
+		}
+		return bitmap;
+	}
+
+	/// Write a JPEG with a red left half and a blue right half, load it back and remove the file
+	Bitmap halvesJPEG(unsigned width, unsigned height) {
+		fs::path const path = fs::temp_directory_path() / ("performous_bitmap_" + std::to_string(width) + "x" + std::to_string(height) + ".jpg");
+		std::vector<unsigned char> row(std::size_t{ width } * 3);
+		for (unsigned x = 0; x < width; ++x) {
+			row[x * 3] = x < width / 2 ? 255 : 0;
+			row[x * 3 + 2] = x < width / 2 ? 0 : 255;
+		}
+		jpeg_compress_struct cinfo;
+		jpeg_error_mgr jerr;
+		cinfo.err = jpeg_std_error(&jerr);
+		jpeg_create_compress(&cinfo);
+		std::FILE* file = std::fopen(path.string().c_str(), "wb");
+		jpeg_stdio_dest(&cinfo, file);
+		cinfo.image_width = width;
+		cinfo.image_height = height;
+		cinfo.input_components = 3;
+		cinfo.in_color_space = JCS_RGB;
+		jpeg_set_defaults(&cinfo);
+		jpeg_set_quality(&cinfo, 100, TRUE);
+		jpeg_start_compress(&cinfo, TRUE);
+		while (cinfo.next_scanline < height) {
+			JSAMPROW ptr = row.data();
+			jpeg_write_scanlines(&cinfo, &ptr, 1);
+		}
+		jpeg_finish_compress(&cinfo);
+		jpeg_destroy_compress(&cinfo);
+		std::fclose(file);
+		Bitmap bitmap;
+		loadJPEG(bitmap, path);
+		fs::remove(path);
+		return bitmap;
+	}
+
+	/// Number of rows whose outermost pixels are not red on the left and blue on the right (sheared rows are not)
+	unsigned badRows(Bitmap const& bitmap) {
+		unsigned bad = 0;
+		for (unsigned y = 0; y < bitmap.height; ++y) {
+			unsigned char const* left = &bitmap.buf[(std::size_t{ y } * bitmap.width + 1) * 3];
+			unsigned char const* right = &bitmap.buf[(std::size_t{ y } * bitmap.width + bitmap.width - 2) * 3];
+			if (left[0] < 200 || left[2] > 60 || right[0] > 60 || right[2] < 200) ++bad;
+		}
+		return bad;
+	}
+}
+
+TEST(UnitTest_Bitmap, shrink_halves_until_it_fits) {
+	Bitmap bitmap = gradient(1000, 500, pix::Format::CHAR_RGBA);
+	bitmap.shrink(256);
+	EXPECT_EQ(250u, bitmap.width);
+	EXPECT_EQ(125u, bitmap.height);
+	EXPECT_EQ(250u * 125u * 4u, bitmap.buf.size());
+	EXPECT_FLOAT_EQ(2.0f, bitmap.ar);
+}
+
+TEST(UnitTest_Bitmap, shrink_averages) {
+	Bitmap bitmap = gradient(4, 2, pix::Format::RGB);
+	bitmap.shrink(2);
+	ASSERT_EQ(2u, bitmap.width);
+	ASSERT_EQ(1u, bitmap.height);
+	// Columns 0 and 1 (values 0 and 10) and columns 2 and 3 (20 and 30), per channel
+	EXPECT_THAT(bitmap.buf, ElementsAre(5, 6, 7, 25, 26, 27));
+}
+
+TEST(UnitTest_Bitmap, shrink_odd_and_thin) {
+	Bitmap bitmap = gradient(5, 1, pix::Format::RGB);
+	bitmap.shrink(2);
+	ASSERT_EQ(2u, bitmap.width);
+	ASSERT_EQ(1u, bitmap.height);
+	// The fifth column is dropped
+	EXPECT_THAT(bitmap.buf, ElementsAre(5, 6, 7, 25, 26, 27));
+	Bitmap small = gradient(100, 100, pix::Format::CHAR_RGBA);
+	small.shrink(100);
+	EXPECT_EQ(100u, small.width);
+	small.shrink(0);
+	EXPECT_EQ(100u, small.width);
+}
+
+TEST(UnitTest_Bitmap, jpeg_rows_are_packed) {
+	Bitmap bitmap = halvesJPEG(13, 8);
+	ASSERT_EQ(13u, bitmap.width);
+	ASSERT_EQ(8u, bitmap.height);
+	EXPECT_EQ(pix::Format::RGB, bitmap.fmt);
+	EXPECT_EQ(0u, badRows(bitmap));
+}
+
+TEST(UnitTest_Bitmap, shrink_jpeg_odd_width) {
+	Bitmap bitmap = halvesJPEG(301, 64);
+	bitmap.shrink(150);
+	ASSERT_EQ(150u, bitmap.width);
+	ASSERT_EQ(32u, bitmap.height);
+	EXPECT_EQ(0u, badRows(bitmap));
+}
@@ -0,0 +1,177 @@
+#include "game/catalogue.hh"
+
+#include "common.hh"
+
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+	Catalogue::Entry entry(std::string artist, std::string title, std::string edition = "") {
+		Catalogue::Entry e;
+		e.artist = artist;
+		e.title = title;
+		e.edition = edition;
+		e.search = artist + "\n" + title + "\n" + edition;
+		// The real keys come from the collator, plain strings are enough for ordering here
+		e.keys[static_cast<std::size_t>(Catalogue::Sort::TITLE)] = title + "__" + artist;
+		e.keys[static_cast<std::size_t>(Catalogue::Sort::ARTIST)] = artist + "__" + title;
+		e.keys[static_cast<std::size_t>(Catalogue::Sort::EDITION)] = edition;
+		return e;
+	}
+
+	Catalogue make() {
+		return Catalogue(7, {
+			entry("Queen", "Bohemian Rhapsody", "SingStar Queen"),
+			entry("ABBA", "Waterloo", "SingStar ABBA"),
+			entry("Björk", "Army of Me", "SingStar Pop"),
+			entry("ABBA", "Dancing Queen", "SingStar ABBA"),
+		});
+	}
+
+	std::vector<std::string> titles(Catalogue::Response const& response) {
+		std::vector<std::string> result;
+		for (auto const& song: nlohmann::json::parse(*response.body)) result.push_back(song.at("Title").get<std::string>());
+		return result;
+	}
+
+	std::string gunzip(std::string const& data) {
+		z_stream stream{};
+		inflateInit2(&stream, 15 + 16);
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+		stream.avail_in = static_cast<uInt>(data.size());
+		std::string out;
+		char buffer[4096];
+		int ret;
+		do {
+			stream.next_out = reinterpret_cast<Bytef*>(buffer);
+			stream.avail_out = sizeof(buffer);
+			ret = inflate(&stream, Z_NO_FLUSH);
+			out.append(buffer, sizeof(buffer) - stream.avail_out);
+		} while (ret == Z_OK);
+		inflateEnd(&stream);
+		EXPECT_EQ(Z_STREAM_END, ret);
+		return out;
+	}
+}
+
+TEST(UnitTest_Catalogue, sorts) {
+	auto const catalogue = make();
+	Catalogue::Query query;
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Dancing Queen", "Waterloo", "Army of Me", "Bohemian Rhapsody"));
+	query.descending = true;
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Bohemian Rhapsody", "Army of Me", "Waterloo", "Dancing Queen"));
+	query.descending = false;
+	query.sort = Catalogue::Sort::TITLE;
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Army of Me", "Bohemian Rhapsody", "Dancing Queen", "Waterloo"));
+	// Equal editions are ordered by artist
+	query.sort = Catalogue::Sort::EDITION;
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Dancing Queen", "Waterloo", "Army of Me", "Bohemian Rhapsody"));
+	EXPECT_EQ(Catalogue::Sort::CREATOR, Catalogue::parseSort("creator"));
+	EXPECT_FALSE(Catalogue::parseSort("bogus"));
+}
+
+TEST(UnitTest_Catalogue, pages) {
+	auto const catalogue = make();
+	Catalogue::Query query;
+	query.offset = 1;
+	query.limit = 2;
+	auto response = catalogue.get(query, false);
+	EXPECT_THAT(titles(response), ElementsAre("Waterloo", "Army of Me"));
+	EXPECT_EQ(4u, response.total);
+	query.descending = true;
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Army of Me", "Waterloo"));
+	query.offset = 10;
+	EXPECT_EQ("[]", *catalogue.get(query, false).body);
+}
+
+TEST(UnitTest_Catalogue, searches) {
+	auto const catalogue = make();
+	Catalogue::Query query;
+	query.search = "queen";
+	auto response = catalogue.get(query, false);
+	EXPECT_THAT(titles(response), ElementsAre("Dancing Queen", "Bohemian Rhapsody"));
+	EXPECT_EQ(2u, response.total);
+	query.search = "BJORK";
+	EXPECT_THAT(titles(catalogue.get(query, false)), ElementsAre("Army of Me"));
+	query.search = "nothing like this";
+	response = catalogue.get(query, false);
+	EXPECT_EQ("[]", *response.body);
+	EXPECT_EQ(0u, response.total);
+}
+
+TEST(UnitTest_Catalogue, etags) {
+	auto const catalogue = make();
+	Catalogue::Query query;
+	auto const etag = catalogue.get(query, false).etag;
+	EXPECT_EQ(etag, catalogue.etag(query, false));
+	EXPECT_EQ('"', etag.front());
+	EXPECT_EQ('"', etag.back());
+	EXPECT_NE(etag, catalogue.etag(query, true));
+	query.offset = 1;
+	EXPECT_NE(etag, catalogue.etag(query, false));
+	query.offset = 0;
+	// The same query of another library version is another resource
+	Catalogue const newer(8, {});
+	EXPECT_NE(etag, newer.etag(query, false));
+}
+
+TEST(UnitTest_Catalogue, finds) {
+	auto const catalogue = make();
+	auto fields = entry("ABBA", "Dancing Queen", "SingStar ABBA");
+	EXPECT_EQ(3u, catalogue.find(fields));
+	// Only the text fields are compared, not the search text or the keys
+	fields.search.clear();
+	fields.keys = {};
+	EXPECT_EQ(3u, catalogue.find(fields));
+	fields.edition = "SingStar Pop";
+	EXPECT_FALSE(catalogue.find(fields));
+}
+
+TEST(UnitTest_Catalogue, gzip_round_trip) {
+	std::vector<Catalogue::Entry> entries;
+	for (int i = 0; i < 100; ++i) entries.push_back(entry("Artist " + std::to_string(i), "Title " + std::to_string(i)));
+	Catalogue const catalogue(1, std::move(entries));
+	Catalogue::Query query;
+	auto const plain = catalogue.get(query, false);
+	auto const compressed = catalogue.get(query, true);
+	EXPECT_FALSE(plain.gzipped);
+	ASSERT_TRUE(compressed.gzipped);
+	EXPECT_LT(compressed.body->size(), plain.body->size());
+	EXPECT_EQ(*plain.body, gunzip(*compressed.body));
+	// The full list is serialized once and shared by all requests
+	EXPECT_EQ(plain.body, catalogue.get(query, false).body);
+	// Small responses are not worth compressing
+	query.limit = 1;
+	EXPECT_FALSE(catalogue.get(query, true).gzipped);
+}
+
+TEST(UnitTest_Catalogue, DISABLED_benchmark_40k_songs) {
+	std::vector<Catalogue::Entry> entries;
+	for (int i = 0; i < 40000; ++i) {
+		entries.push_back(entry("Artist " + std::to_string(i % 3000), "Song title number " + std::to_string(i), "Edition " + std::to_string(i % 40)));
+	}
+	auto const begin = std::chrono::steady_clock::now();
+	Catalogue const catalogue(1, std::move(entries));
+	auto const built = std::chrono::steady_clock::now();
+	Catalogue::Query query;
+	catalogue.get(query, true);
+	auto const first = std::chrono::steady_clock::now();
+	int const polls = 100;
+	for (int i = 0; i < polls; ++i) catalogue.get(query, true);
+	auto const polled = std::chrono::steady_clock::now();
+	query.search = "number 123";
+	query.limit = 50;
+	auto const response = catalogue.get(query, true);
+	auto const searched = std::chrono::steady_clock::now();
+
+	auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+	RecordProperty("ms_snapshot", std::to_string(ms(begin, built)));
+	RecordProperty("ms_first_list", std::to_string(ms(built, first)));
+	RecordProperty("ms_poll", std::to_string(ms(first, polled) / polls));
+	RecordProperty("ms_search", std::to_string(ms(polled, searched)));
+	EXPECT_EQ(111u, response.total);  // 123, 1230..1239 and 12300..12399
+}
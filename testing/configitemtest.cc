@@ -2,6 +2,8 @@
 
 #include "common.hh"
 
+#include <chrono>
+
 TEST(UnitTest_ConfigItem, i) {
     EXPECT_EQ(0, ConfigItem(0).i());
     EXPECT_EQ(1, ConfigItem(1).i());
@@ -338,3 +340,61 @@ TEST(UnitTest_ConfigItem, decrease) {
     EXPECT_EQ(0, item.ui());
 }
 
+
+namespace {
+    ConfigItemMap makeItems() {
+        ConfigItemMap items;
+        for (int i = 0; i < 200; ++i) items["graphic/item" + std::to_string(i)] = ConfigItem(i);
+        auto& item = items["audio/video_delay"];
+        item = ConfigItem(0.5f);
+        item.setName("audio/video_delay");
+        return items;
+    }
+}
+
+TEST(UnitTest_ConfigHandle, reads_and_writes_the_item) {
+    auto items = makeItems();
+    ConfigHandle<float> const handle("audio/video_delay", items);
+
+    EXPECT_EQ(0.5f, *handle);
+
+    items["audio/video_delay"].f() = 0.25f;
+    EXPECT_EQ(0.25f, *handle);
+
+    *handle = 0.75f;
+    EXPECT_EQ(0.75f, items["audio/video_delay"].f());
+
+    EXPECT_EQ(&items["audio/video_delay"], &handle.item());
+}
+
+TEST(UnitTest_ConfigHandle, type_is_checked_when_created) {
+    auto items = makeItems();
+
+    EXPECT_NO_THROW(ConfigHandle<int>("graphic/item1", items));
+    EXPECT_THROW(ConfigHandle<float>("graphic/item1", items), std::logic_error);
+    EXPECT_THROW(ConfigHandle<unsigned short>("graphic/item1", items), std::logic_error);
+    EXPECT_THROW(ConfigHandle<int>("graphic/missing", items), std::logic_error);
+    EXPECT_EQ(items.end(), items.find("graphic/missing"));
+}
+
+TEST(UnitTest_ConfigHandle, DISABLED_benchmark_against_lookup) {
+    auto items = makeItems();
+    ConfigHandle<float> const handle("audio/video_delay", items);
+    constexpr int reads = 1000000;
+    auto const msSince = [](std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+
+    volatile float sum = 0.0f;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; ++i) sum = sum + items["audio/video_delay"].f();
+    auto const lookup = msSince(begin);
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; ++i) sum = sum + *handle;
+    auto const cached = msSince(begin);
+
+    RecordProperty("ms_lookup_1M", std::to_string(lookup));
+    RecordProperty("ms_handle_1M", std::to_string(cached));
+    EXPECT_LT(cached, lookup);
+}
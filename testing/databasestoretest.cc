@@ -0,0 +1,123 @@
+#include "common.hh"
+
+#include "game/database_store.hh"
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+namespace {
+	/// A store in a fresh temporary file, removed afterwards
+	struct TempStore {
+		fs::path path;
+		TempStore(): path(fs::temp_directory_path() / ("performous_test_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()) + ".bin")) {
+			fs::remove(path);
+		}
+		~TempStore() { fs::remove(path); }
+	};
+
+	HiscoreItem hiscore(unsigned i) {
+		return HiscoreItem(1000 + i % 9000, i % 50, i % 20000, static_cast<unsigned short>(i % 3), i % 2 ? "vocals" : "Guitar", std::chrono::seconds(1600000000 + i));
+	}
+
+	double msSince(std::chrono::steady_clock::time_point begin) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+}
+
+TEST(UnitTest_DatabaseStore, append_and_load) {
+	TempStore temp;
+	{
+		DatabaseStore store(temp.path);
+		EXPECT_FALSE(store.exists());
+		store.append(DatabaseStore::Player{3, "Singer", "singer.png"});
+		store.append(DatabaseStore::Song{7, "Beatles,The", "Help!", false});
+		store.append(hiscore(42));
+		store.append(DatabaseStore::Song{7, "Beatles,The", "Help!", true});
+	}  // Writes are finished on destruction
+
+	DatabaseStore store(temp.path);
+	ASSERT_TRUE(store.exists());
+	auto const records = store.load();
+	ASSERT_EQ(4u, records.size());
+
+	auto const& player = std::get<DatabaseStore::Player>(records[0]);
+	EXPECT_EQ(3u, player.id);
+	EXPECT_EQ("Singer", player.name);
+	EXPECT_EQ("singer.png", player.picture);
+
+	auto const& song = std::get<DatabaseStore::Song>(records[1]);
+	EXPECT_EQ(7u, song.id);
+	EXPECT_EQ("Beatles,The", song.artist);
+	EXPECT_EQ("Help!", song.title);
+	EXPECT_FALSE(song.broken);
+	EXPECT_TRUE(std::get<DatabaseStore::Song>(records[3]).broken);
+
+	auto const& score = std::get<HiscoreItem>(records[2]);
+	auto const expected = hiscore(42);
+	EXPECT_EQ(expected.score, score.score);
+	EXPECT_EQ(expected.playerid, score.playerid);
+	EXPECT_EQ(expected.songid, score.songid);
+	EXPECT_EQ(expected.level, score.level);
+	EXPECT_EQ(expected.track, score.track);
+	EXPECT_EQ(expected.unixtime, score.unixtime);
+}
+
+TEST(UnitTest_DatabaseStore, damaged_tail_is_cut_off) {
+	TempStore temp;
+	{
+		DatabaseStore store(temp.path);
+		store.append(hiscore(1));
+		store.append(hiscore(2));
+	}
+	auto const size = fs::file_size(temp.path);
+	fs::resize_file(temp.path, size - 3);  // As if the last write was interrupted
+
+	{
+		DatabaseStore store(temp.path);
+		EXPECT_EQ(1u, store.load().size());
+		store.append(hiscore(3));
+	}
+
+	DatabaseStore store(temp.path);
+	auto const records = store.load();
+	ASSERT_EQ(2u, records.size());
+	EXPECT_EQ(hiscore(3).score, std::get<HiscoreItem>(records[1]).score);
+}
+
+TEST(UnitTest_DatabaseStore, rejects_other_files) {
+	TempStore temp;
+	std::ofstream(temp.path) << "<?xml version=\"1.0\"?>\n<performous/>\n";
+
+	DatabaseStore store(temp.path);
+	EXPECT_THROW(store.load(), std::runtime_error);
+}
+
+TEST(UnitTest_DatabaseStore, DISABLED_benchmark_1M_hiscores) {
+	TempStore temp;
+	constexpr unsigned rows = 1000000;
+	DatabaseStore::Records records;
+	records.reserve(rows);
+	for (unsigned i = 0; i < rows; ++i) records.emplace_back(hiscore(i));
+
+	DatabaseStore store(temp.path);
+	auto begin = std::chrono::steady_clock::now();
+	store.rewrite(records);
+	auto const save = msSince(begin);
+
+	begin = std::chrono::steady_clock::now();
+	auto const loaded = store.load();
+	auto const load = msSince(begin);
+
+	begin = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < 1000; ++i) store.append(hiscore(rows + i));
+	auto const append = msSince(begin);
+	store.flush();
+
+	RecordProperty("ms_save_1M", std::to_string(save));
+	RecordProperty("ms_load_1M", std::to_string(load));
+	RecordProperty("ms_append_1000", std::to_string(append));
+	RecordProperty("kib_1M", std::to_string(fs::file_size(temp.path) / 1024));
+	EXPECT_EQ(rows, loaded.size());
+	EXPECT_EQ(rows + 1000, store.load().size());
+}
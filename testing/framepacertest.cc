@@ -0,0 +1,102 @@
+#include "game/framepacer.hh"
+
+#include "common.hh"
+
+namespace {
+	using TimePoint = FramePacer::TimePoint;
+	TimePoint const start = TimePoint() + 1h;
+
+	double ms(TimePoint t) { return Seconds(t - start).count() * 1000.0; }
+
+	/// Run a frame that starts working at wakeTime (or now if later) and needs cost ms until the swap
+	TimePoint frame(FramePacer& pacer, TimePoint now, double cost, double swap = 0.0) {
+		now = std::max(now, pacer.wakeTime());
+		pacer.workStarted(now);
+		now += clockDur(Seconds(cost / 1000.0));
+		pacer.swapStarted(now);
+		now += clockDur(Seconds(swap / 1000.0));
+		pacer.frameDone(now);
+		return now;
+	}
+}
+
+TEST(UnitTest_FramePacer, no_limit_never_sleeps) {
+	FramePacer pacer;
+	auto now = start;
+	for (int i = 0; i < 10; ++i) {
+		now = frame(pacer, now, 2.0);
+		EXPECT_EQ(TimePoint{}, pacer.wakeTime());
+	}
+	EXPECT_EQ(9u, pacer.stats().frames);
+	EXPECT_NEAR(2.0, pacer.stats().average().count() * 1000.0, 1e-6);
+}
+
+TEST(UnitTest_FramePacer, wakes_up_just_in_time_for_the_deadline) {
+	FramePacer pacer;
+	pacer.period(Seconds(0.010));
+	auto now = frame(pacer, start, 3.0);
+	EXPECT_NEAR(3.0, ms(now), 1e-6);
+	// The next deadline is a period after the first frame; wake up the measured cost and the margin before it
+	EXPECT_NEAR(13.0 - 3.0 - FramePacer::minMargin.count() * 1000.0, ms(pacer.wakeTime()), 1e-6);
+	now = frame(pacer, now, 3.0);
+	pacer.interval();
+	for (int i = 0; i < 100; ++i) now = frame(pacer, now, 3.0);
+	auto const stats = pacer.interval();
+	EXPECT_NEAR(10.0, stats.average().count() * 1000.0, 1e-6);
+	EXPECT_NEAR(10.0, stats.worst.count() * 1000.0, 1e-6);
+	EXPECT_EQ(0u, pacer.stats().missed);
+}
+
+TEST(UnitTest_FramePacer, prediction_uses_the_slowest_recent_frame) {
+	FramePacer pacer;
+	pacer.period(Seconds(0.010));
+	auto now = frame(pacer, start, 1.0);
+	now = frame(pacer, now, 5.0);
+	now = frame(pacer, now, 1.0);
+	EXPECT_NEAR(5.0 + pacer.margin().count() * 1000.0, pacer.predictedCost().count() * 1000.0, 1e-6);
+	// Never more than the whole period
+	now = frame(pacer, now, 30.0);
+	EXPECT_NEAR(10.0, pacer.predictedCost().count() * 1000.0, 1e-6);
+}
+
+TEST(UnitTest_FramePacer, late_frame_does_not_cause_catch_up) {
+	FramePacer pacer;
+	pacer.period(Seconds(0.010));
+	auto now = frame(pacer, start, 2.0);
+	now = frame(pacer, now, 25.0);
+	EXPECT_EQ(1u, pacer.stats().missed);
+	EXPECT_GT(pacer.margin(), FramePacer::minMargin);
+	// The slow frame makes the pacer start right away, with the next deadline a full period after the late frame
+	auto const late = now;
+	EXPECT_EQ(late, pacer.wakeTime());
+	now = frame(pacer, now, 2.0);
+	EXPECT_NEAR(ms(late) + 2.0, ms(now), 1e-6);
+	EXPECT_EQ(1u, pacer.stats().missed);
+}
+
+TEST(UnitTest_FramePacer, vsync_blocking_is_not_counted_as_work) {
+	FramePacer pacer;
+	pacer.period(Seconds(0.010));
+	auto now = start;
+	for (int i = 0; i < 10; ++i) {
+		// The swap blocks until the next refresh, which is when the pacer expects it
+		auto const work = std::max(now, pacer.wakeTime());
+		auto const vblank = pacer.wakeTime() == TimePoint{} ? work + 10ms : work + clockDur(pacer.predictedCost());
+		now = frame(pacer, now, 2.0, Seconds(vblank - work).count() * 1000.0 - 2.0);
+	}
+	EXPECT_NEAR(2.0 + FramePacer::minMargin.count() * 1000.0, pacer.predictedCost().count() * 1000.0, 1e-6);
+	EXPECT_EQ(0u, pacer.stats().missed);
+}
+
+TEST(UnitTest_FramePacer, interval_resets) {
+	FramePacer pacer;
+	auto now = start;
+	for (int i = 0; i < 5; ++i) now = frame(pacer, now, 1.0);
+	EXPECT_EQ(4u, pacer.interval().frames);
+	EXPECT_EQ(0u, pacer.interval().frames);
+	now = frame(pacer, now, 4.0);
+	auto const interval = pacer.interval();
+	EXPECT_EQ(1u, interval.frames);
+	EXPECT_NEAR(4.0, interval.worst.count() * 1000.0, 1e-6);
+	EXPECT_EQ(5u, pacer.stats().frames);
+}
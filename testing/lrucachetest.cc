@@ -0,0 +1,139 @@
+#include "game/lrucache.hh"
+
+#include "common.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+TEST(UnitTest_LruCache, find_and_insert) {
+	LruCache<std::string, int> cache(4, 100);
+	EXPECT_EQ(nullptr, cache.find("a"));
+	cache.insert("a", 1);
+	ASSERT_NE(nullptr, cache.find("a"));
+	EXPECT_EQ(1, *cache.find("a"));
+	cache.insert("a", 2, 10);
+	EXPECT_EQ(2, *cache.find("a"));
+	EXPECT_EQ(1u, cache.size());
+	EXPECT_EQ(10u, cache.cost());
+	EXPECT_EQ(3u, cache.hits());
+	EXPECT_EQ(1u, cache.misses());
+}
+
+TEST(UnitTest_LruCache, evicts_least_recently_used) {
+	LruCache<std::string, int> cache(3, 100);
+	cache.insert("a", 1);
+	cache.insert("b", 2);
+	cache.insert("c", 3);
+	cache.find("a");  // Now b is the oldest
+	cache.insert("d", 4);
+	EXPECT_EQ(3u, cache.size());
+	EXPECT_EQ(nullptr, cache.find("b"));
+	EXPECT_NE(nullptr, cache.find("a"));
+	EXPECT_NE(nullptr, cache.find("c"));
+	EXPECT_NE(nullptr, cache.find("d"));
+}
+
+TEST(UnitTest_LruCache, evicts_by_cost) {
+	LruCache<int, int> cache(100, 10);
+	cache.insert(1, 1, 4);
+	cache.insert(2, 2, 4);
+	cache.insert(3, 3, 4);
+	EXPECT_EQ(nullptr, cache.find(1));
+	EXPECT_EQ(8u, cache.cost());
+	// An entry over the limit alone is still kept, as the caller is about to use it
+	cache.insert(4, 4, 50);
+	EXPECT_EQ(1u, cache.size());
+	EXPECT_EQ(50u, cache.cost());
+	EXPECT_NE(nullptr, cache.find(4));
+}
+
+TEST(UnitTest_LruCache, erase_and_clear) {
+	LruCache<int, std::shared_ptr<int>> cache(10, 100);
+	auto value = std::make_shared<int>(1);
+	cache.insert(1, value, 5);
+	cache.insert(2, value, 5);
+	EXPECT_EQ(3, value.use_count());
+	EXPECT_TRUE(cache.erase(1));
+	EXPECT_FALSE(cache.erase(1));
+	EXPECT_EQ(5u, cache.cost());
+	cache.clear();
+	EXPECT_EQ(0u, cache.size());
+	EXPECT_EQ(0u, cache.cost());
+	EXPECT_EQ(1, value.use_count());
+}
+
+namespace {
+	/// Stand-in for TextRenderer: an ARGB surface about the size Pango would make, filled pixel by pixel
+	std::shared_ptr<std::vector<std::uint32_t>> rasterize(std::string const& text, unsigned fontSize) {
+		auto const width = static_cast<unsigned>(text.size()) * fontSize * 2 / 3 + 4;
+		auto const height = fontSize * 3 / 2;
+		auto surface = std::make_shared<std::vector<std::uint32_t>>(width * height);
+		std::uint32_t seed = 0;
+		for (char c: text) seed = seed * 31 + static_cast<unsigned char>(c);
+		for (auto& px: *surface) px = seed = seed * 1664525 + 1013904223;
+		return surface;
+	}
+
+	using SurfaceCache = LruCache<std::string, std::shared_ptr<std::vector<std::uint32_t>>>;
+	/// Four lines of lyrics split into syllables, drawn once per frame with the highlight moving along
+	std::vector<std::vector<std::string>> const page = {
+		{ "Twin", "kle, ", "twin", "kle, ", "lit", "tle ", "star, " },
+		{ "how ", "I ", "won", "der ", "what ", "you ", "are! " },
+		{ "Up ", "a", "bove ", "the ", "world ", "so ", "high, " },
+		{ "like ", "a ", "dia", "mond ", "in ", "the ", "sky. " },
+	};
+	unsigned const fontSize = 64;
+
+	/// Draw the page through the cache like TextRenderer does, returning the pixels drawn
+	std::size_t drawCached(SurfaceCache& cache, int frames) {
+		std::size_t sink = 0;
+		for (int frame = 0; frame < frames; ++frame) {
+			for (auto const& line: page) {
+				for (auto const& syllable: line) {
+					auto const key = std::to_string(fontSize) + "|" + syllable;
+					auto* surface = cache.find(key);
+					if (!surface) {
+						auto s = rasterize(syllable, fontSize);
+						surface = &cache.insert(key, s, s->size() * 4);
+					}
+					sink += (*surface)->size();
+				}
+			}
+		}
+		return sink;
+	}
+}
+
+TEST(UnitTest_LruCache, lyric_page) {
+	SurfaceCache cache(512, 64 << 20);
+	int const frames = 3;
+	EXPECT_GT(drawCached(cache, frames), 0u);
+	// Repeated syllables ("kle, " and "the ") and all later frames hit the cache
+	EXPECT_EQ(26u, cache.size());
+	EXPECT_EQ(26u, cache.misses());
+	EXPECT_EQ(28u * frames - 26u, cache.hits());
+}
+
+TEST(UnitTest_LruCache, DISABLED_benchmark_lyric_page) {
+	int const frames = 200;
+	std::size_t sink = 0;
+
+	auto const begin = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+		for (auto const& line: page)
+			for (auto const& syllable: line) sink += rasterize(syllable, fontSize)->size();
+	auto const uncached = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	SurfaceCache cache(512, 64 << 20);
+	auto const begin2 = std::chrono::steady_clock::now();
+	sink += drawCached(cache, frames);
+	auto const cached = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin2).count();
+
+	RecordProperty("ms_uncached", std::to_string(uncached));
+	RecordProperty("ms_cached", std::to_string(cached));
+	RecordProperty("kib_cached", std::to_string(cache.cost() >> 10));
+	EXPECT_GT(sink, 0u);
+}
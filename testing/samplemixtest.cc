@@ -0,0 +1,139 @@
+#include "common.hh"
+
+#include "game/samplemix.hh"
+#include "game/libda/sample.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+	std::vector<std::int16_t> makeSamples(std::size_t count, unsigned seed = 1) {
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> dist(-32768, 32767);
+		std::vector<std::int16_t> data(count);
+		for (auto& s: data) s = static_cast<std::int16_t>(dist(rng));
+		return data;
+	}
+
+	/// The straightforward loop that the kernels must match
+	void reference(float* dst, std::int16_t const* src, std::size_t samples, samplemix::Gain const& gain) {
+		for (std::size_t i = 0; i < samples; ++i) {
+			float level = std::clamp(gain.level + gain.step * static_cast<float>(i / 2), 0.0f, 1.0f);
+			dst[i] += gain.scale * level * da::conv_from_s16(src[i]);
+		}
+	}
+
+	void expectKernelsMatch(std::size_t samples, samplemix::Gain const& gain) {
+		auto const src = makeSamples(samples);
+		std::vector<float> expected(samples, 0.25f);
+		reference(expected.data(), src.data(), samples, gain);
+		for (auto const& k: samplemix::supported()) {
+			std::vector<float> result(samples, 0.25f);
+			k.kernel(result.data(), src.data(), samples, gain);
+			for (std::size_t i = 0; i < samples; ++i) {
+				ASSERT_NEAR(expected[i], result[i], 1e-5f) << k.name << " differs at sample " << i << " of " << samples;
+			}
+		}
+	}
+}
+
+TEST(UnitTest_SampleMix, scalar_is_supported) {
+	auto const& kernels = samplemix::supported();
+
+	ASSERT_FALSE(kernels.empty());
+	EXPECT_EQ(&samplemix::scalar, kernels.front().kernel);
+	EXPECT_EQ(kernels.back().kernel, samplemix::best());
+}
+
+TEST(UnitTest_SampleMix, constant_gain) {
+	for (std::size_t samples: { 0, 1, 2, 7, 8, 9, 16, 30, 1024, 1031 }) {
+		expectKernelsMatch(samples, { 0.8f, 1.0f, 0.0f });
+	}
+}
+
+TEST(UnitTest_SampleMix, fade_in) {
+	for (std::size_t samples: { 2, 8, 14, 1024, 1030 }) {
+		expectKernelsMatch(samples, { 0.5f, 0.0f, 0.001f });
+	}
+}
+
+TEST(UnitTest_SampleMix, fade_clamped) {
+	// Ramps crossing both ends of the [0, 1] range within the block
+	expectKernelsMatch(1024, { 1.0f, 0.9f, 0.01f });
+	expectKernelsMatch(1024, { 1.0f, 0.1f, -0.01f });
+	expectKernelsMatch(64, { 1.0f, 0.0f, 1.0f });
+}
+
+TEST(UnitTest_SampleMix, advanced) {
+	samplemix::Gain const gain{ 0.5f, 0.25f, 0.125f };
+
+	auto const next = gain.advanced(6);
+
+	EXPECT_FLOAT_EQ(0.5f, next.scale);
+	EXPECT_FLOAT_EQ(0.625f, next.level);
+	EXPECT_FLOAT_EQ(0.125f, next.step);
+}
+
+TEST(UnitTest_SampleMix, split_matches_whole) {
+	// Mixing a ring buffer in two spans must give the same result as one pass
+	auto const src = makeSamples(1024);
+	samplemix::Gain const gain{ 0.7f, 0.2f, 0.002f };
+	std::vector<float> whole(src.size()), split(src.size());
+
+	samplemix::mix(whole.data(), src.data(), src.size(), gain);
+	samplemix::mix(split.data(), src.data(), 200, gain);
+	samplemix::mix(split.data() + 200, src.data() + 200, src.size() - 200, gain.advanced(200));
+
+	EXPECT_THAT(split, testing::Pointwise(FloatNear(1e-6f), whole));
+}
+
+TEST(UnitTest_SampleMix, DISABLED_benchmark_8_stems) {
+	// Mix 8 stereo stems, 512 frames per callback, from ring buffers like AudioBuffer::read does
+	constexpr std::size_t stems = 8;
+	constexpr std::size_t block = 1024;
+	constexpr std::size_t ringSize = 48000 * 2;
+	constexpr unsigned blocks = 500;
+	std::vector<std::vector<std::int16_t>> rings;
+	for (unsigned i = 0; i < stems; ++i) rings.push_back(makeSamples(ringSize, i));
+	std::vector<float> out(block), mixbuf(block);
+
+	auto time = [&](auto&& mixBlock) {
+		auto begin = std::chrono::steady_clock::now();
+		std::size_t pos = 0;
+		for (unsigned b = 0; b < blocks; ++b, pos += block) {
+			std::fill(out.begin(), out.end(), 0.0f);
+			mixBlock(pos);
+		}
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / blocks;
+	};
+
+	// The former implementation: per-sample modulo into a temporary buffer, then a separate fade/volume pass
+	double const loop = time([&](std::size_t pos) {
+		std::fill(mixbuf.begin(), mixbuf.end(), 0.0f);
+		for (auto const& ring: rings) {
+			for (std::size_t s = 0; s < block; ++s) mixbuf[s] += 0.9f * da::conv_from_s16(ring[(pos + s) % ring.size()]);
+		}
+		double fadeLevel = 0.5;
+		for (std::size_t i = 0; i < block; ++i) {
+			if (i % 2 == 0) fadeLevel = std::min(1.0, fadeLevel + 1e-4);
+			out[i] += static_cast<float>(mixbuf[i] * fadeLevel * 0.8);
+		}
+	});
+	RecordProperty("us_per_block_loop", std::to_string(loop));
+
+	for (auto const& k: samplemix::supported()) {
+		double const kernel = time([&](std::size_t pos) {
+			samplemix::Gain const gain{ 0.9f * 0.8f, 0.5f + 1e-4f, 1e-4f };
+			for (auto const& ring: rings) {
+				std::size_t first = pos % ring.size();
+				std::size_t firstSize = std::min(block, ring.size() - first);
+				k.kernel(out.data(), ring.data() + first, firstSize, gain);
+				if (firstSize < block) k.kernel(out.data() + firstSize, ring.data(), block - firstSize, gain.advanced(firstSize));
+			}
+		});
+		RecordProperty(std::string("us_per_block_") + k.name, std::to_string(kernel));
+	}
+}
@@ -0,0 +1,70 @@
+#include "common.hh"
+
+#include "game/songindex.hh"
+
+#include <chrono>
+#include <string>
+
+TEST(UnitTest_SongIndex, normalize) {
+	EXPECT_EQ("beyonce", SongIndex::normalize("Beyoncé"));
+	EXPECT_EQ("motorhead", SongIndex::normalize("MOTÖRHEAD"));
+	EXPECT_EQ("strasse", SongIndex::normalize("Straße"));
+	EXPECT_EQ("abc 123", SongIndex::normalize("ABC 123"));
+}
+
+TEST(UnitTest_SongIndex, ids_are_consecutive) {
+	auto index = SongIndex();
+
+	EXPECT_EQ(0u, index.add("first"));
+	EXPECT_EQ(1u, index.add("second"));
+	EXPECT_EQ(2u, index.size());
+
+	index.clear();
+
+	EXPECT_EQ(0u, index.size());
+	EXPECT_EQ(0u, index.add("third"));
+}
+
+TEST(UnitTest_SongIndex, search) {
+	auto index = SongIndex();
+	index.add("Bohemian Rhapsody\nQueen\nRock");
+	index.add("Crazy in Love\nBeyoncé\nPop");
+	index.add("Ace of Spades\nMotörhead\nMetal");
+	index.add("Queen of the Night\nWhitney Houston\nPop");
+
+	EXPECT_THAT(index.search("queen"), ElementsAre(0u, 3u));
+	EXPECT_THAT(index.search("BEYONCE"), ElementsAre(1u));
+	EXPECT_THAT(index.search("motorhead"), ElementsAre(2u));
+	EXPECT_THAT(index.search("pop"), ElementsAre(1u, 3u));
+	EXPECT_THAT(index.search("of"), ElementsAre(2u, 3u));  // Shorter than a trigram
+	EXPECT_THAT(index.search(""), ElementsAre(0u, 1u, 2u, 3u));
+	EXPECT_THAT(index.search("xyz"), ElementsAre());
+	EXPECT_THAT(index.search("nique"), ElementsAre());  // Trigrams "niq"/"iqu"/"que" must be adjacent
+}
+
+TEST(UnitTest_SongIndex, refine) {
+	auto index = SongIndex();
+	index.add("Bohemian Rhapsody\nQueen");
+	index.add("Queen of the Night\nWhitney Houston");
+	index.add("Night Fever\nBee Gees");
+
+	auto const first = index.search("quee");
+	auto const refined = index.refine("queen of", first);
+
+	EXPECT_THAT(first, ElementsAre(0u, 1u));
+	EXPECT_THAT(refined, ElementsAre(1u));
+}
+
+TEST(UnitTest_SongIndex, DISABLED_benchmark_40k_songs) {
+	auto index = SongIndex();
+	for (auto i = 0; i < 40000; ++i) {
+		index.add("Song title number " + std::to_string(i) + "\nArtist " + std::to_string(i % 997) + "\nGenre " + std::to_string(i % 31) + "\nEdition\n/songs/folder" + std::to_string(i));
+	}
+
+	auto const begin = std::chrono::steady_clock::now();
+	auto const result = index.search("artist 996");
+	auto const elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	RecordProperty("ms_per_search", std::to_string(elapsed));
+	EXPECT_EQ(40u, result.size());
+}
@@ -0,0 +1,76 @@
+#include "common.hh"
+
+#include "game/songitemindex.hh"
+
+#include <chrono>
+#include <string>
+
+namespace {
+	SongItem item(std::string const& artist, std::string const& title) {
+		auto result = SongItem();
+		result.artist = artist;
+		result.title = title;
+		return result;
+	}
+
+	/// Milliseconds to add count songs and look all of them up by artist and title
+	double addAndLookup(unsigned count) {
+		auto index = SongItemIndex();
+		auto const begin = std::chrono::steady_clock::now();
+		for (auto i = 0u; i < count; ++i) index.add(item("Artist " + std::to_string(i % 997), "Song title number " + std::to_string(i)));
+		auto found = 0u;
+		for (auto i = 0u; i < count; ++i) found += index.find("ARTIST " + std::to_string(i % 997), "song title number " + std::to_string(i)) == i;
+		auto const elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		EXPECT_EQ(count, found);
+		EXPECT_EQ(count, index.size());
+		return elapsed;
+	}
+}
+
+TEST(UnitTest_SongItemIndex, ids) {
+	auto index = SongItemIndex();
+
+	EXPECT_EQ(0u, index.add(item("A", "first")));
+	EXPECT_EQ(10u, index.add(item("B", "second"), 10u));
+	EXPECT_EQ(11u, index.add(item("C", "third"), 10u));  // Taken
+	EXPECT_EQ(5u, index.add(item("D", "fourth"), 5u));
+	EXPECT_EQ(12u, index.add(item("E", "fifth")));  // Never reuses ids below the highest one
+
+	EXPECT_THAT(index.ids(), ElementsAre(0u, 5u, 10u, 11u, 12u));
+	ASSERT_THAT(index.find(11u), NotNull());
+	EXPECT_EQ("third", index.find(11u)->title);
+	EXPECT_THAT(index.find(1u), IsNull());
+}
+
+TEST(UnitTest_SongItemIndex, lookup_ignores_case) {
+	auto index = SongItemIndex();
+	index.add(item("Beyoncé", "Crazy in Love"), 3u);
+	index.add(item("Die Ärzte", "Straße"), 4u);
+
+	EXPECT_EQ(3u, index.find("BEYONCÉ", "crazy in love"));
+	EXPECT_EQ(4u, index.find("die ärzte", "STRASSE"));
+	EXPECT_EQ(std::nullopt, index.find("Beyonce", "Crazy in Love"));  // Accents matter
+	EXPECT_EQ(std::nullopt, index.find("Beyoncé", "Crazy"));
+	EXPECT_EQ(std::nullopt, index.find("BeyoncéCrazy", " in Love"));
+}
+
+TEST(UnitTest_SongItemIndex, duplicates_resolve_to_lowest_id) {
+	auto index = SongItemIndex();
+	index.add(item("Queen", "Bohemian Rhapsody"), 7u);
+	index.add(item("queen", "bohemian rhapsody"), 2u);
+	index.add(item("QUEEN", "BOHEMIAN RHAPSODY"), 9u);
+
+	EXPECT_EQ(2u, index.find("Queen", "Bohemian Rhapsody"));
+	EXPECT_EQ(3u, index.size());
+}
+
+TEST(UnitTest_SongItemIndex, DISABLED_benchmark_100k_songs_scale_linearly) {
+	addAndLookup(1000);  // Warm up
+	auto const small = addAndLookup(10000);
+	auto const large = addAndLookup(100000);
+
+	RecordProperty("ms_10k_songs", std::to_string(small));
+	RecordProperty("ms_100k_songs", std::to_string(large));
+	// Ten times the songs should take about ten times as long (a quadratic algorithm would take a hundred)
+	EXPECT_LT(large, 30.0 * small + 50.0);
+}
@@ -0,0 +1,89 @@
+#include "common.hh"
+
+#include "game/spscqueue.hh"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+TEST(UnitTest_SpscQueue, default_ctor) {
+	auto queue = SpscQueue<int, 4>();
+
+	EXPECT_TRUE(queue.empty());
+	EXPECT_THAT(queue.front(), IsNull());
+	EXPECT_EQ(4, queue.capacity);
+}
+
+TEST(UnitTest_SpscQueue, push_pop) {
+	auto queue = SpscQueue<std::string, 4>();
+
+	EXPECT_TRUE(queue.push("a"));
+	EXPECT_TRUE(queue.push("b"));
+	EXPECT_FALSE(queue.empty());
+
+	EXPECT_THAT(queue.front(), Pointee(std::string("a")));
+	queue.pop();
+	EXPECT_THAT(queue.front(), Pointee(std::string("b")));
+	queue.pop();
+	EXPECT_TRUE(queue.empty());
+	EXPECT_THAT(queue.front(), IsNull());
+}
+
+TEST(UnitTest_SpscQueue, push_full) {
+	auto queue = SpscQueue<int, 2>();
+
+	EXPECT_TRUE(queue.push(1));
+	EXPECT_TRUE(queue.push(2));
+	EXPECT_FALSE(queue.push(3));
+
+	queue.pop();
+
+	EXPECT_TRUE(queue.push(3));
+	EXPECT_THAT(queue.front(), Pointee(2));
+}
+
+TEST(UnitTest_SpscQueue, pop_empty) {
+	auto queue = SpscQueue<int, 2>();
+
+	queue.pop();
+
+	EXPECT_TRUE(queue.empty());
+	EXPECT_TRUE(queue.push(1));
+	EXPECT_THAT(queue.front(), Pointee(1));
+}
+
+TEST(UnitTest_SpscQueue, move_only) {
+	auto queue = SpscQueue<std::unique_ptr<int>, 2>();
+
+	EXPECT_TRUE(queue.push(std::make_unique<int>(42)));
+
+	auto value = std::move(*queue.front());
+	queue.pop();
+
+	EXPECT_THAT(value, Pointee(42));
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(UnitTest_SpscQueue, threaded_order) {
+	auto queue = SpscQueue<int, 16>();
+	constexpr int count = 10000;
+
+	std::thread producer([&queue] {
+		for (int i = 0; i < count; ) {
+			if (queue.push(i)) ++i;
+			else std::this_thread::yield();
+		}
+	});
+	int expected = 0;
+	while (expected < count) {
+		if (int* value = queue.front()) {
+			EXPECT_EQ(expected, *value);
+			queue.pop();
+			++expected;
+		}
+		else std::this_thread::yield();
+	}
+	producer.join();
+
+	EXPECT_TRUE(queue.empty());
+}
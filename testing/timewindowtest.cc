@@ -0,0 +1,141 @@
+#include "game/timewindow.hh"
+
+#include "common.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace {
+	struct Item {
+		double begin, end;
+		bool passed = false;
+	};
+	double itemBegin(Item const& item) { return item.begin; }
+	double itemEnd(Item const& item) { return item.end; }
+
+	void update(TimeWindow& window, std::vector<Item>& items, double time) {
+		window.update(items, time - 0.2, time + 1.5, itemBegin, itemEnd, [](Item& item) { item.passed = true; });
+	}
+}
+
+TEST(UnitTest_TimeWindow, follows_time) {
+	std::vector<Item> items;
+	for (int i = 0; i < 100; ++i) items.push_back({ i * 1.0, i * 1.0 + 0.1 });
+	TimeWindow window;
+	window.reset(items, itemBegin, itemEnd);
+	update(window, items, 10.0);
+	// 9.8 .. 11.5
+	EXPECT_EQ(10u, window.first());
+	EXPECT_EQ(12u, window.last());
+	EXPECT_TRUE(items[9].passed);
+	EXPECT_FALSE(items[10].passed);
+	// 50.3 .. 52.0, an item beginning exactly at the end is included
+	update(window, items, 50.5);
+	EXPECT_EQ(51u, window.first());
+	EXPECT_EQ(53u, window.last());
+	update(window, items, 1000.0);
+	EXPECT_EQ(100u, window.first());
+	EXPECT_EQ(100u, window.last());
+}
+
+TEST(UnitTest_TimeWindow, long_item_keeps_window_open) {
+	std::vector<Item> items = { { 0.0, 0.1 }, { 1.0, 30.0 }, { 2.0, 2.1 }, { 3.0, 3.1 }, { 20.0, 20.1 } };
+	TimeWindow window;
+	window.reset(items, itemBegin, itemEnd);
+	update(window, items, 10.0);
+	// The hold note is still on screen, so the short notes after it are kept in the window
+	EXPECT_EQ(1u, window.first());
+	EXPECT_EQ(4u, window.last());
+	update(window, items, 31.0);
+	EXPECT_EQ(5u, window.first());
+}
+
+TEST(UnitTest_TimeWindow, seek_back_rebuilds) {
+	std::vector<Item> items = { { 0.0, 0.1 }, { 1.0, 30.0 }, { 2.0, 2.1 }, { 3.0, 3.1 }, { 20.0, 20.1 }, { 40.0, 40.1 } };
+	TimeWindow window;
+	window.reset(items, itemBegin, itemEnd);
+	update(window, items, 39.0);
+	EXPECT_EQ(5u, window.first());
+	update(window, items, 25.0);
+	EXPECT_EQ(1u, window.first());
+	EXPECT_EQ(5u, window.last());
+	update(window, items, 0.0);
+	EXPECT_EQ(0u, window.first());
+	EXPECT_EQ(2u, window.last());
+}
+
+namespace {
+	/// Expert chart: 8 chords per second, every tenth one a hold note
+	std::vector<Item> chart(double seconds) {
+		std::vector<Item> chords;
+		std::uint32_t seed = 1;
+		for (double t = 0.0; t < seconds; t += 0.125) {
+			seed = seed * 1664525 + 1013904223;
+			chords.push_back({ t, seed % 10 == 0 ? t + 0.5 + (seed >> 16) % 4 : t });
+		}
+		return chords;
+	}
+	double const fps = 60.0;
+	struct Count {
+		std::size_t visited = 0, drawn = 0;
+	};
+
+	/// As GuitarGraph used to: walk the chords from the start until the first one in the future
+	Count scan(std::vector<Item> const& chords, std::size_t frames) {
+		Count count;
+		for (std::size_t frame = 0; frame < frames; ++frame) {
+			double const time = static_cast<double>(frame) / fps;
+			for (auto const& chord: chords) {
+				++count.visited;
+				if (chord.begin - time > 1.5) break;
+				if (chord.end - time < -0.2) continue;
+				++count.drawn;
+			}
+		}
+		return count;
+	}
+
+	Count windowed(std::vector<Item>& chords, std::size_t frames) {
+		Count count;
+		TimeWindow window;
+		window.reset(chords, itemBegin, itemEnd);
+		for (std::size_t frame = 0; frame < frames; ++frame) {
+			double const time = static_cast<double>(frame) / fps;
+			update(window, chords, time);
+			for (auto i = window.first(); i < window.last(); ++i) {
+				++count.visited;
+				if (chords[i].end - time < -0.2) continue;
+				++count.drawn;
+			}
+		}
+		return count;
+	}
+}
+
+TEST(UnitTest_TimeWindow, draws_what_a_full_scan_draws) {
+	auto chords = chart(60.0);
+	std::size_t const frames = static_cast<std::size_t>(60.0 * fps);
+	Count const full = scan(chords, frames);
+	Count const window = windowed(chords, frames);
+	EXPECT_EQ(full.drawn, window.drawn);
+	EXPECT_LT(window.visited, 40 * frames);  // Only the chords around the current time
+}
+
+TEST(UnitTest_TimeWindow, DISABLED_benchmark_20_minute_chart) {
+	auto chords = chart(20 * 60.0);
+	std::size_t const frames = static_cast<std::size_t>(20 * 60.0 * fps);
+
+	auto const begin = std::chrono::steady_clock::now();
+	Count const full = scan(chords, frames);
+	auto const scanned = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	auto const begin2 = std::chrono::steady_clock::now();
+	Count const window = windowed(chords, frames);
+	auto const windowTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin2).count();
+
+	RecordProperty("ms_scan", std::to_string(scanned));
+	RecordProperty("ms_windowed", std::to_string(windowTime));
+	EXPECT_EQ(full.drawn, window.drawn);
+	EXPECT_LT(window.visited, full.visited / 100);
+}
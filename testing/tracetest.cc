@@ -0,0 +1,100 @@
+#include "game/trace.hh"
+
+#include "common.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+namespace {
+	struct TempFile {
+		fs::path path = fs::temp_directory_path() / ("performous_trace_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".json");
+		~TempFile() { std::error_code ec; fs::remove(path, ec); }
+		std::string read() const {
+			std::ifstream file(path, std::ios::binary);
+			return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+		}
+	};
+
+	std::size_t count(std::string const& text, std::string const& what) {
+		std::size_t n = 0;
+		for (auto pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + what.size())) ++n;
+		return n;
+	}
+
+	double nsSince(std::chrono::steady_clock::time_point begin, int n) {
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / n;
+	}
+}
+
+TEST(UnitTest_Trace, records_spans_of_all_threads) {
+	Trace::enable(true);
+	{
+		TraceScope frame("frame");
+		TraceScope draw("draw");
+	}
+	std::thread([] {
+		Trace::threadName("decoder");
+		TraceScope decode("decode");
+	}).join();
+	Trace::enable(false);
+
+	TempFile temp;
+	EXPECT_EQ(6u, Trace::write(temp.path));
+	auto const json = temp.read();
+	EXPECT_EQ(1u, count(json, "\"name\":\"frame\",\"ph\":\"B\""));
+	EXPECT_EQ(1u, count(json, "\"name\":\"draw\",\"ph\":\"E\""));
+	EXPECT_EQ(1u, count(json, "\"name\":\"decode\",\"ph\":\"B\""));
+	EXPECT_EQ(1u, count(json, "\"args\":{\"name\":\"decoder\"}"));
+	EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+}
+
+TEST(UnitTest_Trace, nothing_is_recorded_when_disabled) {
+	Trace::enable(true);
+	Trace::enable(false);
+	{
+		TraceScope frame("frame");
+		Trace::begin("draw");
+		Trace::end("draw");
+	}
+	TempFile temp;
+	EXPECT_EQ(0u, Trace::write(temp.path));
+}
+
+TEST(UnitTest_Trace, ring_keeps_the_latest_balanced_events) {
+	Trace::enable(true);
+	for (int i = 0; i < 100000; ++i) {
+		TraceScope frame("frame");
+		Trace::begin("draw");
+		Trace::end("draw");
+	}
+	Trace::enable(false);
+
+	TempFile temp;
+	auto const events = Trace::write(temp.path);
+	EXPECT_LE(events, 32768u);
+	EXPECT_GE(events, 32765u);
+	auto const json = temp.read();
+	// Ends whose begin was overwritten are dropped, so there are never more ends than begins
+	EXPECT_LE(count(json, "\"ph\":\"E\""), count(json, "\"ph\":\"B\""));
+}
+
+TEST(UnitTest_Trace, DISABLED_benchmark_scope_cost) {
+	constexpr int scopes = 1000000;
+	Trace::enable(false);
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < scopes; ++i) TraceScope scope("disabled");
+	auto const disabled = nsSince(begin, scopes);
+
+	Trace::enable(true);
+	begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < scopes; ++i) TraceScope scope("enabled");
+	auto const enabled = nsSince(begin, scopes);
+	Trace::enable(false);
+
+	RecordProperty("ns_disabled", std::to_string(disabled));
+	RecordProperty("ns_enabled", std::to_string(enabled));
+	EXPECT_LT(disabled, 20.0);
+}
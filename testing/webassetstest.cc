@@ -0,0 +1,88 @@
+#include "game/webassets.hh"
+
+#include "common.hh"
+
+#include <chrono>
+#include <fstream>
+
+namespace {
+	struct TempDirs {
+		fs::path root = fs::temp_directory_path() / ("performous_webassets_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+		fs::path theme = root / "theme", def = root / "default";
+		TempDirs() {
+			fs::create_directories(theme);
+			fs::create_directories(def / "js");
+		}
+		~TempDirs() { std::error_code ec; fs::remove_all(root, ec); }
+		static void write(fs::path const& path, std::string const& data) { std::ofstream(path, std::ios::binary) << data; }
+	};
+}
+
+TEST(UnitTest_WebAssets, content_types) {
+	EXPECT_EQ("text/html; charset=utf-8", WebAssets::contentType("index.html"));
+	EXPECT_EQ("text/javascript; charset=utf-8", WebAssets::contentType("jquery-3.2.1.min.js"));
+	EXPECT_EQ("application/json", WebAssets::contentType("bootstrap.min.css.map"));
+	EXPECT_EQ("font/woff2", WebAssets::contentType("glyphicons-halflings-regular.woff2"));
+	// Used to be served as text/javascript, as the name contains ".js"
+	EXPECT_EQ("application/octet-stream", WebAssets::contentType("bootstrap-toggle.min.jsx"));
+}
+
+TEST(UnitTest_WebAssets, first_directory_wins) {
+	TempDirs dirs;
+	TempDirs::write(dirs.theme / "style.css", "body { color: red; }");
+	TempDirs::write(dirs.def / "style.css", "body { color: black; }");
+	TempDirs::write(dirs.def / "index.html", "<html></html>");
+	TempDirs::write(dirs.def / "js" / "app.js", "// only found through the js directory");
+	WebAssets const assets({ dirs.theme, dirs.def });
+	EXPECT_EQ(2u, assets.size());
+	ASSERT_NE(nullptr, assets.find("style.css"));
+	EXPECT_EQ("body { color: red; }", *assets.find("style.css")->body);
+	EXPECT_EQ(nullptr, assets.find("app.js"));
+	EXPECT_EQ(nullptr, assets.find("missing.html"));
+	WebAssets const withJs({ dirs.theme, dirs.def, dirs.def / "js" });
+	EXPECT_NE(nullptr, withJs.find("app.js"));
+}
+
+TEST(UnitTest_WebAssets, web_folders) {
+	TempDirs dirs;
+	fs::create_directories(dirs.theme / "www" / "js");
+	fs::create_directories(dirs.def / "www");
+	auto const folders = WebAssets::webFolders({ dirs.theme, dirs.theme / "www", dirs.theme / "www" / "js", dirs.def / "www", dirs.root / "www" });
+	// The theme itself is no web folder and missing directories are skipped
+	EXPECT_EQ(Paths({ dirs.theme / "www", dirs.theme / "www" / "js", dirs.def / "www" }), folders);
+}
+
+TEST(UnitTest_WebAssets, etags_follow_content) {
+	TempDirs dirs;
+	TempDirs::write(dirs.theme / "a.js", "var a = 1;");
+	TempDirs::write(dirs.def / "b.js", "var a = 1;");
+	TempDirs::write(dirs.def / "c.js", "var a = 2;");
+	WebAssets const assets({ dirs.theme, dirs.def });
+	auto const& etag = assets.find("a.js")->etag;
+	EXPECT_EQ('"', etag.front());
+	EXPECT_EQ('"', etag.back());
+	EXPECT_EQ(etag, assets.find("b.js")->etag);
+	EXPECT_NE(etag, assets.find("c.js")->etag);
+	EXPECT_EQ(etag.substr(0, etag.size() - 1) + "-gz\"", assets.find("a.js")->gzipEtag());
+}
+
+TEST(UnitTest_WebAssets, gzip_only_when_worth_it) {
+	TempDirs dirs;
+	std::string text;
+	for (int i = 0; i < 200; ++i) text += "function f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+	std::string noise;
+	std::uint32_t seed = 1;
+	for (int i = 0; i < 4096; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		noise += static_cast<char>(seed >> 24);
+	}
+	TempDirs::write(dirs.def / "big.js", text);
+	TempDirs::write(dirs.def / "small.js", "var a = 1;");
+	TempDirs::write(dirs.def / "image.png", noise);
+	WebAssets const assets({ dirs.def });
+	ASSERT_NE(nullptr, assets.find("big.js")->gzipped);
+	EXPECT_LT(assets.find("big.js")->gzipped->size(), text.size() / 2);
+	EXPECT_EQ(nullptr, assets.find("small.js")->gzipped);
+	EXPECT_EQ(nullptr, assets.find("image.png")->gzipped);
+	EXPECT_EQ(text.size() + assets.find("big.js")->gzipped->size() + 10 + noise.size(), assets.bytes());
+}
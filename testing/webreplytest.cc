@@ -0,0 +1,143 @@
+#include "game/webreply.hh"
+
+#include "common.hh"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+	Catalogue make(std::uint64_t version) {
+		std::vector<Catalogue::Entry> entries;
+		for (int i = 0; i < 100; ++i) {
+			Catalogue::Entry& e = entries.emplace_back();
+			e.artist = "Artist " + std::to_string(i);
+			e.title = "Title " + std::to_string(i);
+			e.search = e.artist + "\n" + e.title;
+			e.keys[static_cast<std::size_t>(Catalogue::Sort::ARTIST)] = e.artist;
+			e.keys[static_cast<std::size_t>(Catalogue::Sort::TITLE)] = e.title;
+		}
+		return Catalogue(version, std::move(entries));
+	}
+
+	std::string header(WebReply const& reply, std::string const& name) {
+		for (auto const& [key, value]: reply.headers) if (key == name) return value;
+		return std::string();
+	}
+}
+
+TEST(UnitTest_WebReply, parses_catalogue_queries) {
+	WebRequest request;
+	auto query = parseCatalogueQuery(request);
+	ASSERT_TRUE(query);
+	EXPECT_EQ(Catalogue::Sort::ARTIST, query->sort);
+	EXPECT_FALSE(query->descending);
+	EXPECT_EQ(0u, query->offset);
+	EXPECT_EQ(Catalogue::Query().limit, query->limit);
+
+	request.query = { { "sort", "title" }, { "order", "descending" }, { "q", "abba" }, { "offset", "200" }, { "limit", "100" } };
+	query = parseCatalogueQuery(request);
+	ASSERT_TRUE(query);
+	EXPECT_EQ(Catalogue::Sort::TITLE, query->sort);
+	EXPECT_TRUE(query->descending);
+	EXPECT_EQ("abba", query->search);
+	EXPECT_EQ(200u, query->offset);
+	EXPECT_EQ(100u, query->limit);
+
+	// Unknown sorts fall back to the default, but numbers must be numbers
+	request.query = { { "sort", "bogus" } };
+	ASSERT_TRUE(parseCatalogueQuery(request));
+	EXPECT_EQ(Catalogue::Sort::ARTIST, parseCatalogueQuery(request)->sort);
+	for (char const* bad: { "ten", "-1", "10x", " 10" }) {
+		request.query = { { "offset", bad } };
+		EXPECT_FALSE(parseCatalogueQuery(request)) << bad;
+		request.query = { { "limit", bad } };
+		EXPECT_FALSE(parseCatalogueQuery(request)) << bad;
+	}
+}
+
+TEST(UnitTest_WebReply, catalogue_page) {
+	auto const catalogue = make(1);
+	WebRequest request;
+	request.query = { { "sort", "title" }, { "offset", "10" }, { "limit", "5" } };
+	auto const reply = replyCatalogue(request, catalogue, *parseCatalogueQuery(request));
+	EXPECT_EQ(200, reply.status);
+	EXPECT_EQ("application/json", reply.contentType);
+	EXPECT_EQ("100", header(reply, "X-Total-Count"));
+	EXPECT_EQ("no-cache", header(reply, "Cache-Control"));
+	EXPECT_EQ("", header(reply, "Content-Encoding"));
+	ASSERT_TRUE(reply.body);
+	EXPECT_EQ(5u, nlohmann::json::parse(*reply.body).size());
+}
+
+TEST(UnitTest_WebReply, catalogue_revalidation) {
+	auto const catalogue = make(1);
+	Catalogue::Query const query;
+	WebRequest request;
+	request.acceptEncoding = "gzip, deflate";
+	auto const first = replyCatalogue(request, catalogue, query);
+	EXPECT_EQ(200, first.status);
+	EXPECT_EQ("gzip", header(first, "Content-Encoding"));
+
+	// The client polls with the ETag it got and gets nothing but the ETag back
+	request.ifNoneMatch = header(first, "ETag");
+	auto const again = replyCatalogue(request, catalogue, query);
+	EXPECT_EQ(304, again.status);
+	EXPECT_FALSE(again.body);
+	EXPECT_EQ(request.ifNoneMatch, header(again, "ETag"));
+	EXPECT_EQ("", header(again, "Content-Encoding"));
+
+	// Proxies may have dropped the encoding, so the plain ETag is accepted too
+	WebRequest plain;
+	request.ifNoneMatch = header(replyCatalogue(plain, catalogue, query), "ETag");
+	EXPECT_EQ(304, replyCatalogue(request, catalogue, query).status);
+
+	// Once the library changes, the list is sent again
+	auto const newer = make(2);
+	EXPECT_EQ(200, replyCatalogue(request, newer, query).status);
+}
+
+TEST(UnitTest_WebReply, assets) {
+	fs::path const dir = fs::temp_directory_path() / ("performous_webreply_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+	fs::create_directories(dir);
+	std::string script;
+	for (int i = 0; i < 200; ++i) script += "function f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+	std::ofstream(dir / "app.js", std::ios::binary) << script;
+	WebAssets const assets({ dir });
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+
+	WebRequest request;
+	auto plain = replyAsset(request, &assets, "app.js");
+	EXPECT_EQ(200, plain.status);
+	EXPECT_EQ("text/javascript; charset=utf-8", plain.contentType);
+	ASSERT_TRUE(plain.body);
+	EXPECT_EQ(script, *plain.body);
+	EXPECT_EQ("", header(plain, "Content-Encoding"));
+
+	request.acceptEncoding = "gzip";
+	auto const gzipped = replyAsset(request, &assets, "app.js");
+	EXPECT_EQ("gzip", header(gzipped, "Content-Encoding"));
+	EXPECT_LT(gzipped.body->size(), script.size());
+	EXPECT_NE(header(plain, "ETag"), header(gzipped, "ETag"));
+
+	request.ifNoneMatch = header(gzipped, "ETag");
+	auto const cached = replyAsset(request, &assets, "app.js");
+	EXPECT_EQ(304, cached.status);
+	EXPECT_FALSE(cached.body);
+
+	EXPECT_EQ(404, replyAsset(request, &assets, "missing.html").status);
+	// Before the assets are loaded, nothing is found
+	EXPECT_EQ(404, replyAsset(request, nullptr, "app.js").status);
+}
+
+TEST(UnitTest_WebReply, text) {
+	auto const reply = WebReply::text(404, "Not here.");
+	EXPECT_EQ(404, reply.status);
+	ASSERT_TRUE(reply.body);
+	EXPECT_EQ("Not here.", *reply.body);
+	EXPECT_TRUE(reply.headers.empty());
+}
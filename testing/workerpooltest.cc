@@ -0,0 +1,69 @@
+#include "common.hh"
+
+#include "game/workerpool.hh"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(UnitTest_WorkerPool, inline_without_threads) {
+	auto pool = WorkerPool(0);
+	auto const caller = std::this_thread::get_id();
+	auto visited = std::vector<int>(5);
+
+	pool.run(visited.size(), [&](std::size_t i) {
+		EXPECT_EQ(caller, std::this_thread::get_id());
+		++visited[i];
+	});
+
+	EXPECT_EQ(0u, pool.threads());
+	EXPECT_THAT(visited, testing::Each(1));
+}
+
+TEST(UnitTest_WorkerPool, each_index_once) {
+	auto pool = WorkerPool(3);
+	auto visited = std::vector<std::atomic<int>>(100);
+
+	for (int batch = 0; batch < 50; ++batch) pool.run(visited.size(), [&](std::size_t i) { ++visited[i]; });
+
+	for (auto const& v: visited) EXPECT_EQ(50, v);
+}
+
+TEST(UnitTest_WorkerPool, empty_and_single) {
+	auto pool = WorkerPool(2);
+	auto calls = std::atomic<int>(0);
+
+	pool.run(0, [&](std::size_t) { ++calls; });
+	pool.run(1, [&](std::size_t) { ++calls; });
+	pool.run(1, [&](std::size_t) { ++calls; });
+
+	EXPECT_EQ(2, calls);
+}
+
+TEST(UnitTest_WorkerPool, runs_in_parallel) {
+	auto pool = WorkerPool(1);
+	auto arrived = std::atomic<int>(0);
+
+	// Both jobs wait for each other, which can only finish if they run concurrently
+	pool.run(2, [&](std::size_t) {
+		++arrived;
+		while (arrived < 2) std::this_thread::yield();
+	});
+
+	EXPECT_EQ(2, arrived);
+}
+
+TEST(UnitTest_WorkerPool, rethrows) {
+	auto pool = WorkerPool(2);
+	auto calls = std::atomic<int>(0);
+
+	EXPECT_THROW(pool.run(10, [&](std::size_t i) {
+		++calls;
+		if (i == 3) throw std::runtime_error("job failed");
+	}), std::runtime_error);
+	EXPECT_EQ(10, calls);
+
+	pool.run(4, [&](std::size_t) { ++calls; });
+	EXPECT_EQ(14, calls);
+}